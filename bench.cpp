@@ -0,0 +1,507 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+using namespace std;
+
+#include "decoder/Enforcer.hpp"
+#include "decoder/GCIFReader.h"
+#include "decoder/StageTimer.hpp"
+#include "encoder/GCIFWriter.h"
+#include "encoder/Log.hpp"
+#include "encoder/lodepng.h"
+using namespace cat;
+
+#include "optionparser.h"
+
+#ifdef CAT_COMPILER_MSVC
+#include "msvc/dirent.h"
+#else
+#include <dirent.h>
+#endif
+
+/*
+ * Decoder benchmark
+ *
+ * Compresses every PNG in a directory (testset/ by default), then decodes
+ * each one many times from memory.  Reports latency percentiles and output
+ * throughput over all images and split by decoder path, so decoder changes
+ * can be compared between builds.
+ *
+ * In cold mode a buffer larger than the last level cache is swept before
+ * each decode, so the compressed data, tables and output all start cold.
+ * In warm mode one untimed decode is done first.
+ *
+ * Files are processed in sorted order with fixed iteration counts so that
+ * runs on the same machine are comparable.
+ */
+
+static const int EVICT_BYTES = 64 * 1024 * 1024;
+
+enum DecodePaths {
+	PATH_SMALL_PALETTE,
+	PATH_PALETTE,
+	PATH_RGBA,
+	PATH_COUNT
+};
+
+static const char *PATH_NAMES[PATH_COUNT] = {
+	"small_palette", "palette", "rgba"
+};
+
+struct BenchFile {
+	string name;
+	int path;
+	int xsize, ysize;
+	long gci_bytes;
+	vector<double> usec;	// One per iteration
+};
+
+struct Summary {
+	int files, samples;
+	double p50, p90, p99;	// usec
+	double mbps;			// Output megabytes (RGBA) per second
+};
+
+
+//// Cache eviction
+
+static vector<u8> m_evict;
+static volatile u32 m_evict_sink;
+
+static void evictCaches() {
+	if (m_evict.empty()) {
+		m_evict.resize(EVICT_BYTES, 1);
+	}
+
+	// Write every line so that dirty output lines are flushed too
+	u32 sum = 0;
+	for (int ii = 0; ii < EVICT_BYTES; ii += 64) {
+		sum += m_evict[ii]++;
+	}
+	m_evict_sink = sum;
+}
+
+
+//// Corpus
+
+static bool isPNG(const char *name) {
+	int namelen = (int)strlen(name);
+
+	return namelen > 4 &&
+		tolower(name[namelen-4]) == '.' &&
+		tolower(name[namelen-3]) == 'p' &&
+		tolower(name[namelen-2]) == 'n' &&
+		tolower(name[namelen-1]) == 'g';
+}
+
+static int listFiles(const char *path, vector<string> &files) {
+	DIR *dir;
+	struct dirent *ent;
+
+	if ((dir = opendir(path)) == NULL) {
+		return -1;
+	}
+
+	while ((ent = readdir(dir)) != NULL) {
+		if (isPNG(ent->d_name)) {
+			files.push_back(ent->d_name);
+		}
+	}
+
+	closedir(dir);
+
+	// Fixed order for reproducible runs
+	sort(files.begin(), files.end());
+
+	return 0;
+}
+
+// Compress a PNG file to GCIF in memory
+static int compressFile(const string &path, int level, vector<u8> &gci) {
+	vector<unsigned char> image;
+	unsigned xsize, ysize;
+
+	unsigned error = lodepng::decode(image, xsize, ysize, path);
+	if (error) {
+		CAT_WARN("bench") << "PNG read error " << error << ": " << lodepng_error_text(error) << " for " << path;
+		return -1;
+	}
+
+	void *data;
+	long bytes;
+
+	int err;
+	if ((err = gcif_write_memory(&image[0], xsize, ysize, level, 1, &data, &bytes))) {
+		CAT_WARN("bench") << "Error while compressing the image: " << gcif_write_errstr(err) << " for " << path;
+		return err;
+	}
+
+	gci.assign((const u8 *)data, (const u8 *)data + bytes);
+	free(data);
+
+	return gci.empty() ? -1 : 0;
+}
+
+// Find which decoder path an image takes
+static int classify(const vector<u8> &gci) {
+	GCIFImage image;
+	GCIFReadStats stats;
+
+	if (gcif_read_ex(&gci[0], (long)gci.size(), GCIF_FMT_RGBA, &image, &stats)) {
+		return -1;
+	}
+	free(image.rgba);
+
+	// Every path reads the small palette header, and RGBA images also
+	// read the disabled global palette header
+	if (stats.tables.nsec > 0) {
+		return PATH_RGBA;
+	} else if (stats.palette.nsec > 0) {
+		return PATH_PALETTE;
+	}
+
+	return PATH_SMALL_PALETTE;
+}
+
+static int decodeFile(const vector<u8> &gci, int iterations, bool cold, BenchFile &result) {
+	int err;
+
+	// If warm, prime the caches and branch predictors with one untimed decode
+	if (!cold) {
+		GCIFImage image;
+		if ((err = gcif_read_memory(&gci[0], (long)gci.size(), &image))) {
+			return err;
+		}
+		free(image.rgba);
+	}
+
+	for (int ii = 0; ii < iterations; ++ii) {
+		if (cold) {
+			evictCaches();
+		}
+
+		GCIFImage image;
+
+		const u64 t0 = StageTimer::nsec();
+
+		if ((err = gcif_read_memory(&gci[0], (long)gci.size(), &image))) {
+			return err;
+		}
+
+		const u64 t1 = StageTimer::nsec();
+
+		free(image.rgba);
+
+		result.usec.push_back((t1 - t0) / 1000.);
+	}
+
+	return GCIF_RE_OK;
+}
+
+
+//// Reporting
+
+static double percentile(const vector<double> &sorted, double p) {
+	if (sorted.empty()) {
+		return 0;
+	}
+
+	int index = (int)(p * (sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+// Summarize all files on a path, or all files when path < 0
+static Summary summarize(const vector<BenchFile> &files, int path) {
+	Summary s;
+	vector<double> samples;
+	double bytes = 0, usec = 0;
+
+	s.files = 0;
+
+	for (int ii = 0; ii < (int)files.size(); ++ii) {
+		const BenchFile &f = files[ii];
+
+		if (path >= 0 && f.path != path) {
+			continue;
+		}
+
+		++s.files;
+		samples.insert(samples.end(), f.usec.begin(), f.usec.end());
+
+		for (int jj = 0; jj < (int)f.usec.size(); ++jj) {
+			bytes += f.xsize * (double)f.ysize * 4;
+			usec += f.usec[jj];
+		}
+	}
+
+	sort(samples.begin(), samples.end());
+
+	s.samples = (int)samples.size();
+	s.p50 = percentile(samples, 0.50);
+	s.p90 = percentile(samples, 0.90);
+	s.p99 = percentile(samples, 0.99);
+	s.mbps = usec > 0 ? bytes / usec : 0;
+
+	return s;
+}
+
+static void printSummary(const char *name, const Summary &s) {
+	char line[256];
+	sprintf(line, "%-14s files=%4d p50=%10.1f us  p90=%10.1f us  p99=%10.1f us  %8.1f MB/s",
+			 name, s.files, s.p50, s.p90, s.p99, s.mbps);
+	cout << line << endl;
+}
+
+static void writeSummaryJSON(ostream &out, const char *name, const Summary &s, bool last) {
+	out << "    \"" << name << "\": {\"files\": " << s.files << ", \"samples\": " << s.samples
+		<< ", \"p50_us\": " << s.p50 << ", \"p90_us\": " << s.p90 << ", \"p99_us\": " << s.p99
+		<< ", \"mbps\": " << s.mbps << "}" << (last ? "" : ",") << endl;
+}
+
+static int writeJSON(const char *path, const vector<BenchFile> &files, bool cold, int iterations, int level) {
+	ofstream out(path);
+	if (!out) {
+		return -1;
+	}
+
+	out << "{" << endl;
+	out << "  \"cache\": \"" << (cold ? "cold" : "warm") << "\", \"iterations\": " << iterations << ", \"level\": " << level << "," << endl;
+	out << "  \"summary\": {" << endl;
+	writeSummaryJSON(out, "all", summarize(files, -1), false);
+	for (int path = 0; path < PATH_COUNT; ++path) {
+		writeSummaryJSON(out, PATH_NAMES[path], summarize(files, path), path == PATH_COUNT - 1);
+	}
+	out << "  }," << endl;
+
+	out << "  \"files\": [" << endl;
+	for (int ii = 0; ii < (int)files.size(); ++ii) {
+		const BenchFile &f = files[ii];
+		vector<double> sorted = f.usec;
+		sort(sorted.begin(), sorted.end());
+
+		out << "    {\"name\": \"" << f.name << "\", \"path\": \"" << PATH_NAMES[f.path]
+			<< "\", \"xsize\": " << f.xsize << ", \"ysize\": " << f.ysize << ", \"gci_bytes\": " << f.gci_bytes
+			<< ", \"p50_us\": " << percentile(sorted, 0.5) << ", \"p90_us\": " << percentile(sorted, 0.9)
+			<< ", \"p99_us\": " << percentile(sorted, 0.99) << "}" << (ii + 1 < (int)files.size() ? "," : "") << endl;
+	}
+	out << "  ]" << endl;
+	out << "}" << endl;
+
+	return out ? 0 : -1;
+}
+
+static int writeCSV(const char *path, const vector<BenchFile> &files, bool cold) {
+	ofstream out(path);
+	if (!out) {
+		return -1;
+	}
+
+	out << "name,path,cache,xsize,ysize,gci_bytes,p50_us,p90_us,p99_us,mbps" << endl;
+
+	for (int ii = 0; ii < (int)files.size(); ++ii) {
+		const BenchFile &f = files[ii];
+		vector<double> sorted = f.usec;
+		sort(sorted.begin(), sorted.end());
+
+		const double p50 = percentile(sorted, 0.5);
+
+		out << f.name << "," << PATH_NAMES[f.path] << "," << (cold ? "cold" : "warm") << ","
+			<< f.xsize << "," << f.ysize << "," << f.gci_bytes << ","
+			<< p50 << "," << percentile(sorted, 0.9) << "," << percentile(sorted, 0.99) << ","
+			<< (p50 > 0 ? f.xsize * (double)f.ysize * 4 / p50 : 0) << endl;
+	}
+
+	return out ? 0 : -1;
+}
+
+
+//// Benchmark
+
+static int bench(const char *path, int level, int iterations, bool cold, const char *json_path, const char *csv_path) {
+	vector<string> names;
+	if (listFiles(path, names)) {
+		CAT_WARN("bench") << "Unable to open directory " << path;
+		return -1;
+	}
+
+	cout << "Benchmarking " << names.size() << " images in " << path << " : " << (cold ? "cold" : "warm")
+		 << " cache, " << iterations << " decodes each, level " << level << endl;
+
+	vector<BenchFile> files;
+
+	for (int ii = 0; ii < (int)names.size(); ++ii) {
+		const string filename = string(path) + "/" + names[ii];
+
+		vector<u8> gci;
+		if (compressFile(filename, level, gci)) {
+			continue;
+		}
+
+		BenchFile f;
+		f.name = names[ii];
+		f.gci_bytes = (long)gci.size();
+		f.path = classify(gci);
+
+		if (f.path < 0 || gcif_get_size(&gci[0], (long)gci.size(), &f.xsize, &f.ysize)) {
+			CAT_WARN("bench") << "Unable to decode " << filename;
+			continue;
+		}
+
+		int err;
+		if ((err = decodeFile(gci, iterations, cold, f))) {
+			CAT_WARN("bench") << "Error while decompressing " << filename << ": " << gcif_read_errstr(err);
+			continue;
+		}
+
+		files.push_back(f);
+	}
+
+	printSummary("all", summarize(files, -1));
+	for (int p = 0; p < PATH_COUNT; ++p) {
+		printSummary(PATH_NAMES[p], summarize(files, p));
+	}
+
+	if (json_path && writeJSON(json_path, files, cold, iterations, level)) {
+		CAT_WARN("bench") << "Unable to write " << json_path;
+		return -1;
+	}
+
+	if (csv_path && writeCSV(csv_path, files, cold)) {
+		CAT_WARN("bench") << "Unable to write " << csv_path;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+//// Command-line parameter parsing
+
+static option::ArgStatus RequiredArg(const option::Option &option, bool msg) {
+	if (option.arg != 0) {
+		return option::ARG_OK;
+	}
+
+	if (msg) {
+		cout << "Option '" << option.name << "' requires an argument" << endl;
+	}
+	return option::ARG_ILLEGAL;
+}
+
+enum  optionIndex { UNKNOWN, HELP, L0, L1, L2, L3, COLD, ITERATIONS, JSON, CSV };
+const option::Descriptor usage[] =
+{
+  {UNKNOWN, 0,"" , ""    ,option::Arg::None, "USAGE: ./gcif_bench [options] [PNG directory, default testset]\n\n"
+                                             "Options:" },
+  {HELP,    0,"h", "help",option::Arg::None, "  --[h]elp  \tPrint usage and exit." },
+  {L0,0,"0" , "faster",option::Arg::None, "  -0 \tCompression level 0 : Faster" },
+  {L1,0,"1" , "better",option::Arg::None, "  -1 \tCompression level 1 : Better" },
+  {L2,0,"2" , "harder",option::Arg::None, "  -2 \tCompression level 2 : Harder" },
+  {L3,0,"3" , "stronger",option::Arg::None, "  -3 \tCompression level 3 : Stronger (default)" },
+  {COLD,0,"" , "cold",option::Arg::None, "  --cold \tEvict caches before each decode.  The default is warm" },
+  {ITERATIONS,0,"" , "iterations",RequiredArg, "  --iterations=<count> \tDecodes per image (default 50)" },
+  {JSON,0,"" , "json",RequiredArg, "  --json=<output file> \tWrite summary and per-image results as JSON" },
+  {CSV,0,"" , "csv",RequiredArg, "  --csv=<output file> \tWrite per-image results as CSV" },
+  {UNKNOWN, 0,"" ,  ""   ,option::Arg::None, "\nExamples:\n"
+                                             "  ./gcif_bench --json=warm.json\n"
+                                             "  ./gcif_bench -0 --cold --csv=cold.csv ./testset" },
+  {0,0,0,0,0,0}
+};
+
+int processParameters(option::Parser &parse, option::Option options[]) {
+	if (parse.error()) {
+		cout << "Error parsing arguments [retcode:1]" << endl;
+		return 1;
+	}
+
+	if (options[HELP] || parse.nonOptionsCount() > 1) {
+		option::printUsage(std::cout, usage);
+		return 0;
+	}
+
+	// Encoder progress is not interesting here
+	Log::ref()->SetThreshold(LVL_WARN);
+
+	int compression_level = 3; // default
+
+	if (options[L0]) {
+		compression_level = 0;
+	} else if (options[L1]) {
+		compression_level = 1;
+	} else if (options[L2]) {
+		compression_level = 2;
+	} else if (options[L3]) {
+		compression_level = 3;
+	}
+
+	int iterations = 50;
+	if (options[ITERATIONS]) {
+		iterations = atoi(options[ITERATIONS].arg);
+		if (iterations < 1) {
+			iterations = 1;
+		}
+	}
+
+	const char *path = parse.nonOptionsCount() > 0 ? parse.nonOption(0) : "testset";
+
+	return bench(path, compression_level, iterations, options[COLD] != 0,
+				 options[JSON] ? options[JSON].arg : 0,
+				 options[CSV] ? options[CSV].arg : 0);
+}
+
+
+//// Entrypoint
+
+int main(int argc, const char *argv[]) {
+
+	if (argc > 0) {
+		--argc;
+		++argv;
+	}
+
+	option::Stats  stats(usage, argc, argv);
+	option::Option *options = new option::Option[stats.options_max];
+	option::Option *buffer = new option::Option[stats.buffer_max];
+	option::Parser parse(usage, argc, argv, options, buffer);
+
+	int retval = processParameters(parse, options);
+
+	delete []options;
+	delete []buffer;
+
+	return retval;
+}
@@ -0,0 +1,137 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ANSDecoder.hpp"
+#include "BitMath.hpp"
+using namespace cat;
+
+
+// Read an Exp-Golomb code, returning false if it is longer than max_bits
+static CAT_INLINE bool readGolomb(ImageReader &reader, int max_bits, u32 &value) {
+	int len = 0;
+
+	while (!reader.readBit()) {
+		if (++len > max_bits) {
+			return false;
+		}
+	}
+
+	value = 1;
+	if (len > 0) {
+		value = (1 << len) | reader.readBits(len);
+	}
+	--value;
+
+	return true;
+}
+
+
+//// ANSDecoder
+
+void ANSDecoder::buildTable(int num_syms, int table_bits) {
+	const u32 table_size = 1 << table_bits;
+	const u32 mask = table_size - 1;
+	const u32 step = spreadStep(table_size);
+	Entry * CAT_RESTRICT table = _table.get();
+	u16 * CAT_RESTRICT next = _next.get();
+
+	// Spread symbols over the table
+	u32 pos = 0;
+	for (int sym = 0; sym < num_syms; ++sym) {
+		for (int ii = 0, count = next[sym]; ii < count; ++ii) {
+			table[pos].sym = (u16)sym;
+			pos = (pos + step) & mask;
+		}
+	}
+
+	CAT_DEBUG_ENFORCE(pos == 0);
+
+	// Fill in the state transitions in table order
+	for (u32 ii = 0; ii < table_size; ++ii) {
+		Entry *entry = table + ii;
+		const u32 x = next[entry->sym]++;
+		const int bits = table_bits - BSR32(x);
+
+		entry->bits = (u8)bits;
+		entry->base = (u16)((x << bits) - table_size);
+	}
+}
+
+bool ANSDecoder::init(int num_syms, int table_bits, ImageReader &reader) {
+	CAT_DEBUG_ENFORCE(num_syms > 0);
+
+	if (table_bits < MIN_TABLE_BITS || table_bits > MAX_TABLE_BITS) {
+		CAT_DEBUG_EXCEPTION();
+		return false;
+	}
+
+	const u32 table_size = 1 << table_bits;
+
+	_next.resize(num_syms);
+	_table.resizeZero(table_size);
+
+	u16 * CAT_RESTRICT next = _next.get();
+
+	// Read normalized frequencies
+	u32 total = 0;
+	for (int sym = 0; sym < num_syms;) {
+		u32 freq;
+		if (!readGolomb(reader, table_bits + 1, freq) || freq > table_size) {
+			return false;
+		}
+
+		// If a run of unused symbols,
+		if (freq == 0) {
+			u32 run;
+			if (!readGolomb(reader, 16, run) || run >= (u32)(num_syms - sym)) {
+				return false;
+			}
+
+			for (u32 ii = 0; ii <= run; ++ii) {
+				next[sym++] = 0;
+			}
+		} else {
+			next[sym++] = (u16)freq;
+			total += freq;
+		}
+	}
+
+	// If the table is never used,
+	if (total == 0) {
+		return true;
+	}
+
+	if (total != table_size) {
+		CAT_DEBUG_EXCEPTION();
+		return false;
+	}
+
+	buildTable(num_syms, table_bits);
+
+	return true;
+}
@@ -0,0 +1,109 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CAT_ANS_DECODER_HPP
+#define CAT_ANS_DECODER_HPP
+
+#include "Platform.hpp"
+#include "ImageReader.hpp"
+#include "SmartArray.hpp"
+
+/*
+ * Table-based Asymmetric Numeral System (tANS) Decoder
+ *
+ * Decodes symbols written by ANSEncoder.hpp.
+ *
+ * Each table maps a state in [0, L) to a symbol, a number of bits to read
+ * and the base of the next state, so that decoding a symbol is a single
+ * table lookup plus a bit read.  Several tables may share one state as long
+ * as they have the same table size L, which is how the after-zero and
+ * before-zero tables of EntropyDecoder are used together.
+ *
+ * Symbols are interleaved over WAYS independent states: symbol i is decoded
+ * with state i % WAYS.  Each state only waits on the table lookup from WAYS
+ * symbols back, so the lookups for consecutive symbols can overlap, and the
+ * bits are still read in one fixed order from the shared bitstream.
+ *
+ * Table header:
+ *
+ * For each symbol the normalized frequency is written with an Exp-Golomb
+ * code.  A zero frequency is followed by another Exp-Golomb code for the
+ * number of additional symbols that also have zero frequency.  Frequencies
+ * must sum to L, or to zero for a table that is never used.
+ */
+
+namespace cat {
+
+
+//// ANSDecoder
+
+class ANSDecoder {
+public:
+	static const int MIN_TABLE_BITS = 5; // Smallest table L = 32
+	static const int MAX_TABLE_BITS = 12; // Largest table L = 4096
+	static const int TABLE_BITS_BITS = 3; // Bits used to write table bits - MIN_TABLE_BITS
+	static const int WAYS = 2; // Interleaved decoder states
+
+	struct Entry {
+		u16 sym;	// Decoded symbol
+		u16 base;	// Next state before adding read bits
+		u8 bits;	// Number of bits to read
+		u8 pad[3];
+	};
+
+protected:
+	SmartArray<Entry> _table;
+	SmartArray<u16> _next;
+
+	// Builds the decoding table from normalized frequencies in _next
+	void buildTable(int num_syms, int table_bits);
+
+public:
+	// Spread the symbols with these frequencies over the table
+	static CAT_INLINE u32 spreadStep(u32 table_size) {
+		return (table_size >> 1) + (table_size >> 3) + 3;
+	}
+
+	bool init(int num_syms, int table_bits, ImageReader &reader);
+
+	// Decode the next symbol and advance the given state
+	CAT_INLINE u32 next(u32 &state, ImageReader &reader) {
+		const Entry * CAT_RESTRICT entry = _table.get() + state;
+		const int bits = entry->bits;
+
+		state = entry->base + (u32)((u64)reader.peek(bits) >> (32 - bits));
+		reader.eat(bits);
+
+		return entry->sym;
+	}
+};
+
+
+} // namespace cat
+
+#endif // CAT_ANS_DECODER_HPP
@@ -49,6 +49,11 @@
  * and current residual is the Up one.  Internally the chaos calculator
  * will also do a table lookup to compute the number of bits set and
  * store that in the row data.
+ *
+ * The bin table is the same ramp for every number of levels, clamped at the
+ * top level.  So bins computed with many levels can be reduce()d to any
+ * smaller number of levels, which lets the encoder evaluate every level
+ * count from a single pass over the residuals.
  */
 
 namespace cat {
@@ -145,6 +150,11 @@ public:
 		return _table[_pixels[x-1] + (u16)_pixels[x]];
 	}
 
+	// Convert a bin from an instance with at least as many levels to this one
+	CAT_INLINE u8 reduce(u8 bin) {
+		return bin < _chaos_levels ? bin : (u8)(_chaos_levels - 1);
+	}
+
 	CAT_INLINE void store256(u16 x, u8 r) {
 		_pixels[x] = ResidualScore256(r);
 	}
@@ -247,6 +257,11 @@ public:
 		v = _table[(u16)(pixel + last)];
 	}
 
+	// Convert a bin from an instance with at least as many levels to this one
+	CAT_INLINE u8 reduce(u8 bin) {
+		return bin < _chaos_levels ? bin : (u8)(_chaos_levels - 1);
+	}
+
 	CAT_INLINE void store(u16 x, const u8 * CAT_RESTRICT yuv) {
 		u32 * CAT_RESTRICT pixels = (u32 *)&_pixels[x << 2];
 		*pixels = (ResidualScore(yuv[0]) << 24) | (ResidualScore(yuv[1]) << 16) | ResidualScore(yuv[2]);
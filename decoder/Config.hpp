@@ -37,10 +37,16 @@ namespace cat {
 
 // Disable dominant color mask in encoder
 //#define CAT_DISABLE_MASK
+
+// Allow the encoder to write tANS tables instead of Huffman tables when smaller
+#define CAT_ENABLE_ANS
 	
 // Unroll reader
 #define CAT_UNROLL_READER
 
+// Expand palette indices to RGBA with AVX2 gathers when the compiler targets AVX2
+#define CAT_PALETTE_GATHER
+
 // Dump filter choices
 //#define CAT_DUMP_FILTERS
 
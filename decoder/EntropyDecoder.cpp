@@ -26,31 +26,128 @@
 	POSSIBILITY OF SUCH DAMAGE.
 */
 #include "EntropyDecoder.hpp"
+#include "EntropyDictionary.hpp"
 using namespace cat;
 
-bool EntropyDecoder::init(int num_syms, int zrle_syms, int huff_lut_bits, ImageReader &reader) {
-	_num_syms = num_syms;
+bool EntropyDecoder::initDictionary(int num_syms, int zrle_syms, ImageReader &reader, bool &used) {
+	EntropyDictionary *dict = reader.getDictionary();
 
-	CAT_DEBUG_ENFORCE(num_syms > 0 && zrle_syms > 0);
+	used = false;
+
+	// If no dictionary is in use, no bits are spent on it
+	if (!dict) {
+		return true;
+	}
+
+	// If dictionary has no tables of this shape,
+	int first, count = dict->findTables(num_syms, zrle_syms, first);
+	if (count <= 0) {
+		return true;
+	}
+
+	// If table is sent explicitly,
+	if (!reader.readBit()) {
+		return true;
+	}
+
+	int index = 0;
+	const int index_bits = EntropyDictionary::indexBits(count);
+	if (index_bits > 0) {
+		index = reader.readBits(index_bits);
+
+		if CAT_UNLIKELY(index >= count) {
+			return false;
+		}
+	}
+
+	// Share the prebuilt decoders from the dictionary
+	EntropyDictionary::Table *table = dict->getTable(first + index);
+
+	if (table->zrle) {
+		_zrle_offset = zrle_syms - 1;
+		_az = &table->az;
+	}
+	_bz = &table->bz;
+
+	used = true;
+	return true;
+}
+
+bool EntropyDecoder::initANS(int num_syms, int zrle_syms, ImageReader &reader) {
+	const int zrle = reader.readBit();
+	const int table_bits = reader.readBits(ANSDecoder::TABLE_BITS_BITS) + ANSDecoder::MIN_TABLE_BITS;
 
 	// If using AZ symbols,
-	if (reader.readBit()) {
+	if (zrle) {
 		_zrle_offset = zrle_syms - 1;
 
-		if (!_az.init(num_syms, reader, huff_lut_bits)) {
+		if (!_az_ans.init(num_syms, table_bits, reader)) {
 			return false;
 		}
 
-		if (!_bz.init(num_syms + zrle_syms, reader, huff_lut_bits)) {
+		if (!_bz_ans.init(num_syms + zrle_syms, table_bits, reader)) {
 			return false;
 		}
 	} else {
-		// Cool: Does not slow down decoder to conditionally turn off zRLE!
-		if (!_bz.init(num_syms, reader, huff_lut_bits)) {
+		if (!_bz_ans.init(num_syms, table_bits, reader)) {
 			return false;
 		}
 	}
 
+	// Read initial states
+	for (int ii = 0; ii < ANSDecoder::WAYS; ++ii) {
+		_ans_states[ii] = reader.readBits(table_bits);
+	}
+
+	return true;
+}
+
+bool EntropyDecoder::init(int num_syms, int zrle_syms, int huff_lut_bits, ImageReader &reader) {
+	_num_syms = num_syms;
+
+	CAT_DEBUG_ENFORCE(num_syms > 0 && zrle_syms > 0);
+
+	bool from_dict;
+	if (!initDictionary(num_syms, zrle_syms, reader, from_dict)) {
+		return false;
+	}
+
+	_use_ans = false;
+
+	// If tables are stored in the image,
+	if (!from_dict) {
+		// Image-local tables defer their LUTs until the chaos bin is in use
+		_bz = &_bz_table;
+		_az = &_az_table;
+
+		// If ANS tables are used (not available in the original layout),
+		if (!reader.isLegacy() && reader.readBit()) {
+			_use_ans = true;
+
+			if (!initANS(num_syms, zrle_syms, reader)) {
+				return false;
+			}
+		} else {
+			// If using AZ symbols,
+			if (reader.readBit()) {
+				_zrle_offset = zrle_syms - 1;
+
+				if (!_az_table.init(num_syms, reader, huff_lut_bits, true)) {
+					return false;
+				}
+
+				if (!_bz_table.init(num_syms + zrle_syms, reader, huff_lut_bits, true)) {
+					return false;
+				}
+			} else {
+				// Cool: Does not slow down decoder to conditionally turn off zRLE!
+				if (!_bz_table.init(num_syms, reader, huff_lut_bits, true)) {
+					return false;
+				}
+			}
+		}
+	}
+
 	_afterZero = false;
 	_zeroRun = 0;
 
@@ -67,12 +164,16 @@ u16 EntropyDecoder::next(ImageReader &reader) {
 	// If after zero,
 	if (_afterZero) {
 		_afterZero = false;
-		return _az.next(reader);
+
+		if (_use_ans) {
+			return nextANS(_az_ans, reader);
+		}
+		return _az->next(reader);
 	}
 
 	// Read before-zero symbol
 	const int num_syms = _num_syms;
-	u16 sym = (u16)_bz.next(reader);
+	u16 sym = (u16)(_use_ans ? nextANS(_bz_ans, reader) : _bz->next(reader));
 
 	// If not a zero run,
 	if (sym < num_syms) {
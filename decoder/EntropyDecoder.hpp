@@ -30,6 +30,7 @@
 #define ENTROPY_DECODER_HPP
 
 #include "HuffmanDecoder.hpp"
+#include "ANSDecoder.hpp"
 #include "ImageReader.hpp"
 
 /*
@@ -56,13 +57,48 @@ public:
 
 protected:
 	int _zeroRun;
-	HuffmanDecoder _bz, _az;
+	HuffmanDecoder _bz_table, _az_table;
+	HuffmanDecoder *_bz, *_az;	// Point to the tables above or to dictionary tables
 	bool _afterZero;
 
+	// When ANS tables are used instead of Huffman tables:
+	bool _use_ans;
+	ANSDecoder _bz_ans, _az_ans;
+	u32 _ans_states[ANSDecoder::WAYS];	// Oldest first
+
+	bool initDictionary(int num_syms, int zrle_syms, ImageReader &reader, bool &used);
+	bool initANS(int num_syms, int zrle_syms, ImageReader &reader);
+
+	// Decode with the oldest state, which does not depend on the last symbols
+	CAT_INLINE u32 nextANS(ANSDecoder &decoder, ImageReader &reader) {
+		u32 state = _ans_states[0];
+
+		for (int ii = 1; ii < ANSDecoder::WAYS; ++ii) {
+			_ans_states[ii - 1] = _ans_states[ii];
+		}
+
+		const u32 sym = decoder.next(state, reader);
+		_ans_states[ANSDecoder::WAYS - 1] = state;
+
+		return sym;
+	}
+
 public:
 	bool init(int num_syms, int zrle_syms, int huff_lut_bits, ImageReader &reader);
 
 	u16 next(ImageReader &reader);
+
+	// Number of zeroes next() will return before reading the bitstream again
+	CAT_INLINE int pendingZeroes() const {
+		return _zeroRun;
+	}
+
+	// Consume one pending zero without going through next()
+	CAT_INLINE void skipZero() {
+		CAT_DEBUG_ENFORCE(_zeroRun > 0);
+
+		--_zeroRun;
+	}
 };
 
 } // namespace cat
@@ -0,0 +1,245 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "EntropyDictionary.hpp"
+#include "EndianNeutral.hpp"
+#include "Mutex.hpp"
+#include "GCIFReader.h"
+using namespace cat;
+
+
+//// EntropyDictionary
+
+void EntropyDictionary::clear() {
+	if (_tables) {
+		delete []_tables;
+		_tables = 0;
+	}
+	_table_count = 0;
+}
+
+int EntropyDictionary::init(const void * CAT_RESTRICT data, long bytes) {
+	const int HEAD_BYTES = 8;
+	const int TABLE_HEAD_BYTES = 5;
+
+	clear();
+
+	const u8 * CAT_RESTRICT in = reinterpret_cast<const u8 *>( data );
+
+	// Validate header
+	if CAT_UNLIKELY(!in || bytes < HEAD_BYTES) {
+		return GCIF_RE_BAD_DICT;
+	}
+
+	u32 magic = getLE(*reinterpret_cast<const u32 *>( in ));
+	if CAT_UNLIKELY(magic != HEAD_MAGIC) {
+		return GCIF_RE_BAD_DICT;
+	}
+
+	_id = in[4];
+	if CAT_UNLIKELY(_id <= 0) {
+		return GCIF_RE_BAD_DICT;
+	}
+
+	const int count = in[6] | ((int)in[7] << 8);
+
+	in += HEAD_BYTES;
+	bytes -= HEAD_BYTES;
+
+	_tables = new Table[count];
+	_table_count = count;
+
+	int last_num_syms = 0, last_zrle_syms = 0;
+
+	// For each table,
+	for (int ii = 0; ii < count; ++ii) {
+		Table *table = _tables + ii;
+
+		if CAT_UNLIKELY(bytes < TABLE_HEAD_BYTES) {
+			clear();
+			return GCIF_RE_BAD_DICT;
+		}
+
+		const int num_syms = in[0] | ((int)in[1] << 8);
+		const int zrle_syms = in[2] | ((int)in[3] << 8);
+		const bool zrle = in[4] != 0;
+
+		in += TABLE_HEAD_BYTES;
+		bytes -= TABLE_HEAD_BYTES;
+
+		// Shapes must be sorted so that lookups can be done by range
+		if CAT_UNLIKELY(num_syms < last_num_syms ||
+						(num_syms == last_num_syms && zrle_syms < last_zrle_syms)) {
+			clear();
+			return GCIF_RE_BAD_DICT;
+		}
+		last_num_syms = num_syms;
+		last_zrle_syms = zrle_syms;
+
+		const int bz_syms = zrle ? num_syms + zrle_syms : num_syms;
+		const int table_bytes = zrle ? num_syms + bz_syms : bz_syms;
+
+		if CAT_UNLIKELY(num_syms <= 0 || zrle_syms <= 0 ||
+						bz_syms > MAX_SYMS || bytes < table_bytes) {
+			clear();
+			return GCIF_RE_BAD_DICT;
+		}
+
+		// Validate codelens
+		for (int jj = 0; jj < table_bytes; ++jj) {
+			if CAT_UNLIKELY(in[jj] > HuffmanDecoder::MAX_CODE_SIZE) {
+				clear();
+				return GCIF_RE_BAD_DICT;
+			}
+		}
+
+		table->num_syms = static_cast<u16>( num_syms );
+		table->zrle_syms = static_cast<u16>( zrle_syms );
+		table->zrle = zrle;
+
+		// If using AZ symbols,
+		if (zrle) {
+			table->az_codelens.resize(num_syms);
+			memcpy(table->az_codelens.get(), in, num_syms);
+			in += num_syms;
+			bytes -= num_syms;
+
+			if CAT_UNLIKELY(!table->az.init(num_syms, table->az_codelens.get(), HUFF_LUT_BITS)) {
+				clear();
+				return GCIF_RE_BAD_DICT;
+			}
+		}
+
+		table->bz_codelens.resize(bz_syms);
+		memcpy(table->bz_codelens.get(), in, bz_syms);
+		in += bz_syms;
+		bytes -= bz_syms;
+
+		if CAT_UNLIKELY(!table->bz.init(bz_syms, table->bz_codelens.get(), HUFF_LUT_BITS)) {
+			clear();
+			return GCIF_RE_BAD_DICT;
+		}
+	}
+
+	return GCIF_RE_OK;
+}
+
+int EntropyDictionary::findTables(int num_syms, int zrle_syms, int &first) {
+	const Table *tables = _tables;
+	int count = 0;
+
+	// For each table,
+	for (int ii = 0, iiend = _table_count; ii < iiend; ++ii) {
+		// If shape matches,
+		if (tables[ii].num_syms == num_syms &&
+			tables[ii].zrle_syms == zrle_syms) {
+			if (count == 0) {
+				first = ii;
+			}
+			++count;
+		} else if (count > 0) {
+			break;
+		}
+	}
+
+	return count;
+}
+
+
+//// Registry
+
+static EntropyDictionary *m_registry[EntropyDictionary::MAX_ID + 1] = { 0 };
+static Mutex m_registry_lock;
+
+int EntropyDictionary::Register(const void * CAT_RESTRICT data, long bytes) {
+	int err;
+
+	EntropyDictionary *dict = new EntropyDictionary;
+
+	if ((err = dict->init(data, bytes))) {
+		delete dict;
+		return err;
+	}
+
+	const int id = dict->getID();
+
+	dict->_refs = 1;
+
+	m_registry_lock.Enter();
+	EntropyDictionary *old = m_registry[id];
+	m_registry[id] = dict;
+	m_registry_lock.Leave();
+
+	// If it replaced a dictionary, drop the registry reference to it
+	if (old) {
+		Release(old);
+	}
+
+	return GCIF_RE_OK;
+}
+
+void EntropyDictionary::Unregister(int id) {
+	if (id <= 0 || id > MAX_ID) {
+		return;
+	}
+
+	m_registry_lock.Enter();
+	EntropyDictionary *old = m_registry[id];
+	m_registry[id] = 0;
+	m_registry_lock.Leave();
+
+	if (old) {
+		Release(old);
+	}
+}
+
+EntropyDictionary *EntropyDictionary::Acquire(int id) {
+	if (id <= 0 || id > MAX_ID) {
+		return 0;
+	}
+
+	AutoMutex lock(m_registry_lock);
+
+	EntropyDictionary *dict = m_registry[id];
+	if (dict) {
+		++dict->_refs;
+	}
+
+	return dict;
+}
+
+void EntropyDictionary::Release(EntropyDictionary *dict) {
+	m_registry_lock.Enter();
+	const int refs = --dict->_refs;
+	m_registry_lock.Leave();
+
+	// If that was the last reference, it is no longer registered or in use
+	if (refs <= 0) {
+		delete dict;
+	}
+}
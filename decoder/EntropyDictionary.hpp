@@ -0,0 +1,155 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ENTROPY_DICTIONARY_HPP
+#define ENTROPY_DICTIONARY_HPP
+
+#include "Platform.hpp"
+#include "HuffmanDecoder.hpp"
+#include "SmartArray.hpp"
+#include "BitMath.hpp"
+
+/*
+ * Game Closure Shared Table Dictionary
+ *
+ * For tiny images, the Huffman tables written for each channel and chaos
+ * level can cost more bits than the pixels they describe, and building the
+ * decoder lookup tables dominates the decode time.
+ *
+ * A dictionary is a set of pre-trained Huffman tables that ships with the
+ * application.  Each image names the dictionary it was written against by an
+ * ID in its header, and each entropy table in the image may then reference a
+ * dictionary table by index instead of being transmitted.  The decoders for
+ * dictionary tables are built once when the dictionary is registered, so the
+ * image decoder skips table parsing and lookup table construction entirely.
+ *
+ * Tables are grouped by the (num_syms, zrle_syms) shape of the EntropyDecoder
+ * that may use them.  A shape with no tables in the dictionary costs no bits.
+ *
+ * File format (little-endian):
+ *
+ * <magic "GCID" (32 bits)>
+ * <dictionary ID (8 bits)> <reserved (8 bits)> <table count (16 bits)>
+ * For each table:
+ * 	<num_syms (16 bits)> <zrle_syms (16 bits)> <zRLE mode (8 bits)>
+ * 	If zRLE mode: <AZ codelens (num_syms bytes)> <BZ codelens (num_syms + zrle_syms bytes)>
+ * 	Else: <codelens (num_syms bytes)>
+ *
+ * Tables must be sorted by shape.
+ */
+
+namespace cat {
+
+
+//// EntropyDictionary
+
+class EntropyDictionary {
+public:
+	static const u32 HEAD_MAGIC = 0x44494347; // "GCID" (LE32)
+	static const int MAX_ID = 255;	// ID 0 is reserved to mean "no dictionary"
+	static const int HUFF_LUT_BITS = 7;	// Matches the EntropyDecoder users
+	static const int MAX_SYMS = 4096;	// Sanity limit for table size
+
+	struct Table {
+		u16 num_syms, zrle_syms;
+		bool zrle;
+
+		SmartArray<u8> az_codelens, bz_codelens;
+		HuffmanDecoder az, bz;
+	};
+
+protected:
+	int _id;
+	Table *_tables;
+	int _table_count;
+	int _refs;	// Held by the registry and by readers while registered
+
+	void clear();
+
+public:
+	CAT_INLINE EntropyDictionary() {
+		_tables = 0;
+		_table_count = 0;
+		_refs = 0;
+	}
+	CAT_INLINE virtual ~EntropyDictionary() {
+		clear();
+	}
+
+	// Parse the dictionary file and build all of its decoders
+	int init(const void * CAT_RESTRICT data, long bytes);
+
+	CAT_INLINE int getID() {
+		return _id;
+	}
+
+	CAT_INLINE int getTableCount() {
+		return _table_count;
+	}
+
+	CAT_INLINE Table *getTable(int index) {
+		return _tables + index;
+	}
+
+	// Find the tables for a shape.  Returns the number of tables found
+	int findTables(int num_syms, int zrle_syms, int &first);
+
+	// Number of bits used to select a table from a shape with count tables
+	static CAT_INLINE int indexBits(int count) {
+		return count > 1 ? BSR32(count - 1) + 1 : 0;
+	}
+
+
+	//// Registry
+
+	/*
+	 * The registry holds the dictionaries available to the reader and
+	 * writer by ID, and may be changed from any thread at any time.
+	 *
+	 * Entries are reference counted: Acquire() takes a reference that must
+	 * be given back with Release(), so replacing or removing a dictionary
+	 * only frees it once the last image using it is done.
+	 */
+
+	// Register dictionary data under its ID, replacing any previous one
+	static int Register(const void * CAT_RESTRICT data, long bytes);
+
+	// Remove a dictionary from the registry
+	static void Unregister(int id);
+
+	// Returns 0 if no dictionary is registered with the ID
+	static EntropyDictionary *Acquire(int id);
+
+	// Give back a dictionary returned by Acquire()
+	static void Release(EntropyDictionary *dict);
+};
+
+
+} // namespace cat
+
+#endif // ENTROPY_DICTIONARY_HPP
@@ -123,6 +123,13 @@ typedef const u8 *(*RGBAFilterFunc)(const u8 * CAT_RESTRICT p, u8 * CAT_RESTRICT
 
 struct RGBAFilterFuncs {
 	// Safe for any input that is actually on the image
+	//
+	// Edge predictions are part of the format, so they are not reproduced by
+	// decoding into a surface with a guard border.  The top row predicts
+	// from A, which is only known while that row is being decoded.
+	// SF_SELECT_F and SF_ED_GRAD switch predictors one and two pixels in
+	// from the edges, and their unsafe versions read the width as the row
+	// stride, so a padded stride would also move those switch points.
 	RGBAFilterFunc safe;
 
 	// Assumes that x>0, y>0, x<width-1
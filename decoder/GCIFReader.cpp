@@ -32,12 +32,18 @@
 #include "ImageMaskReader.hpp"
 #include "ImagePaletteReader.hpp"
 #include "ImageRGBAReader.hpp"
+#include "ImageGrayReader.hpp"
+#include "EntropyDictionary.hpp"
 #include "EndianNeutral.hpp"
+#include "PixelFormat.hpp"
+#include "StageTimer.hpp"
 #include <stdlib.h>
+#include <string.h>
 using namespace cat;
 
-static int gcif_read(ImageReader &reader, GCIFImage *image) {
+static int gcif_read(ImageReader &reader, GCIFImage *image, const PixelFormat &format, GCIFReadStats *stats) {
 	int err;
+	StageTimer timer;
 
 	// Fill in image xsize and ysize
 	ImageReader::Header *header = reader.getHeader();
@@ -52,9 +58,15 @@ static int gcif_read(ImageReader &reader, GCIFImage *image) {
 		return GCIF_RE_BAD_DIMS;
 	}
 
+	// Native output keeps the channel count, and RGB is packed once decoded
+	image->channels = 4;
+	if (format.native()) {
+		image->channels = header->channels;
+	}
+
 	// If we need to allocate memory for this image,
 	if (!image->rgba) {
-		u64 size = image->xsize * (u64)image->ysize * 4;
+		u64 size = image->xsize * (u64)image->ysize * (image->channels == 1 ? 1 : 4);
 
 		void *output;
 #ifdef posix_memalign
@@ -67,11 +79,28 @@ static int gcif_read(ImageReader &reader, GCIFImage *image) {
 		image->rgba = (u8 *)output;
 	}
 
+	// If the image is grayscale, it is all in one monochrome plane
+	if (header->channels == 1) {
+		ImageGrayReader imageGrayReader;
+		if ((err = imageGrayReader.read(reader, image, format, stats))) {
+			return err;
+		}
+		imageGrayReader.dumpStats();
+
+		return GCIF_RE_OK;
+	}
+
 	// Small Palette
 	SmallPaletteReader smallPaletteReader;
-	if ((err = smallPaletteReader.readHead(reader, image->rgba))) {
+	if (stats) {
+		timer.start(reader.getBitsRead());
+	}
+	if ((err = smallPaletteReader.readHead(reader, image->rgba, format))) {
 		return err;
 	}
+	if (stats) {
+		timer.stop(reader.getBitsRead(), stats->small_palette);
+	}
 
 	// If small palette is being used,
 	if (smallPaletteReader.enabled()) {
@@ -81,36 +110,60 @@ static int gcif_read(ImageReader &reader, GCIFImage *image) {
 
 			// Color Mask
 			ImageMaskReader imageMaskReader;
+			if (stats) {
+				timer.start(reader.getBitsRead());
+			}
 			if ((err = imageMaskReader.read(reader, 1, pack_x, pack_y))) {
 				return err;
 			}
+			if (stats) {
+				timer.stop(reader.getBitsRead(), stats->mask);
+			}
 			imageMaskReader.dumpStats();
 
 			// Finish reading small paletted image
+			if (stats) {
+				timer.start(reader.getBitsRead());
+			}
 			if ((err = smallPaletteReader.readTail(reader, imageMaskReader))) {
 				return err;
 			}
+			if (stats) {
+				timer.stop(reader.getBitsRead(), stats->small_palette);
+			}
 			smallPaletteReader.dumpStats();
 		}
 	} else {
 		// Color Mask
 		ImageMaskReader imageMaskReader;
+		if (stats) {
+			timer.start(reader.getBitsRead());
+		}
 		if ((err = imageMaskReader.read(reader, 4, image->xsize, image->ysize))) {
 			return err;
 		}
+		if (stats) {
+			timer.stop(reader.getBitsRead(), stats->mask);
+		}
 		imageMaskReader.dumpStats();
 
 		// Global Palette Decompression
 		ImagePaletteReader imagePaletteReader;
-		if ((err = imagePaletteReader.read(reader, imageMaskReader, image))) {
+		if (stats) {
+			timer.start(reader.getBitsRead());
+		}
+		if ((err = imagePaletteReader.read(reader, imageMaskReader, image, format))) {
 			return err;
 		}
+		if (stats) {
+			timer.stop(reader.getBitsRead(), stats->palette);
+		}
 		imagePaletteReader.dumpStats();
 
 		if (!imagePaletteReader.enabled()) {
-			// RGBA Decompression
+			// RGBA Decompression: Times its own tables, pixels and LZ stages
 			ImageRGBAReader imageRGBAReader;
-			if ((err = imageRGBAReader.read(reader, imageMaskReader, image))) {
+			if ((err = imageRGBAReader.read(reader, imageMaskReader, image, format, stats))) {
 				return err;
 			}
 			imageRGBAReader.dumpStats();
@@ -120,6 +173,229 @@ static int gcif_read(ImageReader &reader, GCIFImage *image) {
 	return GCIF_RE_OK;
 }
 
+
+
+//// Tiled images
+
+/*
+ * Tiled file format (little-endian 32-bit words):
+ *
+ * <magic "GCIT" or "GCIL"> <xsize> <ysize> <tile size>
+ * For each tile in row-major order:
+ * 	"GCIT": <offset of tile from start of file> <tile bytes>
+ * 	"GCIL": <offset low word> <offset high word> <tile bytes>
+ * For each tile: <GCIF image of the tile, word-aligned>
+ *
+ * Each tile is a complete image with its own mask, palette, filters, chaos
+ * and LZ state, so any tile can be decoded without touching the others.
+ *
+ * The "GCIL" large-image variant has 64-bit offsets, so the file may be
+ * larger than 4 GB, and allows dimensions up to MAX_LARGE_SIZE.
+ */
+
+struct TiledHeader {
+	u32 xsize, ysize;
+	u32 tile_size;
+	u32 tiles_x, tiles_y;
+	bool large;
+	const u32 *index;
+};
+
+static bool gcif_is_tiled(const void *file_data_in, long file_size_bytes_in) {
+	if (!file_data_in || file_size_bytes_in < 4) {
+		return false;
+	}
+
+	const u32 *words = reinterpret_cast<const u32 *>( file_data_in );
+	const u32 magic = getLE(words[0]);
+	return magic == ImageReader::TILED_MAGIC || magic == ImageReader::LARGE_MAGIC;
+}
+
+static int gcif_read_tiled_header(const void *file_data_in, long file_size_bytes_in, TiledHeader *header) {
+	const int HEAD_WORDS = 4;
+
+	if (file_size_bytes_in < HEAD_WORDS * 4) {
+		return GCIF_RE_BAD_HEAD;
+	}
+
+	const u32 *words = reinterpret_cast<const u32 *>( file_data_in );
+	const u32 magic = getLE(words[0]);
+	if (magic == ImageReader::TILED_MAGIC) {
+		header->large = false;
+	} else if (magic == ImageReader::LARGE_MAGIC) {
+		header->large = true;
+	} else {
+		return GCIF_RE_BAD_HEAD;
+	}
+
+	header->xsize = getLE(words[1]);
+	header->ysize = getLE(words[2]);
+	header->tile_size = getLE(words[3]);
+
+	const u32 max_size = header->large ? ImageReader::MAX_LARGE_SIZE : ImageReader::MAX_TILED_SIZE;
+
+	// Validate dimensions
+	if (header->xsize > max_size ||
+		header->ysize > max_size ||
+		header->tile_size < ImageReader::MIN_TILE_SIZE ||
+		header->tile_size > ImageReader::MAX_X ||
+		header->tile_size > ImageReader::MAX_Y) {
+		return GCIF_RE_BAD_DIMS;
+	}
+
+	header->tiles_x = (header->xsize + header->tile_size - 1) / header->tile_size;
+	header->tiles_y = (header->ysize + header->tile_size - 1) / header->tile_size;
+	header->index = words + HEAD_WORDS;
+
+	// Validate index length
+	const int tile_words = header->large ? 3 : 2;
+	const u64 index_words = (u64)header->tiles_x * header->tiles_y * tile_words;
+	if (index_words > (u64)(file_size_bytes_in / 4 - HEAD_WORDS)) {
+		return GCIF_RE_BAD_HEAD;
+	}
+
+	return GCIF_RE_OK;
+}
+
+// Decode the tiles covering a rectangle into an output buffer of w*h pixels
+static int gcif_read_tiles(const void *file_data_in, long file_size_bytes_in, const TiledHeader &header, int x, int y, int w, int h, u8 *rgba, GCIFReadStats *stats) {
+	const u8 *data = reinterpret_cast<const u8 *>( file_data_in );
+	const int tile_size = header.tile_size;
+	int err;
+
+	// Scratch space reused for each tile
+	SmartArray<u8> tile_rgba;
+	tile_rgba.resize(tile_size * tile_size * 4);
+
+	const int tx0 = x / tile_size, tx1 = (x + w - 1) / tile_size;
+	const int ty0 = y / tile_size, ty1 = (y + h - 1) / tile_size;
+
+	// For each covering tile,
+	for (int ty = ty0; ty <= ty1; ++ty) {
+		for (int tx = tx0; tx <= tx1; ++tx) {
+			const u64 tile_index = (u64)ty * header.tiles_x + tx;
+			u64 offset;
+			u32 bytes;
+
+			if (header.large) {
+				const u32 *entry = header.index + tile_index * 3;
+				offset = getLE(entry[0]) | ((u64)getLE(entry[1]) << 32);
+				bytes = getLE(entry[2]);
+			} else {
+				const u32 *entry = header.index + tile_index * 2;
+				offset = getLE(entry[0]);
+				bytes = getLE(entry[1]);
+			}
+
+			if (offset > (u64)file_size_bytes_in ||
+				bytes > (u64)file_size_bytes_in - offset ||
+				(offset & 3)) {
+				return GCIF_RE_BAD_DATA;
+			}
+
+			// Tiles on the right and bottom edges may be smaller
+			const int x0 = tx * tile_size, y0 = ty * tile_size;
+
+			GCIFImage tile;
+			tile.rgba = tile_rgba.get();
+			tile.xsize = header.xsize - x0 < (u32)tile_size ? header.xsize - x0 : tile_size;
+			tile.ysize = header.ysize - y0 < (u32)tile_size ? header.ysize - y0 : tile_size;
+
+			ImageReader reader;
+			if ((err = reader.init(data + offset, bytes))) {
+				return err;
+			}
+
+			if ((err = gcif_read(reader, &tile, PixelFormat(), stats))) {
+				return err;
+			}
+
+			// Copy the overlap with the requested rectangle
+			const int cx0 = x0 > x ? x0 : x;
+			const int cx1 = x0 + tile.xsize < x + w ? x0 + tile.xsize : x + w;
+			const int cy0 = y0 > y ? y0 : y;
+			const int cy1 = y0 + tile.ysize < y + h ? y0 + tile.ysize : y + h;
+			const int copy_bytes = (cx1 - cx0) * 4;
+
+			for (int cy = cy0; cy < cy1; ++cy) {
+				const u8 *src = tile.rgba + ((cy - y0) * tile.xsize + (cx0 - x0)) * 4;
+				u8 *dst = rgba + ((u64)(cy - y) * w + (cx0 - x)) * 4;
+
+				memcpy(dst, src, copy_bytes);
+			}
+		}
+	}
+
+	return GCIF_RE_OK;
+}
+
+static int gcif_read_region_stats(const void *file_data_in, long file_size_bytes_in, int x, int y, int w, int h, GCIFImage *image_out, GCIFReadStats *stats) {
+	int err;
+
+	// Initialize image data
+	image_out->rgba = 0;
+	image_out->xsize = -1;
+	image_out->ysize = -1;
+
+	if (x < 0 || y < 0 || w <= 0 || h <= 0) {
+		return GCIF_RE_BAD_DIMS;
+	}
+
+	// If the file is not tiled,
+	if (!gcif_is_tiled(file_data_in, file_size_bytes_in)) {
+		// Decode the whole image and crop it in place
+		GCIFImage full;
+		if ((err = gcif_read_memory(file_data_in, file_size_bytes_in, &full))) {
+			return err;
+		}
+
+		if ((u64)x + w > (u64)full.xsize || (u64)y + h > (u64)full.ysize) {
+			free(full.rgba);
+			return GCIF_RE_BAD_DIMS;
+		}
+
+		for (int row = 0; row < h; ++row) {
+			memmove(full.rgba + (size_t)row * w * 4, full.rgba + ((size_t)(y + row) * full.xsize + x) * 4, (size_t)w * 4);
+		}
+
+		image_out->rgba = full.rgba;
+		image_out->xsize = w;
+		image_out->ysize = h;
+		image_out->channels = 4;
+		return GCIF_RE_OK;
+	}
+
+	TiledHeader header;
+	if ((err = gcif_read_tiled_header(file_data_in, file_size_bytes_in, &header))) {
+		return err;
+	}
+
+	if ((u64)x + w > header.xsize || (u64)y + h > header.ysize) {
+		return GCIF_RE_BAD_DIMS;
+	}
+
+	u8 *rgba = (u8 *)malloc(w * (u64)h * 4);
+	if (!rgba) {
+		return GCIF_RE_BAD_DIMS;
+	}
+
+	if ((err = gcif_read_tiles(file_data_in, file_size_bytes_in, header, x, y, w, h, rgba, stats))) {
+		free(rgba);
+		return err;
+	}
+
+	image_out->rgba = rgba;
+	image_out->xsize = w;
+	image_out->ysize = h;
+	image_out->channels = 4;
+	return GCIF_RE_OK;
+}
+
+extern "C" int gcif_read_region(const void *file_data_in, long file_size_bytes_in, int x, int y, int w, int h, GCIFImage *image_out) {
+	return gcif_read_region_stats(file_data_in, file_size_bytes_in, x, y, w, h, image_out, 0);
+}
+
+
 #ifdef CAT_COMPILE_MMAP
 
 extern "C" int gcif_read_file(const char *input_file_path_in, GCIFImage *image_out) {
@@ -130,17 +406,24 @@ extern "C" int gcif_read_file(const char *input_file_path_in, GCIFImage *image_o
 	image_out->xsize = -1;
 	image_out->ysize = -1;
 
-	// Initialize image reader
-	ImageReader reader;
-	if ((err = reader.init(input_file_path_in))) {
-		return err;
+	// Map file for reading
+	MappedFile file;
+	if CAT_UNLIKELY(!file.OpenRead(input_file_path_in)) {
+		return GCIF_RE_FILE;
 	}
 
-	if ((err = gcif_read(reader, image_out))) {
-		if (image_out->rgba) {
-			free(image_out->rgba);
-			image_out->rgba = 0;
-		}
+	MappedView fileView;
+	if CAT_UNLIKELY(!fileView.Open(&file)) {
+		return GCIF_RE_FILE;
+	}
+
+	u8 * CAT_RESTRICT fileData = fileView.MapView();
+	if CAT_UNLIKELY(!fileData) {
+		return GCIF_RE_FILE;
+	}
+
+	// Run from memory
+	if ((err = gcif_read_memory(fileData, fileView.GetLength(), image_out))) {
 		return err;
 	}
 
@@ -150,6 +433,20 @@ extern "C" int gcif_read_file(const char *input_file_path_in, GCIFImage *image_o
 #endif // CAT_COMPILE_MMAP
 
 extern "C" int gcif_get_size(const void *file_data_in, long file_size_bytes_in, int *xsize, int *ysize) {
+	// If the file is tiled,
+	if (gcif_is_tiled(file_data_in, file_size_bytes_in)) {
+		int err;
+
+		TiledHeader header;
+		if ((err = gcif_read_tiled_header(file_data_in, file_size_bytes_in, &header))) {
+			return err;
+		}
+
+		*xsize = header.xsize;
+		*ysize = header.ysize;
+		return GCIF_RE_OK;
+	}
+
 	// Validate length
 	if (file_size_bytes_in < 8) {
 		return GCIF_RE_BAD_HEAD;
@@ -158,7 +455,7 @@ extern "C" int gcif_get_size(const void *file_data_in, long file_size_bytes_in,
 	// Validate signature
 	const u32 *head_word = reinterpret_cast<const u32 *>( file_data_in );
 	u32 sig = getLE(head_word[0]);
-	if (sig != ImageReader::HEAD_MAGIC) {
+	if (sig != ImageReader::HEAD_MAGIC && sig != ImageReader::CHANNELS_MAGIC) {
 		return GCIF_RE_BAD_HEAD;
 	}
 
@@ -179,16 +476,36 @@ extern "C" int gcif_sig_cmp(const void *file_data_in, long file_size_bytes_in) {
 	// Validate signature
 	const u32 *head_word = reinterpret_cast<const u32 *>( file_data_in );
 	u32 sig = getLE(head_word[0]);
-	if (sig != ImageReader::HEAD_MAGIC) {
+	if (sig != ImageReader::HEAD_MAGIC && sig != ImageReader::CHANNELS_MAGIC &&
+		sig != ImageReader::TILED_MAGIC && sig != ImageReader::LARGE_MAGIC) {
 		return GCIF_RE_BAD_HEAD;
 	}
 
 	return GCIF_RE_OK;
 }
 
-extern "C" int gcif_read_memory(const void *file_data_in, long file_size_bytes_in, GCIFImage *image_out) {
+static int gcif_read_memory_format(const void *file_data_in, long file_size_bytes_in, const PixelFormat &format, GCIFImage *image_out, GCIFReadStats *stats) {
 	int err;
 
+	// If the file is tiled, decode all of the tiles
+	if (gcif_is_tiled(file_data_in, file_size_bytes_in)) {
+		int xsize, ysize;
+		if ((err = gcif_get_size(file_data_in, file_size_bytes_in, &xsize, &ysize))) {
+			return err;
+		}
+
+		if ((err = gcif_read_region_stats(file_data_in, file_size_bytes_in, 0, 0, xsize, ysize, image_out, stats))) {
+			return err;
+		}
+
+		// Tiles are assembled in RGBA, so convert afterwards
+		if (!format.passthrough()) {
+			format.convertRows(image_out->rgba, xsize, 0, ysize);
+		}
+
+		return GCIF_RE_OK;
+	}
+
 	// Initialize image data
 	image_out->rgba = 0;
 	image_out->xsize = -1;
@@ -200,7 +517,7 @@ extern "C" int gcif_read_memory(const void *file_data_in, long file_size_bytes_i
 		return err;
 	}
 
-	if ((err = gcif_read(reader, image_out))) {
+	if ((err = gcif_read(reader, image_out, format, stats))) {
 		if (image_out->rgba) {
 			free(image_out->rgba);
 			image_out->rgba = 0;
@@ -208,12 +525,68 @@ extern "C" int gcif_read_memory(const void *file_data_in, long file_size_bytes_i
 		return err;
 	}
 
+	// If native RGB output is requested, pack it and return the spare memory
+	if (image_out->channels == 3) {
+		PixelFormat::packRGB(image_out->rgba, image_out->xsize, 0, image_out->ysize);
+
+		void *packed = realloc(image_out->rgba, image_out->xsize * (u64)image_out->ysize * 3);
+		if (packed) {
+			image_out->rgba = (u8 *)packed;
+		}
+	}
+
 	return GCIF_RE_OK;
 }
 
+extern "C" int gcif_read_memory(const void *file_data_in, long file_size_bytes_in, GCIFImage *image_out) {
+	return gcif_read_memory_format(file_data_in, file_size_bytes_in, PixelFormat(), image_out, 0);
+}
+
+extern "C" int gcif_read_memory_ex(const void *file_data_in, long file_size_bytes_in, int format_flags, GCIFImage *image_out) {
+	return gcif_read_ex(file_data_in, file_size_bytes_in, format_flags, image_out, 0);
+}
+
+extern "C" int gcif_read_ex(const void *file_data_in, long file_size_bytes_in, int format_flags, GCIFImage *image_out, GCIFReadStats *stats_out) {
+	PixelFormat format;
+	if (!format.init(format_flags)) {
+		return GCIF_RE_BAD_FORMAT;
+	}
+
+	// If not collecting stats,
+	if (!stats_out) {
+		return gcif_read_memory_format(file_data_in, file_size_bytes_in, format, image_out, 0);
+	}
+
+	CAT_OBJCLR(*stats_out);
+
+	const u64 t0 = StageTimer::nsec();
+
+	const int err = gcif_read_memory_format(file_data_in, file_size_bytes_in, format, image_out, stats_out);
+
+	stats_out->total_nsec = StageTimer::nsec() - t0;
+
+	return err;
+}
+
 extern "C" int gcif_read_memory_to_buffer(const void *file_data_in, long file_size_bytes_in, GCIFImage *image_out) {
 	int err;
 
+	// If the file is tiled, decode all of the tiles
+	if (gcif_is_tiled(file_data_in, file_size_bytes_in)) {
+		TiledHeader header;
+		if ((err = gcif_read_tiled_header(file_data_in, file_size_bytes_in, &header))) {
+			return err;
+		}
+
+		if ((u32)image_out->xsize != header.xsize ||
+			(u32)image_out->ysize != header.ysize ||
+			!image_out->rgba) {
+			return GCIF_RE_BAD_DIMS;
+		}
+
+		return gcif_read_tiles(file_data_in, file_size_bytes_in, header, 0, 0, header.xsize, header.ysize, image_out->rgba, 0);
+	}
+
 	// Initialize image reader
 	ImageReader reader;
 	if ((err = reader.init(file_data_in, file_size_bytes_in))) {
@@ -222,7 +595,190 @@ extern "C" int gcif_read_memory_to_buffer(const void *file_data_in, long file_si
 
 	// Note: Allowing RGBA pointer to fall through and do not free it on error.
 
-	return gcif_read(reader, image_out);
+	return gcif_read(reader, image_out, PixelFormat(), 0);
+}
+
+
+
+//// Collections
+
+/*
+ * Collection file format (little-endian 32-bit words):
+ *
+ * <magic "GCIC"> <entry count> <dictionary bytes>
+ * <dictionary data, padded to a word>
+ * For each entry:
+ * 	<offset of image from start of file> <image bytes> <name bytes>
+ * 	<name, padded to a word>
+ * For each entry: <GCIF image written against the dictionary, word-aligned>
+ */
+
+struct _GCIFCollection {
+	struct Entry {
+		const u8 *data;
+		u32 bytes;
+		int name_offset;
+	};
+
+	EntropyDictionary dict;
+	SmartArray<Entry> entries;
+	int count;
+	SmartArray<char> names;
+};
+
+extern "C" int gcif_open_collection(const void *file_data_in, long file_size_bytes_in, GCIFCollection **collection_out) {
+	const int HEAD_WORDS = 3;
+	const int ENTRY_WORDS = 3;
+
+	*collection_out = 0;
+
+	if (!file_data_in || file_size_bytes_in < HEAD_WORDS * 4) {
+		return GCIF_RE_BAD_HEAD;
+	}
+
+	const u8 *data = reinterpret_cast<const u8 *>( file_data_in );
+	const u32 *words = reinterpret_cast<const u32 *>( data );
+	const u32 file_bytes = (u32)file_size_bytes_in;
+
+	if (getLE(words[0]) != ImageReader::COLLECTION_MAGIC) {
+		return GCIF_RE_BAD_HEAD;
+	}
+
+	const u32 count = getLE(words[1]);
+	const u32 dict_bytes = getLE(words[2]);
+
+	u32 offset = HEAD_WORDS * 4;
+	if (dict_bytes > file_bytes - offset) {
+		return GCIF_RE_BAD_HEAD;
+	}
+
+	GCIFCollection *collection = new GCIFCollection;
+	collection->count = 0;
+
+	int err;
+
+	// Build the shared table decoders once for all entries
+	if ((err = collection->dict.init(data + offset, dict_bytes))) {
+		delete collection;
+		return err;
+	}
+
+	offset += (dict_bytes + 3) & ~3;
+
+	// Validate the index before allocating for it
+	if (count > (file_bytes - offset) / (ENTRY_WORDS * 4)) {
+		delete collection;
+		return GCIF_RE_BAD_HEAD;
+	}
+
+	collection->entries.resize(count);
+	collection->count = count;
+	collection->names.resize(file_bytes - offset + count);
+
+	int names_used = 0;
+
+	// For each entry,
+	for (u32 ii = 0; ii < count; ++ii) {
+		if (offset + ENTRY_WORDS * 4 > file_bytes) {
+			gcif_close_collection(collection);
+			return GCIF_RE_BAD_HEAD;
+		}
+
+		const u32 *entry_words = reinterpret_cast<const u32 *>( data + offset );
+		const u32 image_offset = getLE(entry_words[0]);
+		const u32 image_bytes = getLE(entry_words[1]);
+		const u32 name_bytes = getLE(entry_words[2]);
+		offset += ENTRY_WORDS * 4;
+
+		if (name_bytes > file_bytes - offset ||
+			image_offset > file_bytes || image_bytes > file_bytes - image_offset ||
+			(image_offset & 3)) {
+			gcif_close_collection(collection);
+			return GCIF_RE_BAD_HEAD;
+		}
+
+		GCIFCollection::Entry *entry = &collection->entries[ii];
+		entry->data = data + image_offset;
+		entry->bytes = image_bytes;
+		entry->name_offset = names_used;
+
+		// Copy name with terminator
+		memcpy(&collection->names[names_used], data + offset, name_bytes);
+		names_used += name_bytes;
+		collection->names[names_used++] = '\0';
+
+		offset += (name_bytes + 3) & ~3;
+	}
+
+	*collection_out = collection;
+	return GCIF_RE_OK;
+}
+
+extern "C" int gcif_collection_count(GCIFCollection *collection) {
+	return collection->count;
+}
+
+extern "C" const char *gcif_collection_entry_name(GCIFCollection *collection, int index) {
+	if (index < 0 || index >= collection->count) {
+		return 0;
+	}
+
+	return &collection->names[collection->entries[index].name_offset];
+}
+
+extern "C" int gcif_find_collection_entry(GCIFCollection *collection, const char *name) {
+	for (int ii = 0, iiend = collection->count; ii < iiend; ++ii) {
+		if (!strcmp(&collection->names[collection->entries[ii].name_offset], name)) {
+			return ii;
+		}
+	}
+
+	return -1;
+}
+
+extern "C" int gcif_read_collection_entry(GCIFCollection *collection, int index, GCIFImage *image_out) {
+	int err;
+
+	if (index < 0 || index >= collection->count) {
+		return GCIF_RE_BAD_DATA;
+	}
+
+	const GCIFCollection::Entry *entry = &collection->entries[index];
+
+	// Initialize image data
+	image_out->rgba = 0;
+	image_out->xsize = -1;
+	image_out->ysize = -1;
+
+	// Initialize image reader with the collection's shared tables
+	ImageReader reader;
+	if ((err = reader.init(entry->data, entry->bytes, &collection->dict))) {
+		return err;
+	}
+
+	if ((err = gcif_read(reader, image_out, PixelFormat(), 0))) {
+		if (image_out->rgba) {
+			free(image_out->rgba);
+			image_out->rgba = 0;
+		}
+		return err;
+	}
+
+	return GCIF_RE_OK;
+}
+
+extern "C" void gcif_close_collection(GCIFCollection *collection) {
+	if (collection) {
+		delete collection;
+	}
+}
+
+extern "C" int gcif_set_dictionary(const void *dict_data_in, long dict_size_bytes_in) {
+	return EntropyDictionary::Register(dict_data_in, dict_size_bytes_in);
+}
+
+extern "C" void gcif_clear_dictionary(int dict_id) {
+	EntropyDictionary::Unregister(dict_id);
 }
 
 extern "C" const char *gcif_read_errstr(int err) {
@@ -260,6 +816,14 @@ extern "C" const char *gcif_read_errstr(int err) {
 		case GCIF_RE_BAD_RGBA:		// Bad data in RGBA section
 			return "Corrupted:GCIF_RE_BAD_RGBA";
 
+		case GCIF_RE_BAD_DICT:		// Bad shared table dictionary data
+			return "Bad dictionary:GCIF_RE_BAD_DICT";
+		case GCIF_RE_NO_DICT:		// Image needs a dictionary that is not registered
+			return "Missing dictionary:GCIF_RE_NO_DICT";
+
+		case GCIF_RE_BAD_FORMAT:	// Unsupported output format flags
+			return "Bad output format:GCIF_RE_BAD_FORMAT";
+
 		default:
 			break;
 	}
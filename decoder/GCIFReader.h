@@ -55,6 +55,11 @@ enum GCIFReaderErrors {
 	GCIF_RE_BAD_MONO,	// Bad data in Monochrome section
 
 	GCIF_RE_BAD_RGBA,	// Bad data in RGBA section
+
+	GCIF_RE_BAD_DICT,	// Bad shared table dictionary data
+	GCIF_RE_NO_DICT,	// Image needs a dictionary that is not registered
+
+	GCIF_RE_BAD_FORMAT,	// Unsupported output format flags
 };
 
 // Returns a string representation of the above error codes
@@ -65,9 +70,50 @@ const char *gcif_read_errstr(int err);
 typedef struct _GCIFImage {
 	unsigned char *rgba;	// RGBA pixels.  Free with free(i.rgba); when done.
 	int xsize, ysize;		// Dimensions in pixels
+	int channels;			// Bytes per pixel in rgba: 4 unless GCIF_FMT_NATIVE is used
 } GCIFImage;
 
 
+// Output format flags for gcif_read_memory_ex()
+enum GCIFReaderFormats {
+	GCIF_FMT_RGBA = 0,			// Default: R, G, B, A bytes
+
+	GCIF_FMT_PREMULTIPLY = 1,	// Scale R, G, B by alpha
+	GCIF_FMT_BGRA = 2,			// Swap R and B
+
+	// 16-bit pixels in native byte order, first channel in the high bits.
+	// At most one of these may be set:
+	GCIF_FMT_RGBA4444 = 4,		// 4:4:4:4 bits
+	GCIF_FMT_RGB565 = 8,		// 5:6:5 bits, alpha is dropped
+
+	// Deliver images written by gcif_write_channels() with the channel count
+	// they were written with: 1 (gray), 3 (RGB) or 4 bytes per pixel, as
+	// reported in GCIFImage channels.  Cannot be combined with other flags.
+	// RGBA images with 255 alpha everywhere are stored as RGB.
+	// Tiled images are always delivered as RGBA
+	GCIF_FMT_NATIVE = 16,
+};
+
+
+// Time and size of one coding stage
+typedef struct _GCIFStageStats {
+	unsigned long long nsec;	// Wall time in nanoseconds
+	unsigned long long bytes;	// Compressed bytes read or written
+} GCIFStageStats;
+
+// Per-stage decode statistics for gcif_read_ex().  Stages that did not run
+// are left at zero.  Tiled files sum the stages over all tiles.
+typedef struct _GCIFReadStats {
+	GCIFStageStats mask;			// Dominant color mask
+	GCIFStageStats small_palette;	// Small palette colors and pixels
+	GCIFStageStats palette;			// Global palette colors, tables and pixels
+	GCIFStageStats tables;			// RGBA filter and entropy tables
+	GCIFStageStats pixels;			// RGBA pixels, including the LZ copies below
+	GCIFStageStats lz;				// RGBA LZ copies; bytes are output bytes copied
+	unsigned long long total_nsec;	// Whole call
+} GCIFReadStats;
+
+
 // Compiled optionally
 #ifdef CAT_COMPILE_MMAP
 
@@ -104,6 +150,30 @@ int gcif_read_file(const char *input_file_path_in, GCIFImage *image_out);
  */
 int gcif_read_memory(const void *file_data_in, long file_size_bytes_in, GCIFImage *image_out);
 
+/*
+ * gcif_read_memory_ex()
+ *
+ * Same as gcif_read_memory(), but the pixels are delivered in the format
+ * selected by GCIF_FMT_* flags.  Conversion is done by the decoder as each
+ * scanline is finished, and palette images convert their palette instead.
+ *
+ * For the 16-bit formats the rgba buffer is still allocated at 4 bytes per
+ * pixel, and the xsize * ysize 16-bit pixels are packed at its start.
+ *
+ * Returns GCIF_RE_BAD_FORMAT if the flag combination is not supported.
+ */
+int gcif_read_memory_ex(const void *file_data_in, long file_size_bytes_in, int format_flags, GCIFImage *image_out);
+
+/*
+ * gcif_read_ex()
+ *
+ * Same as gcif_read_memory_ex(), and also fills in the time and compressed
+ * size of each decoder stage when stats_out is not null.
+ *
+ * Passing null for stats_out skips all of the timing.
+ */
+int gcif_read_ex(const void *file_data_in, long file_size_bytes_in, int format_flags, GCIFImage *image_out, GCIFReadStats *stats_out);
+
 /*
  * gcif_read_memory_to_buffer()
  *
@@ -119,6 +189,22 @@ int gcif_read_memory(const void *file_data_in, long file_size_bytes_in, GCIFImag
  */
 int gcif_read_memory_to_buffer(const void *file_data_in, long file_size_bytes_in, GCIFImage *image_out);
 
+/*
+ * gcif_read_region()
+ *
+ * Read just the w x h pixel rectangle at (x, y) from the image in the given
+ * memory buffer, such as one sprite out of a large atlas.
+ *
+ * For images written with gcif_write_tiled() only the tiles that cover the
+ * rectangle are decoded.  Other images are decoded in full and then cropped.
+ *
+ * The rectangle must lie within the image, or GCIF_RE_BAD_DIMS is returned.
+ *
+ * On success, image_out holds the w x h rectangle and you are responsible for
+ * freeing the rgba pointer with free(i.rgba);
+ */
+int gcif_read_region(const void *file_data_in, long file_size_bytes_in, int x, int y, int w, int h, GCIFImage *image_out);
+
 /*
  * gcif_get_size()
  *
@@ -138,6 +224,84 @@ int gcif_get_size(const void *file_data_in, long file_size_bytes_in, int *xsize,
  */
 int gcif_sig_cmp(const void *file_data_in, long file_size_bytes_in);
 
+/*
+ * gcif_set_dictionary()
+ *
+ * Register a shared table dictionary, as produced by `gcif --train`.
+ *
+ * Images written against a dictionary reference pre-trained Huffman tables
+ * from it by ID instead of storing their own tables, which helps tiny images
+ * like icons.  Reading such an image requires the same dictionary to be
+ * registered first.  The dictionary ID is stored in the data, and registering
+ * a new dictionary with the same ID replaces the old one.
+ *
+ * The data is copied, so the buffer can be freed after this returns.
+ *
+ * This function is thread-safe.  Images being read or written against a
+ * dictionary that is replaced keep using the old one until they finish.
+ *
+ * Returns GCIF_RE_OK on success, or GCIF_RE_BAD_DICT if the data is bad.
+ */
+int gcif_set_dictionary(const void *dict_data_in, long dict_size_bytes_in);
+
+/*
+ * gcif_clear_dictionary()
+ *
+ * Unregister the shared table dictionary with the given ID.  It is freed once
+ * no image being read or written is still using it.
+ *
+ * This function is thread-safe.
+ */
+void gcif_clear_dictionary(int dict_id);
+
+
+
+//// Collections
+
+/*
+ * A collection holds many related images, such as the sprite-sheets for a
+ * game, in one file written by gcif_write_collection().  The Huffman tables
+ * the images have in common are stored once in a shared table dictionary,
+ * and the decoders for those tables are built once when the collection is
+ * opened and then reused for every entry that is read.
+ *
+ * Entries can be read in any order by index, or looked up by name.
+ */
+typedef struct _GCIFCollection GCIFCollection;
+
+/*
+ * gcif_open_collection()
+ *
+ * Open a collection from the given memory buffer, which must remain valid
+ * until the collection is closed.
+ *
+ * On success it returns GCIF_RE_OK and sets collection_out, which must be
+ * released with gcif_close_collection().
+ */
+int gcif_open_collection(const void *file_data_in, long file_size_bytes_in, GCIFCollection **collection_out);
+
+// Number of entries in the collection
+int gcif_collection_count(GCIFCollection *collection);
+
+// Returns the index of the named entry, or -1 if it is not found
+int gcif_find_collection_entry(GCIFCollection *collection, const char *name);
+
+// Returns the name of an entry, or 0 if the index is out of range
+const char *gcif_collection_entry_name(GCIFCollection *collection, int index);
+
+/*
+ * gcif_read_collection_entry()
+ *
+ * Read the entry at the given index.  Behaves like gcif_read_memory(), and
+ * you are responsible for freeing the rgba pointer with free(i.rgba);
+ *
+ * This function is thread-safe for different images of the same collection.
+ */
+int gcif_read_collection_entry(GCIFCollection *collection, int index, GCIFImage *image_out);
+
+// Release the collection
+void gcif_close_collection(GCIFCollection *collection);
+
 
 #ifdef __cplusplus
 };
@@ -35,8 +35,8 @@ using namespace cat;
 
 //// HuffmanDecoder
 
-bool HuffmanDecoder::init(int count, const u8 * CAT_RESTRICT codelens, u32 table_bits) {
-	u32 min_codes[MAX_CODE_SIZE];
+bool HuffmanDecoder::init(int count, const u8 * CAT_RESTRICT codelens, u32 table_bits, bool defer_table) {
+	u32 * CAT_RESTRICT min_codes = _min_codes;
 
 	if (count <= 0 || (table_bits > MAX_TABLE_BITS)) {
 		CAT_DEBUG_EXCEPTION();
@@ -134,83 +134,99 @@ bool HuffmanDecoder::init(int count, const u8 * CAT_RESTRICT codelens, u32 table
 
 	_table_bits = table_bits;
 
+	// sentinels
+	_max_codes[MAX_CODE_SIZE] = 0xffffffff;
+	_val_ptrs[MAX_CODE_SIZE] = 0xFFFFF;
+
+	for (u32 ii = 0; ii < MAX_CODE_SIZE; ++ii) {
+		_val_ptrs[ii] -= min_codes[ii];
+	}
+
+	// Until the table is built, decode every code from the code ranges
+	_table_max_code = 0;
+	_decode_start_code_size = _min_code_size;
+	_table_shift = 32;
+	_defer_count = 0;
+
 	if (table_bits > 0) {
-		s32 table_size = 1 << table_bits;
-		if (_lookup.size() < table_size) {
-			_lookup.resize(table_size);
+		// If table construction can wait until the decoder is actually used,
+		if (defer_table) {
+			_defer_count = DEFER_SYMS;
+		} else {
+			buildTable();
 		}
+	}
 
-		_lookup.fill_ff();
+	return true;
+}
 
-		for (u32 codesize = 1; codesize <= table_bits; ++codesize) {
-			if (!num_codes[codesize]) {
-				continue;
-			}
+void HuffmanDecoder::buildTable() {
+	const u32 table_bits = _table_bits;
+	const u32 * CAT_RESTRICT min_codes = _min_codes;
 
-			const u32 fillsize = table_bits - codesize;
-			const u32 fillnum = 1 << fillsize;
+	CAT_DEBUG_ENFORCE(table_bits > 0);
 
-			const u32 min_code = min_codes[codesize - 1];
-			u32 max_code = _max_codes[codesize - 1];
-			if (!max_code) {
-				max_code = 0xffffffff;
-			} else {
-				max_code = (max_code - 1) >> (16 - codesize);
-			}
-			const u32 val_ptr = _val_ptrs[codesize - 1];
+	s32 table_size = 1 << table_bits;
+	if (_lookup.size() < table_size) {
+		_lookup.resize(table_size);
+	}
 
-			for (u32 code = min_code; code <= max_code; code++) {
-				const u32 sym_index = _sorted_symbol_order[ val_ptr + code - min_code ];
+	_lookup.fill_ff();
 
-				for (u32 jj = 0; jj < fillnum; ++jj) {
-					const u32 tt = jj + (code << fillsize);
+	// Note: _max_codes[] is non-zero only for code sizes that are used
+	for (u32 codesize = 1; codesize <= table_bits; ++codesize) {
+		if (!_max_codes[codesize - 1]) {
+			continue;
+		}
 
-					_lookup[tt] = sym_index | (codesize << 16U);
-				}
+		const u32 fillsize = table_bits - codesize;
+		const u32 fillnum = 1 << fillsize;
+
+		const u32 min_code = min_codes[codesize - 1];
+		const u32 max_code = (_max_codes[codesize - 1] - 1) >> (16 - codesize);
+		const u32 val_ptr = _val_ptrs[codesize - 1] + min_code;
+
+		for (u32 code = min_code; code <= max_code; code++) {
+			const u32 sym_index = _sorted_symbol_order[ val_ptr + code - min_code ];
+
+			for (u32 jj = 0; jj < fillnum; ++jj) {
+				const u32 tt = jj + (code << fillsize);
+
+				_lookup[tt] = sym_index | (codesize << 16U);
 			}
 		}
-	}         
-
-	for (u32 ii = 0; ii < MAX_CODE_SIZE; ++ii) {
-		_val_ptrs[ii] -= min_codes[ii];
 	}
 
 	_table_max_code = 0;
 	_decode_start_code_size = _min_code_size;
 
-	if (table_bits > 0) {
-		u32 ii;
+	u32 ii;
 
-		for (ii = table_bits; ii >= 1; --ii) {
-			if (num_codes[ii]) {
-				_table_max_code = _max_codes[ii - 1];
-				break;
-			}
+	for (ii = table_bits; ii >= 1; --ii) {
+		if (_max_codes[ii - 1]) {
+			_table_max_code = _max_codes[ii - 1];
+			break;
 		}
+	}
 
-		if (ii >= 1) {
-			_decode_start_code_size = table_bits + 1;
+	if (ii >= 1) {
+		_decode_start_code_size = table_bits + 1;
 
-			for (ii = table_bits + 1; ii <= max_code_size; ++ii) {
-				if (num_codes[ii]) {
-					_decode_start_code_size = ii;
-					break;
-				}
+		for (ii = table_bits + 1; ii <= _max_code_size; ++ii) {
+			if (_max_codes[ii - 1]) {
+				_decode_start_code_size = ii;
+				break;
 			}
 		}
 	}
 
-	// sentinels
-	_max_codes[MAX_CODE_SIZE] = 0xffffffff;
-	_val_ptrs[MAX_CODE_SIZE] = 0xFFFFF;
-
-	_table_shift = 32 - _table_bits;
-	return true;
+	_table_shift = 32 - table_bits;
+	_defer_count = 0;
 }
 
 static const u8 ONE_CODELEN[1] = {1};
 
-bool HuffmanDecoder::init(int num_syms_orig, ImageReader & CAT_RESTRICT reader, u32 table_bits) {
+bool HuffmanDecoder::init(int num_syms_orig, ImageReader & CAT_RESTRICT reader, u32 table_bits, bool defer_table) {
 	static const int HUFF_SYMS = MAX_CODE_SIZE + 1;
 
 	// If number of symbols is degenerate,
@@ -256,7 +272,7 @@ bool HuffmanDecoder::init(int num_syms_orig, ImageReader & CAT_RESTRICT reader,
 			codelens[ii] = reader.read17();
 		}
 
-		return init(num_syms, codelens, table_bits);
+		return init(num_syms, codelens, table_bits, defer_table);
 	}
 
 	// Initialize the table decoder
@@ -332,7 +348,7 @@ bool HuffmanDecoder::init(int num_syms_orig, ImageReader & CAT_RESTRICT reader,
 		break;
 	}
 
-	return init(num_syms_orig, codelens, table_bits);
+	return init(num_syms_orig, codelens, table_bits, defer_table);
 }
 
 u32 HuffmanDecoder::next(ImageReader & CAT_RESTRICT reader) {
@@ -377,6 +393,11 @@ u32 HuffmanDecoder::next(ImageReader & CAT_RESTRICT reader) {
 		}
 
 		sym = _sorted_symbol_order[val_ptr];
+
+		// If the lookup table was deferred and this decoder is now in use,
+		if CAT_UNLIKELY(_defer_count > 0 && --_defer_count == 0) {
+			buildTable();
+		}
 	}
 
 	// Consume bits used for symbol
@@ -45,14 +45,16 @@ public:
 	static const u32 MAX_CODE_SIZE = 16; // Max bits per Huffman code (16 is upper limit)
 	static const u32 MAX_TABLE_BITS = 11; // Time-memory tradeoff LUT optimization limit
 	static const int TABLE_THRESH = 20; // Number of symbols before table is compressed
+	static const u32 DEFER_SYMS = 32; // Symbols decoded before a deferred LUT is built
 
 protected:
 	u32 _num_syms;
 	u32 _max_codes[MAX_CODE_SIZE + 1];
+	u32 _min_codes[MAX_CODE_SIZE];
 	int _val_ptrs[MAX_CODE_SIZE + 1];
 	u32 _total_used_syms;
 
-	SmartArray<u32> _sorted_symbol_order;
+	SmartArray<u16> _sorted_symbol_order;
 	u32 _cur_sorted_symbol_order_size;
 
 	u8 _min_code_size, _max_code_size;
@@ -68,9 +70,20 @@ protected:
 
 	u32 _one_sym;
 
+	// Symbols left to decode without the LUT before building it, or 0
+	u32 _defer_count;
+
+	void buildTable();
+
 public:
-	bool init(int num_syms, const u8 * CAT_RESTRICT codelens, u32 table_bits);
-	bool init(int num_syms, ImageReader & CAT_RESTRICT reader, u32 table_bits);
+	/*
+	 * If defer_table is set, the lookup table is not built until DEFER_SYMS
+	 * symbols have been decoded, and until then symbols are decoded directly
+	 * from the canonical code ranges.  Chaos bins that are rarely reached then
+	 * cost nothing to set up.  Not for decoders shared between threads.
+	 */
+	bool init(int num_syms, const u8 * CAT_RESTRICT codelens, u32 table_bits, bool defer_table = false);
+	bool init(int num_syms, ImageReader & CAT_RESTRICT reader, u32 table_bits, bool defer_table = false);
 
 	u32 next(ImageReader &reader);
 };
@@ -0,0 +1,212 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ImageGrayReader.hpp"
+#include "EndianNeutral.hpp"
+#include "GCIFReader.h"
+#include "StageTimer.hpp"
+using namespace cat;
+
+#ifdef CAT_COLLECT_STATS
+#include "../encoder/Log.hpp"
+#include "../encoder/Clock.hpp"
+
+static cat::Clock *m_clock = 0;
+#endif // CAT_COLLECT_STATS
+
+
+#ifdef CAT_DESYNCH_CHECKS
+#define DESYNC_TABLE() \
+	CAT_ENFORCE(reader.readWord() == 1234567);
+#define DESYNC(x, y) \
+	CAT_ENFORCE(reader.readBits(16) == (x ^ 12345)); \
+	CAT_ENFORCE(reader.readBits(16) == (y ^ 54321));
+#else
+#define DESYNC_TABLE()
+#define DESYNC(x, y)
+#endif
+
+
+//// ImageGrayReader
+
+int ImageGrayReader::readTables(u8 * CAT_RESTRICT plane, ImageReader & CAT_RESTRICT reader) {
+	MonoReader::Parameters params;
+	params.data = plane;
+	params.xsize = _xsize;
+	params.ysize = _ysize;
+	params.min_bits = 2;
+	params.max_bits = 5;
+	params.num_syms = 256;
+
+	int err = _mono_decoder.readTables(params, reader);
+
+	DESYNC_TABLE();
+
+	if CAT_UNLIKELY(reader.eof()) {
+		return GCIF_RE_BAD_MONO;
+	}
+
+	return err;
+}
+
+void ImageGrayReader::expandRow(u16 y, const u8 * CAT_RESTRICT gray) {
+	const int xsize = _xsize;
+	u32 * CAT_RESTRICT rgba = reinterpret_cast<u32 *>( _rgba ) + y * xsize;
+
+	for (int x = 0; x < xsize; ++x) {
+		const u32 g = gray[x];
+
+		rgba[x] = getLE(g | (g << 8) | (g << 16) | 0xff000000);
+	}
+
+	// If output format conversion is requested,
+	if (!_format->passthrough()) {
+		_format->convertRows(_rgba, xsize, y, 1);
+	}
+}
+
+int ImageGrayReader::readPixels(ImageReader & CAT_RESTRICT reader) {
+	const int xsize = _xsize;
+	const bool expand = !_format->native();
+
+	_read_safe = _mono_decoder.getReadDelegate(true);
+	_read_unsafe = _mono_decoder.getReadDelegate(false);
+
+	// For each scanline,
+	for (int y = 0, yend = _ysize; y < yend; ++y) {
+		_mono_decoder.readRowHeader(y, reader);
+
+		const u8 * CAT_RESTRICT gray = _mono_decoder.currentRow();
+
+#ifdef CAT_UNROLL_READER
+		// If the spatial filters need to be edge-safe for the whole row,
+		if (y == 0 || xsize <= 2) {
+#endif
+			for (int x = 0; x < xsize; ++x) {
+				DESYNC(x, y);
+
+				_read_safe(x, reader);
+			}
+#ifdef CAT_UNROLL_READER
+		} else {
+			DESYNC(0, y);
+
+			_read_safe(0, reader);
+
+			//// THIS IS THE INNER LOOP ////
+
+			for (int x = 1, xend = xsize - 1; x < xend; ++x) {
+				DESYNC(x, y);
+
+				_read_unsafe(x, reader);
+			}
+
+			//// THIS IS THE INNER LOOP ////
+
+			DESYNC(xsize - 1, y);
+
+			_read_safe(xsize - 1, reader);
+		}
+#endif // CAT_UNROLL_READER
+
+		// Filters only read back the gray plane, so the row can be expanded now
+		if (expand) {
+			expandRow(y, gray);
+		}
+	}
+
+	return GCIF_RE_OK;
+}
+
+int ImageGrayReader::read(ImageReader & CAT_RESTRICT reader, GCIFImage * CAT_RESTRICT image, const PixelFormat &format, GCIFReadStats *stats) {
+#ifdef CAT_COLLECT_STATS
+	m_clock = Clock::ref();
+
+	double t0 = m_clock->usec();
+#endif // CAT_COLLECT_STATS
+
+	int err;
+
+	_rgba = image->rgba;
+	_xsize = image->xsize;
+	_ysize = image->ysize;
+	_format = &format;
+
+	// Native output is the gray plane itself
+	u8 *plane = _rgba;
+	if (!format.native()) {
+		_plane.resize(_xsize * _ysize);
+		plane = _plane.get();
+	}
+
+	StageTimer timer;
+	if (stats) {
+		timer.start(reader.getBitsRead());
+	}
+
+	if ((err = readTables(plane, reader))) {
+		return err;
+	}
+
+	if (stats) {
+		timer.stop(reader.getBitsRead(), stats->tables);
+		timer.start(reader.getBitsRead());
+	}
+
+#ifdef CAT_COLLECT_STATS
+	double t1 = m_clock->usec();
+#endif // CAT_COLLECT_STATS
+
+	if ((err = readPixels(reader))) {
+		return err;
+	}
+
+	if (stats) {
+		timer.stop(reader.getBitsRead(), stats->pixels);
+	}
+
+#ifdef CAT_COLLECT_STATS
+	double t2 = m_clock->usec();
+
+	Stats.tablesUsec = t1 - t0;
+	Stats.pixelsUsec = t2 - t1;
+#endif // CAT_COLLECT_STATS
+
+	return GCIF_RE_OK;
+}
+
+#ifdef CAT_COLLECT_STATS
+
+bool ImageGrayReader::dumpStats() {
+	CAT_INANE("stats") << "(Gray Decode)  Tables Read Time : " << Stats.tablesUsec << " usec";
+	CAT_INANE("stats") << "(Gray Decode)  Pixels Read Time : " << Stats.pixelsUsec << " usec";
+
+	return true;
+}
+
+#endif
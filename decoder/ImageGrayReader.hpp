@@ -0,0 +1,93 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IMAGE_GRAY_READER_HPP
+#define IMAGE_GRAY_READER_HPP
+
+#include "ImageReader.hpp"
+#include "Enforcer.hpp"
+#include "MonoReader.hpp"
+#include "SmartArray.hpp"
+#include "PixelFormat.hpp"
+
+/*
+ * Game Closure Grayscale Decompression
+ *
+ * Images written with one channel skip the mask, palette and RGBA stages and
+ * store the gray plane directly with the Mono compressor.  The plane is
+ * decoded straight into the output for native output, or expanded to RGBA
+ * as each scanline is finished.
+ */
+
+namespace cat {
+
+
+//// ImageGrayReader
+
+class ImageGrayReader {
+protected:
+	u8 * CAT_RESTRICT _rgba;
+	u16 _xsize, _ysize;
+	const PixelFormat *_format;	// Output pixel format
+
+	SmartArray<u8> _plane;		// Gray plane when expanding to RGBA
+
+	MonoReader _mono_decoder;
+	MonoReader::ReadDelegate _read_safe, _read_unsafe;
+
+	int readTables(u8 * CAT_RESTRICT plane, ImageReader & CAT_RESTRICT reader);
+
+	// Expand a finished scanline of the gray plane to the output format
+	void expandRow(u16 y, const u8 * CAT_RESTRICT gray);
+
+	int readPixels(ImageReader & CAT_RESTRICT reader);
+
+#ifdef CAT_COLLECT_STATS
+public:
+	struct _Stats {
+		double tablesUsec;
+		double pixelsUsec;
+	} Stats;
+#endif
+
+public:
+	int read(ImageReader & CAT_RESTRICT reader, GCIFImage * CAT_RESTRICT image, const PixelFormat &format, GCIFReadStats *stats);
+
+#ifdef CAT_COLLECT_STATS
+	bool dumpStats();
+#else
+	CAT_INLINE bool dumpStats() {
+		return false;
+	}
+#endif
+};
+
+
+} // namespace cat
+
+#endif // IMAGE_GRAY_READER_HPP
@@ -33,6 +33,11 @@
 #include "Filters.hpp"
 using namespace cat;
 
+#if defined(CAT_PALETTE_GATHER) && defined(__AVX2__)
+#define CAT_PALETTE_AVX2
+#include <immintrin.h>
+#endif
+
 #ifdef CAT_COLLECT_STATS
 #include "../encoder/Log.hpp"
 #include "../encoder/Clock.hpp"
@@ -68,6 +73,9 @@ int ImagePaletteReader::readPalette(ImageReader & CAT_RESTRICT reader) {
 	// Read mask palette index
 	_mask_palette = reader.readBits(8);
 
+	// Clear unused entries so that any index can be expanded without checks
+	CAT_OBJCLR(_palette);
+
 	// If using compressed palette,
 	if (reader.readBit()) {
 		// Read color filter
@@ -145,62 +153,52 @@ int ImagePaletteReader::readTables(ImageReader & CAT_RESTRICT reader) {
 	return err;
 }
 
-int ImagePaletteReader::readPixels(ImageReader & CAT_RESTRICT reader) {
-	const u32 MASK_COLOR = _mask->getColor();
+void ImagePaletteReader::decodeBand(u16 y0, u16 rows, ImageReader & CAT_RESTRICT reader) {
 	const u8 MASK_PAL = _mask_palette;
+	const int xsize = _xsize;
+	const int stride = _mask_stride;
 
-	u32 * CAT_RESTRICT rgba = reinterpret_cast<u32 *>( _rgba );
-
-	// Set up read delegates
-	MonoReader::ReadDelegate read_safe = _mono_decoder.getReadDelegate(true);
-
-#ifdef CAT_UNROLL_READER
-	MonoReader::ReadDelegate read_unsafe = _mono_decoder.getReadDelegate(false);
-
-	// Unroll y = 0 scanline
-	{
-		const int y = 0;
+	u32 * CAT_RESTRICT band_mask = _band_mask.get();
 
+	// For each scanline in the band,
+	for (int y = y0, yend = y0 + rows; y < yend; ++y, band_mask += stride) {
 		_mono_decoder.readRowHeader(y, reader);
 
+		// Keep a copy of the mask scanline for the expansion stage
 		const u32 *mask_next = _mask->nextScanline();
+		memcpy(band_mask, mask_next, stride * sizeof(u32));
+
 		int mask_left = 0;
 		u32 mask;
 
-		for (int x = 0, xend = _xsize; x < xend; ++x) {
-			DESYNC(x, y);
-
-			// Next mask word
-			if (mask_left-- <= 0) {
-				mask = *mask_next++;
-				mask_left = 31;
-			}
-
-			if ((s32)mask < 0) {
-				*rgba = MASK_COLOR;
-				u8 *p = _mono_decoder.currentRow() + x;
-				*p = MASK_PAL;
-				_mono_decoder.zero(x);
-			} else {
-				u8 index = read_safe(x, reader);
-
-				CAT_DEBUG_ENFORCE(index < _palette_size);
-
-				*rgba = _palette[index];
+#ifdef CAT_UNROLL_READER
+		// If the spatial filters need to be edge-safe for the whole row,
+		if (y == 0 || xsize <= 2) {
+#endif
+			for (int x = 0; x < xsize; ++x) {
+				DESYNC(x, y);
+
+				// Next mask word
+				if (mask_left-- <= 0) {
+					mask = *mask_next++;
+					mask_left = 31;
+				}
+
+				if ((s32)mask < 0) {
+					u8 *p = _mono_decoder.currentRow() + x;
+					*p = MASK_PAL;
+					_mono_decoder.zero(x);
+				} else {
+					_read_safe(x, reader);
+
+					CAT_DEBUG_ENFORCE(_mono_decoder.currentRow()[x] < _palette_size);
+				}
+
+				mask <<= 1;
 			}
-
-			++rgba;
-			mask <<= 1;
+#ifdef CAT_UNROLL_READER
+			continue;
 		}
-	}
-
-	// For each remaining scanline,
-	for (int y = 1, yend = _ysize; y < yend; ++y) {
-		_mono_decoder.readRowHeader(y, reader);
-
-		const u32 *mask_next = _mask->nextScanline();
-		int mask_left;
-		u32 mask;
 
 		// Unroll x = 0
 		{
@@ -213,25 +211,21 @@ int ImagePaletteReader::readPixels(ImageReader & CAT_RESTRICT reader) {
 			mask_left = 31;
 
 			if ((s32)mask < 0) {
-				*rgba = MASK_COLOR;
 				u8 *p = _mono_decoder.currentRow() + x;
 				*p = MASK_PAL;
 				_mono_decoder.zero(x);
 			} else {
-				u8 index = read_safe(x, reader);
-
-				CAT_DEBUG_ENFORCE(index < _palette_size);
+				_read_safe(x, reader);
 
-				*rgba = _palette[index];
+				CAT_DEBUG_ENFORCE(_mono_decoder.currentRow()[x] < _palette_size);
 			}
 
-			++rgba;
 			mask <<= 1;
 		}
 
 		//// THIS IS THE INNER LOOP ////
 
-		for (int x = 1, xend = (int)_xsize - 1; x < xend; ++x) {
+		for (int x = 1, xend = xsize - 1; x < xend; ++x) {
 			DESYNC(x, y);
 
 			// Next mask word
@@ -241,27 +235,23 @@ int ImagePaletteReader::readPixels(ImageReader & CAT_RESTRICT reader) {
 			}
 
 			if ((s32)mask < 0) {
-				*rgba = MASK_COLOR;
 				u8 *p = _mono_decoder.currentRow() + x;
 				*p = MASK_PAL;
 				_mono_decoder.zero(x);
 			} else {
-				u8 index = read_unsafe(x, reader);
-
-				CAT_DEBUG_ENFORCE(index < _palette_size);
+				_read_unsafe(x, reader);
 
-				*rgba = _palette[index];
+				CAT_DEBUG_ENFORCE(_mono_decoder.currentRow()[x] < _palette_size);
 			}
 
-			++rgba;
 			mask <<= 1;
 		}
 
 		//// THIS IS THE INNER LOOP ////
 
-		// Unroll x = _xsize - 1
+		// Unroll x = xsize - 1
 		{
-			const int x = _xsize - 1;
+			const int x = xsize - 1;
 
 			DESYNC(x, y);
 
@@ -272,64 +262,160 @@ int ImagePaletteReader::readPixels(ImageReader & CAT_RESTRICT reader) {
 			}
 
 			if ((s32)mask < 0) {
-				*rgba = MASK_COLOR;
 				u8 *p = _mono_decoder.currentRow() + x;
 				*p = MASK_PAL;
 				_mono_decoder.zero(x);
 			} else {
-				u8 index = read_safe(x, reader);
+				_read_safe(x, reader);
 
-				CAT_DEBUG_ENFORCE(index < _palette_size);
-
-				*rgba = _palette[index];
+				CAT_DEBUG_ENFORCE(_mono_decoder.currentRow()[x] < _palette_size);
 			}
-
-			++rgba;
 		}
+#endif // CAT_UNROLL_READER
 	}
+}
 
-#else
-
-	for (int y = 0, yend = _ysize; y < yend; ++y) {
-		_mono_decoder.readRowHeader(y, reader);
+void ImagePaletteReader::expandBand(u16 y0, u16 rows) {
+	const u32 MASK_COLOR = _mask_color;
+	const u32 * CAT_RESTRICT palette = _palette;
+	const int xsize = _xsize;
+	const int stride = _mask_stride;
 
-		const u32 *mask_next = _mask->nextScanline();
-		int mask_left = 0;
-		u32 mask;
+	const u32 * CAT_RESTRICT band_mask = _band_mask.get();
+	const u8 * CAT_RESTRICT index = _image.get() + y0 * xsize;
+	u32 * CAT_RESTRICT rgba = reinterpret_cast<u32 *>( _rgba ) + y0 * xsize;
 
-		for (int x = 0, xend = _xsize; x < xend; ++x) {
-			DESYNC(x, y);
+#ifdef CAT_PALETTE_AVX2
+	const __m256i mask_color = _mm256_set1_epi32(MASK_COLOR);
+	const __m256i lane_bits = _mm256_setr_epi32(0x80000000, 0x40000000, 0x20000000, 0x10000000,
+												0x08000000, 0x04000000, 0x02000000, 0x01000000);
+#endif
 
-			// Next mask word
-			if (mask_left-- <= 0) {
-				mask = *mask_next++;
-				mask_left = 31;
+	// For each scanline in the band,
+	for (int y = 0; y < rows; ++y) {
+		const u32 * CAT_RESTRICT mask_next = band_mask;
+		band_mask += stride;
+
+		// For each 32 pixels covered by a mask word,
+		for (int x = 0; x < xsize; x += 32, rgba += 32, index += 32) {
+			u32 mask = *mask_next++;
+			const int len = xsize - x < 32 ? xsize - x : 32;
+
+#ifdef CAT_PALETTE_AVX2
+			if (len == 32) {
+				// Gather 8 palette entries at a time and blend in the mask color
+				for (int ii = 0; ii < 32; ii += 8, mask <<= 8) {
+					__m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>( index + ii )));
+					__m256i color = _mm256_i32gather_epi32(reinterpret_cast<const int *>( palette ), idx, 4);
+					__m256i bits = _mm256_and_si256(_mm256_set1_epi32(mask), lane_bits);
+					__m256i sel = _mm256_cmpeq_epi32(bits, lane_bits);
+					color = _mm256_blendv_epi8(color, mask_color, sel);
+					_mm256_storeu_si256(reinterpret_cast<__m256i *>( rgba + ii ), color);
+				}
+				continue;
 			}
+#endif
 
-			if ((s32)mask < 0) {
-				*rgba = MASK_COLOR;
-				u8 *p = _mono_decoder.currentRow() + x;
-				*p = MASK_PAL;
-				_mono_decoder.zero(x);
+			// If no pixels are masked (common case),
+			if (mask == 0) {
+				for (int ii = 0; ii < len; ++ii) {
+					rgba[ii] = palette[index[ii]];
+				}
 			} else {
-				u8 index = read_safe(x, reader);
+				// Select between palette color and mask color without branching
+				for (int ii = 0; ii < len; ++ii) {
+					const u32 sel = static_cast<u32>( static_cast<s32>( mask ) >> 31 );
+					rgba[ii] = (palette[index[ii]] & ~sel) | (MASK_COLOR & sel);
+					mask <<= 1;
+				}
+			}
+		}
 
-				CAT_DEBUG_ENFORCE(index < _palette_size);
+		// Undo overshoot from the final partial mask word
+		const int overshoot = (stride << 5) - xsize;
+		rgba -= overshoot;
+		index -= overshoot;
+	}
+}
 
-				*rgba = _palette[index];
+void ImagePaletteReader::expandBand16(u16 y0, u16 rows) {
+	const u16 MASK_COLOR = (u16)_mask_color;
+	const u32 * CAT_RESTRICT palette = _palette;
+	const int xsize = _xsize;
+	const int stride = _mask_stride;
+
+	const u32 * CAT_RESTRICT band_mask = _band_mask.get();
+	const u8 * CAT_RESTRICT index = _image.get() + y0 * xsize;
+	u16 * CAT_RESTRICT pixels = reinterpret_cast<u16 *>( _rgba ) + y0 * xsize;
+
+	// For each scanline in the band,
+	for (int y = 0; y < rows; ++y) {
+		const u32 * CAT_RESTRICT mask_next = band_mask;
+		band_mask += stride;
+
+		// For each 32 pixels covered by a mask word,
+		for (int x = 0; x < xsize; x += 32, pixels += 32, index += 32) {
+			u32 mask = *mask_next++;
+			const int len = xsize - x < 32 ? xsize - x : 32;
+
+			for (int ii = 0; ii < len; ++ii) {
+				pixels[ii] = (s32)mask < 0 ? MASK_COLOR : (u16)palette[index[ii]];
+				mask <<= 1;
 			}
-
-			++rgba;
-			mask <<= 1;
 		}
+
+		// Undo overshoot from the final partial mask word
+		const int overshoot = (stride << 5) - xsize;
+		pixels -= overshoot;
+		index -= overshoot;
 	}
+}
 
-#endif
+int ImagePaletteReader::readPixels(ImageReader & CAT_RESTRICT reader) {
+	// Set up read delegates
+	_read_safe = _mono_decoder.getReadDelegate(true);
+	_read_unsafe = _mono_decoder.getReadDelegate(false);
+
+	_mask_stride = (_xsize + 31) >> 5;
+	_band_mask.resize(_mask_stride * BAND_ROWS);
+
+#ifdef CAT_COLLECT_STATS
+	Stats.decodeUsec = 0;
+	Stats.expandUsec = 0;
+#endif // CAT_COLLECT_STATS
+
+	// For each band of scanlines,
+	for (int y = 0, yend = _ysize; y < yend; y += BAND_ROWS) {
+		const u16 rows = yend - y < BAND_ROWS ? yend - y : BAND_ROWS;
+
+#ifdef CAT_COLLECT_STATS
+		double t0 = m_clock->usec();
+#endif // CAT_COLLECT_STATS
+
+		decodeBand(y, rows, reader);
+
+#ifdef CAT_COLLECT_STATS
+		double t1 = m_clock->usec();
+#endif // CAT_COLLECT_STATS
+
+		if (_format->narrow()) {
+			expandBand16(y, rows);
+		} else {
+			expandBand(y, rows);
+		}
+
+#ifdef CAT_COLLECT_STATS
+		double t2 = m_clock->usec();
+
+		Stats.decodeUsec += t1 - t0;
+		Stats.expandUsec += t2 - t1;
+#endif // CAT_COLLECT_STATS
+	}
 
 	return GCIF_RE_OK;
 }
 
-int ImagePaletteReader::read(ImageReader & CAT_RESTRICT reader, ImageMaskReader & CAT_RESTRICT mask, GCIFImage * CAT_RESTRICT image) {
+int ImagePaletteReader::read(ImageReader & CAT_RESTRICT reader, ImageMaskReader & CAT_RESTRICT mask, GCIFImage * CAT_RESTRICT image, const PixelFormat &format) {
 #ifdef CAT_COLLECT_STATS
 	m_clock = Clock::ref();
 
@@ -354,6 +440,17 @@ int ImagePaletteReader::read(ImageReader & CAT_RESTRICT reader, ImageMaskReader
 	_xsize = image->xsize;
 	_ysize = image->ysize;
 	_mask = &mask;
+	_format = &format;
+	_mask_color = mask.getColor();
+
+	// Convert the palette once instead of each pixel
+	if (!format.passthrough()) {
+		for (int ii = 0; ii < _palette_size; ++ii) {
+			_palette[ii] = format.convert(_palette[ii]);
+		}
+
+		_mask_color = format.convert(_mask_color);
+	}
 
 	if ((err = readTables(reader))) {
 		return err;
@@ -388,6 +485,8 @@ bool ImagePaletteReader::dumpStats() {
 		CAT_INANE("stats") << "(Palette Decode) Palette Read Time : " << Stats.paletteUsec << " usec";
 		CAT_INANE("stats") << "(Palette Decode)  Tables Read Time : " << Stats.tablesUsec << " usec";
 		CAT_INANE("stats") << "(Palette Decode)  Pixels Read Time : " << Stats.pixelsUsec << " usec";
+		CAT_INANE("stats") << "(Palette Decode)   - Index Decode : " << Stats.decodeUsec << " usec";
+		CAT_INANE("stats") << "(Palette Decode)   - RGBA Expand  : " << Stats.expandUsec << " usec";
 		CAT_INANE("stats") << "(Palette Decode)      Palette Size : " << Stats.colorCount << " colors";
 	}
 
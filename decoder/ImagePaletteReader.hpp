@@ -34,6 +34,7 @@
 #include "MonoReader.hpp"
 #include "ImageMaskReader.hpp"
 #include "SmartArray.hpp"
+#include "PixelFormat.hpp"
 
 /*
  * Game Closure Global Palette Decompression
@@ -49,6 +50,7 @@ public:
 	static const int PALETTE_MAX = 256;
 	static const int ENCODER_ZRLE_SYMS = 16;
 	static const int HUFF_LUT_BITS = 7;
+	static const int BAND_ROWS = 16;	// Rows decoded before expanding to RGBA
 
 protected:
 	u32 _palette[PALETTE_MAX];
@@ -59,13 +61,30 @@ protected:
 
 	u8 * CAT_RESTRICT _rgba;
 	u16 _xsize, _ysize;
+	const PixelFormat *_format;	// Output pixel format
+	u32 _mask_color;			// Mask color in output format
 
 	SmartArray<u8> _image;
 
+	// Copy of the mask scanlines for the current band of rows
+	SmartArray<u32> _band_mask;
+	int _mask_stride;
+
 	MonoReader _mono_decoder;
+	MonoReader::ReadDelegate _read_safe, _read_unsafe;
 
 	int readPalette(ImageReader & CAT_RESTRICT reader);
 	int readTables(ImageReader & CAT_RESTRICT reader);
+
+	// Stage 1: Entropy decode palette indices for a band of rows
+	void decodeBand(u16 y0, u16 rows, ImageReader & CAT_RESTRICT reader);
+
+	// Stage 2: Expand palette indices to RGBA for a band of rows
+	void expandBand(u16 y0, u16 rows);
+
+	// Stage 2 for 16-bit output formats
+	void expandBand16(u16 y0, u16 rows);
+
 	int readPixels(ImageReader & CAT_RESTRICT reader);
 
 #ifdef CAT_COLLECT_STATS
@@ -74,6 +93,7 @@ public:
 		double paletteUsec;
 		double tablesUsec;
 		double pixelsUsec;
+		double decodeUsec, expandUsec;
 
 		int colorCount;
 	} Stats;
@@ -84,7 +104,7 @@ public:
 		return _palette_size > 0;
 	}
 
-	int read(ImageReader & CAT_RESTRICT reader, ImageMaskReader & CAT_RESTRICT mask, GCIFImage * CAT_RESTRICT image);
+	int read(ImageReader & CAT_RESTRICT reader, ImageMaskReader & CAT_RESTRICT mask, GCIFImage * CAT_RESTRICT image, const PixelFormat &format);
 
 #ifdef CAT_COLLECT_STATS
 	bool dumpStats();
@@ -141,8 +141,8 @@ int ImageRGBAReader::readFilterTables(ImageReader & CAT_RESTRICT reader) {
 int ImageRGBAReader::readRGBATables(ImageReader & CAT_RESTRICT reader) {
 	int err;
 
-	// Read alpha decoder
-	{
+	// If the image has an alpha plane, read alpha decoder
+	if (!_opaque) {
 		const int pixel_count = _xsize * _ysize;
 		_a_tiles.resize(pixel_count);
 
@@ -163,9 +163,9 @@ int ImageRGBAReader::readRGBATables(ImageReader & CAT_RESTRICT reader) {
 
 		_a_decoder_read_safe = _a_decoder.getReadDelegate(true);
 		_a_decoder_read_unsafe = _a_decoder.getReadDelegate(false);
-	}
 
-	DESYNC_TABLE();
+		DESYNC_TABLE();
+	}
 
 	// Read chaos levels
 	const int chaos_levels = reader.readBits(4) + 1;
@@ -204,7 +204,46 @@ int ImageRGBAReader::readRGBATables(ImageReader & CAT_RESTRICT reader) {
 	return GCIF_RE_OK;
 }
 
-CAT_INLINE void ImageRGBAReader::readSafe(u16 &x, const u16 y, u8 * CAT_RESTRICT &p, ImageReader & CAT_RESTRICT reader, u32 &mask, const u32 * CAT_RESTRICT &mask_next, int &mask_left, const u32 MASK_COLOR, const u8 MASK_ALPHA) {
+int ImageRGBAReader::readStreams(ImageReader & CAT_RESTRICT reader) {
+	// If pixel data is all in the image bitstream, as it always is in the
+	// original layout,
+	if (reader.isLegacy() || !reader.readBit()) {
+		for (int ii = 0; ii < STREAM_COUNT; ++ii) {
+			_streams[ii] = &reader;
+		}
+
+		return GCIF_RE_OK;
+	}
+
+	// Read substream lengths in words
+	u32 counts[STREAM_COUNT];
+	for (int ii = 0; ii < STREAM_COUNT; ++ii) {
+		counts[ii] = reader.read9();
+	}
+
+	// Substreams start at the next word after the lengths
+	int words_left;
+	const u32 * CAT_RESTRICT words = reader.alignWords(words_left);
+
+	for (int ii = 0; ii < STREAM_COUNT; ++ii) {
+		const u32 count = counts[ii];
+
+		if CAT_UNLIKELY(count > (u32)words_left) {
+			CAT_DEBUG_EXCEPTION();
+			return GCIF_RE_BAD_RGBA;
+		}
+
+		_substreams[ii].initStream(words, count);
+		_streams[ii] = &_substreams[ii];
+
+		words += count;
+		words_left -= count;
+	}
+
+	return GCIF_RE_OK;
+}
+
+template<bool HAS_ALPHA> CAT_INLINE void ImageRGBAReader::readSafe(u16 &x, const u16 y, u8 * CAT_RESTRICT &p, ImageReader &reader, u32 &mask, const u32 * CAT_RESTRICT &mask_next, int &mask_left, const u32 MASK_COLOR, const u8 MASK_ALPHA) {
 	DESYNC(x, y);
 
 #ifndef CAT_DISABLE_MASK
@@ -216,10 +255,12 @@ CAT_INLINE void ImageRGBAReader::readSafe(u16 &x, const u16 y, u8 * CAT_RESTRICT
 
 	if ((s32)mask < 0) {
 		*reinterpret_cast<u32 *>( p ) = MASK_COLOR;
-		u8 * CAT_RESTRICT Ap = _a_decoder.currentRow() + x;
-		*Ap = MASK_ALPHA;
 		_chaos.zero(x);
-		_a_decoder.zero(x);
+		if (HAS_ALPHA) {
+			u8 * CAT_RESTRICT Ap = _a_decoder.currentRow() + x;
+			*Ap = MASK_ALPHA;
+			_a_decoder.zero(x);
+		}
 	} else {
 #endif
 		// Calculate YUV chaos
@@ -259,15 +300,15 @@ CAT_INLINE void ImageRGBAReader::readSafe(u16 &x, const u16 y, u8 * CAT_RESTRICT
 			// Read YUV
 			u8 YUV[3];
 			YUV[0] = (u8)pixel_code;
-			YUV[1] = (u8)_u_decoder[cu].next(reader);
-			YUV[2] = (u8)_v_decoder[cv].next(reader);
+			YUV[1] = (u8)_u_decoder[cu].next(*_streams[STREAM_U]);
+			YUV[2] = (u8)_v_decoder[cv].next(*_streams[STREAM_V]);
 
 			// Read alpha pixel
-			p[3] = (u8)~_a_decoder_read_safe(x, reader);
+			p[3] = HAS_ALPHA ? (u8)~_a_decoder_read_safe(x, *_streams[STREAM_A]) : 255;
 
 			DESYNC(x, y);
 
-			FilterSelection *filter = readFilter(x, y, reader);
+			FilterSelection *filter = readFilter(x, y);
 
 			// Reverse color filter
 			filter->cf(YUV, p);
@@ -291,7 +332,7 @@ CAT_INLINE void ImageRGBAReader::readSafe(u16 &x, const u16 y, u8 * CAT_RESTRICT
 	++x;
 }
 
-CAT_INLINE void ImageRGBAReader::readUnsafe(u16 &x, const u16 y, u8 * CAT_RESTRICT &p, ImageReader & CAT_RESTRICT reader, u32 &mask, const u32 * CAT_RESTRICT &mask_next, int &mask_left, const u32 MASK_COLOR, const u8 MASK_ALPHA) {
+template<bool HAS_ALPHA> CAT_INLINE void ImageRGBAReader::readUnsafe(u16 &x, const u16 y, u8 * CAT_RESTRICT &p, ImageReader &reader, u32 &mask, const u32 * CAT_RESTRICT &mask_next, int &mask_left, const u32 MASK_COLOR, const u8 MASK_ALPHA) {
 	DESYNC(x, y);
 
 #ifndef CAT_DISABLE_MASK
@@ -303,16 +344,26 @@ CAT_INLINE void ImageRGBAReader::readUnsafe(u16 &x, const u16 y, u8 * CAT_RESTRI
 
 	if ((s32)mask < 0) {
 		*reinterpret_cast<u32 *>( p ) = MASK_COLOR;
-		u8 * CAT_RESTRICT Ap = _a_decoder.currentRow() + x;
-		*Ap = MASK_ALPHA;
 		_chaos.zero(x);
-		_a_decoder.zero(x);
+		if (HAS_ALPHA) {
+			u8 * CAT_RESTRICT Ap = _a_decoder.currentRow() + x;
+			*Ap = MASK_ALPHA;
+			_a_decoder.zero(x);
+		}
 	} else {
 #endif
 		// Calculate YUV chaos
 		u8 cy, cu, cv;
 		_chaos.get(x, cy, cu, cv);
 
+		// If every channel is in the middle of a zero run,
+		if (_y_decoder[cy].pendingZeroes() > 0 &&
+			_u_decoder[cu].pendingZeroes() > 0 &&
+			_v_decoder[cv].pendingZeroes() > 0) {
+			readZeroRun<HAS_ALPHA>(x, y, p, reader, mask, mask_next, mask_left, cy, cu, cv);
+			return;
+		}
+
 		u16 pixel_code = _y_decoder[cy].next(reader); 
 
 		// If it is an LZ escape code,
@@ -344,15 +395,15 @@ CAT_INLINE void ImageRGBAReader::readUnsafe(u16 &x, const u16 y, u8 * CAT_RESTRI
 			// Read YUV
 			u8 YUV[3];
 			YUV[0] = (u8)pixel_code;
-			YUV[1] = (u8)_u_decoder[cu].next(reader);
-			YUV[2] = (u8)_v_decoder[cv].next(reader);
+			YUV[1] = (u8)_u_decoder[cu].next(*_streams[STREAM_U]);
+			YUV[2] = (u8)_v_decoder[cv].next(*_streams[STREAM_V]);
 
 			// Read alpha pixel
-			p[3] = (u8)~_a_decoder_read_unsafe(x, reader);
+			p[3] = HAS_ALPHA ? (u8)~_a_decoder_read_unsafe(x, *_streams[STREAM_A]) : 255;
 
 			DESYNC(x, y);
 
-			FilterSelection *filter = readFilter(x, y, reader);
+			FilterSelection *filter = readFilter(x, y);
 
 			// Reverse color filter
 			filter->cf(YUV, p);
@@ -376,10 +427,96 @@ CAT_INLINE void ImageRGBAReader::readUnsafe(u16 &x, const u16 y, u8 * CAT_RESTRI
 	++x;
 }
 
-int ImageRGBAReader::readPixels(ImageReader & CAT_RESTRICT reader) {
+template<bool HAS_ALPHA> void ImageRGBAReader::readZeroRun(u16 &x, const u16 y, u8 * CAT_RESTRICT &p, ImageReader &reader, u32 &mask, const u32 * CAT_RESTRICT &mask_next, int &mask_left, u8 cy, u8 cu, u8 cv) {
+	static const u8 ZERO_YUV[3] = { 0, 0, 0 };
+
+	// Stop before the right edge so the unsafe spatial filters can be used
+	const u16 xend = _xsize - 1;
+
+	const FilterSelection * CAT_RESTRICT last_filter = 0;
+	u8 rgb[3] = { 0, 0, 0 };
+
+	for (;;) {
+		// Consume the zero residuals without decoding them
+		_y_decoder[cy].skipZero();
+		_u_decoder[cu].skipZero();
+		_v_decoder[cv].skipZero();
+
+		// Read alpha pixel
+		p[3] = HAS_ALPHA ? (u8)~_a_decoder_read_unsafe(x, *_streams[STREAM_A]) : 255;
+
+		DESYNC(x, y);
+
+		FilterSelection *filter = readFilter(x, y);
+
+		// If the tile changed, reverse the color filter for a zero residual
+		if (filter != last_filter) {
+			filter->cf(ZERO_YUV, rgb);
+			last_filter = filter;
+		}
+
+		p[0] = rgb[0];
+		p[1] = rgb[1];
+		p[2] = rgb[2];
+
+		// Reverse spatial filter
+		u8 FPT[3];
+		const u8 * CAT_RESTRICT pred = filter->sf.unsafe(p, FPT, x, y, _xsize);
+		p[0] += pred[0];
+		p[1] += pred[1];
+		p[2] += pred[2];
+
+		_chaos.zero(x);
+
+#ifndef CAT_DISABLE_MASK
+		--mask_left;
+		mask <<= 1;
+#endif
+		p += 4;
+		++x;
+
+		// If the run reached the right edge,
+		if (x >= xend) {
+			break;
+		}
+
+#ifndef CAT_DISABLE_MASK
+		// Next mask word
+		if (mask_left <= 0) {
+			mask = *mask_next++;
+			mask_left = 32;
+		}
+
+		// If the next pixel is masked,
+		if ((s32)mask < 0) {
+			break;
+		}
+#endif
+
+		// If any channel leaves its zero run at the next pixel,
+		_chaos.get(x, cy, cu, cv);
+		if (_y_decoder[cy].pendingZeroes() <= 0 ||
+			_u_decoder[cu].pendingZeroes() <= 0 ||
+			_v_decoder[cv].pendingZeroes() <= 0) {
+			break;
+		}
+
+		DESYNC(x, y);
+	}
+}
+
+template<bool HAS_ALPHA> int ImageRGBAReader::readPixels() {
+	// Y symbols, LZ matches and desynch checks are read from the Y stream.
+	// Not restricted since the streams may all be the same image reader
+	ImageReader &reader = *_streams[STREAM_Y];
+
 	const int xsize = _xsize;
 	const u32 MASK_COLOR = _mask->getColor();
 	const u8 MASK_ALPHA = (u8)~(getLE(MASK_COLOR) >> 24);
+	const bool convert = !_format->passthrough();
+
+	_converted_rows = 0;
+	_convert_lag = 2 + (LZReader::WIN_SIZE + xsize - 1) / xsize;
 
 	_chaos.start();
 
@@ -399,10 +536,12 @@ int ImageRGBAReader::readPixels(ImageReader & CAT_RESTRICT reader) {
 		_filters.fill_00();
 
 		// Read row headers
-		_sf_decoder.readRowHeader(y, reader);
-		_cf_decoder.readRowHeader(y, reader);
+		_sf_decoder.readRowHeader(y, *_streams[STREAM_SF]);
+		_cf_decoder.readRowHeader(y, *_streams[STREAM_CF]);
 
-		_a_decoder.readRowHeader(y, reader);
+		if (HAS_ALPHA) {
+			_a_decoder.readRowHeader(y, *_streams[STREAM_A]);
+		}
 
 		// Read mask scanline
 		const u32 * CAT_RESTRICT mask_next = _mask->nextScanline();
@@ -411,7 +550,7 @@ int ImageRGBAReader::readPixels(ImageReader & CAT_RESTRICT reader) {
 
 		// For each pixel,
 		for (u16 x = 0; x < xsize;) {
-			readSafe(x, y, p, reader, mask, mask_next, mask_left, MASK_COLOR, MASK_ALPHA);
+			readSafe<HAS_ALPHA>(x, y, p, reader, mask, mask_next, mask_left, MASK_COLOR, MASK_ALPHA);
 		}
 	}
 
@@ -434,11 +573,13 @@ int ImageRGBAReader::readPixels(ImageReader & CAT_RESTRICT reader) {
 			const u16 ty = y >> _tile_bits_y;
 
 			// Read row headers
-			_sf_decoder.readRowHeader(ty, reader);
-			_cf_decoder.readRowHeader(ty, reader);
+			_sf_decoder.readRowHeader(ty, *_streams[STREAM_SF]);
+			_cf_decoder.readRowHeader(ty, *_streams[STREAM_CF]);
 		}
 
-		_a_decoder.readRowHeader(y, reader);
+		if (HAS_ALPHA) {
+			_a_decoder.readRowHeader(y, *_streams[STREAM_A]);
+		}
 
 		// Read mask scanline
 		const u32 * CAT_RESTRICT mask_next = _mask->nextScanline();
@@ -447,16 +588,21 @@ int ImageRGBAReader::readPixels(ImageReader & CAT_RESTRICT reader) {
 
 		// Unroll x = 0 pixel
 		u16 x = 0;
-		readSafe(x, y, p, reader, mask, mask_next, mask_left, MASK_COLOR, MASK_ALPHA);
+		readSafe<HAS_ALPHA>(x, y, p, reader, mask, mask_next, mask_left, MASK_COLOR, MASK_ALPHA);
 
 		// For each pixel,
 		for (u16 xend = xsize - 1; x < xend;) {
-			readUnsafe(x, y, p, reader, mask, mask_next, mask_left, MASK_COLOR, MASK_ALPHA);
+			readUnsafe<HAS_ALPHA>(x, y, p, reader, mask, mask_next, mask_left, MASK_COLOR, MASK_ALPHA);
 		}
 
 		// For right image edge,
 		if (x < xsize) {
-			readSafe(x, y, p, reader, mask, mask_next, mask_left, MASK_COLOR, MASK_ALPHA);
+			readSafe<HAS_ALPHA>(x, y, p, reader, mask, mask_next, mask_left, MASK_COLOR, MASK_ALPHA);
+		}
+
+		// If output format conversion is requested,
+		if (convert) {
+			convertFinished(y);
 		}
 	}
 
@@ -482,11 +628,13 @@ int ImageRGBAReader::readPixels(ImageReader & CAT_RESTRICT reader) {
 			const u16 ty = y >> _tile_bits_y;
 
 			// Read row headers
-			_sf_decoder.readRowHeader(ty, reader);
-			_cf_decoder.readRowHeader(ty, reader);
+			_sf_decoder.readRowHeader(ty, *_streams[STREAM_SF]);
+			_cf_decoder.readRowHeader(ty, *_streams[STREAM_CF]);
 		}
 
-		_a_decoder.readRowHeader(y, reader);
+		if (HAS_ALPHA) {
+			_a_decoder.readRowHeader(y, *_streams[STREAM_A]);
+		}
 
 		// Read mask scanline
 		const u32 * CAT_RESTRICT mask_next = _mask->nextScanline();
@@ -495,16 +643,31 @@ int ImageRGBAReader::readPixels(ImageReader & CAT_RESTRICT reader) {
 
 		// For each pixel,
 		for (u16 x = 0; x < xsize;) {
-			readSafe(x, y, p, reader, mask, mask_next, mask_left, MASK_COLOR, MASK_ALPHA);
+			readSafe<HAS_ALPHA>(x, y, p, reader, mask, mask_next, mask_left, MASK_COLOR, MASK_ALPHA);
+		}
+
+		// If output format conversion is requested,
+		if (convert) {
+			convertFinished(y);
 		}
 	}
 
 #endif
 
+	// Convert the trailing rows
+	if (convert) {
+		_format->convertRows(_rgba, xsize, _converted_rows, _ysize - _converted_rows);
+	}
+
 	return GCIF_RE_OK;
 }
 
-int ImageRGBAReader::readLZMatch(u16 pixel_code, ImageReader & CAT_RESTRICT reader, int x, u8 * CAT_RESTRICT p) {
+int ImageRGBAReader::readLZMatch(u16 pixel_code, ImageReader &reader, int x, u8 * CAT_RESTRICT p) {
+	u64 t0 = 0;
+	if (_stats) {
+		t0 = StageTimer::nsec();
+	}
+
 	// Decode LZ bitstream
 	u32 dist, len;
 	len = _lz.read(pixel_code - 256, reader, dist);
@@ -533,10 +696,6 @@ int ImageRGBAReader::readLZMatch(u16 pixel_code, ImageReader & CAT_RESTRICT read
 		return GCIF_RE_LZ_BAD;
 	}
 
-	// Calculate destination address for alpha
-	u8 * CAT_RESTRICT Ap_dst = _a_decoder.currentRow() + x;
-	const u8 * CAT_RESTRICT Ap_src = Ap_dst - dist;
-
 	// Copy blocks at a time
 	int copy = len;
 	while (copy >= 4) {
@@ -546,12 +705,6 @@ int ImageRGBAReader::readLZMatch(u16 pixel_code, ImageReader & CAT_RESTRICT read
 		dst[3] = src[3];
 		dst += 4;
 		src += 4;
-		Ap_dst[0] = Ap_src[0];
-		Ap_dst[1] = Ap_src[1];
-		Ap_dst[2] = Ap_src[2];
-		Ap_dst[3] = Ap_src[3];
-		Ap_dst += 4;
-		Ap_src += 4;
 		copy -= 4;
 	}
 
@@ -560,21 +713,36 @@ int ImageRGBAReader::readLZMatch(u16 pixel_code, ImageReader & CAT_RESTRICT read
 		dst[0] = src[0];
 		++dst;
 		++src;
-		Ap_dst[0] = Ap_src[0];
-		++Ap_dst;
-		++Ap_src;
 		--copy;
 	}
 
 	// Execute remaining chaos zeroing
 	_chaos.zeroRegion(x, len);
-	_a_decoder.zeroRegion(x, len);
+
+	// If the image has an alpha plane,
+	if (!_opaque) {
+		// Copy the alpha plane that the alpha filters read back, forward since
+		// the source may overlap the destination
+		u8 *Ap_dst = _a_decoder.currentRow() + x;
+		const u8 *Ap_src = Ap_dst - dist;
+
+		for (u32 ii = 0; ii < len; ++ii) {
+			Ap_dst[ii] = Ap_src[ii];
+		}
+
+		_a_decoder.zeroRegion(x, len);
+	}
+
+	if (_stats) {
+		_stats->lz.nsec += StageTimer::nsec() - t0;
+		_stats->lz.bytes += len * 4;
+	}
 
 	// Return match length
 	return len;
 }
 
-int ImageRGBAReader::read(ImageReader & CAT_RESTRICT reader, ImageMaskReader & CAT_RESTRICT maskReader, GCIFImage * CAT_RESTRICT image) {
+int ImageRGBAReader::read(ImageReader & CAT_RESTRICT reader, ImageMaskReader & CAT_RESTRICT maskReader, GCIFImage * CAT_RESTRICT image, const PixelFormat &format, GCIFReadStats *stats) {
 #ifdef CAT_COLLECT_STATS
 	m_clock = Clock::ref();
 
@@ -584,10 +752,18 @@ int ImageRGBAReader::read(ImageReader & CAT_RESTRICT reader, ImageMaskReader & C
 	int err;
 
 	_mask = &maskReader;
+	_format = &format;
+	_stats = stats;
+
+	StageTimer timer;
+	if (stats) {
+		timer.start(reader.getBitsRead());
+	}
 
 	_rgba = image->rgba;
 	_xsize = image->xsize;
 	_ysize = image->ysize;
+	_opaque = reader.getHeader()->channels == 3;
 
 	// Read filter selection tables
 	if ((err = readFilterTables(reader))) {
@@ -603,15 +779,37 @@ int ImageRGBAReader::read(ImageReader & CAT_RESTRICT reader, ImageMaskReader & C
 		return err;
 	}
 
+	// Locate pixel data substreams
+	if ((err = readStreams(reader))) {
+		return err;
+	}
+
+	if (stats) {
+		timer.stop(reader.getBitsRead(), stats->tables);
+		timer.start(reader.getBitsRead());
+	}
+
 #ifdef CAT_COLLECT_STATS
 	double t2 = m_clock->usec();
 #endif	
 
 	// Read RGB data and decompress it
-	if ((err = readPixels(reader))) {
+	if ((err = _opaque ? readPixels<false>() : readPixels<true>())) {
 		return err;
 	}
 
+	if (stats) {
+		// Substreams are read separately from the image bitstream
+		u64 bits = reader.getBitsRead();
+		if (_streams[STREAM_Y] != &reader) {
+			for (int ii = 0; ii < STREAM_COUNT; ++ii) {
+				bits += _substreams[ii].getBitsRead();
+			}
+		}
+
+		timer.stop(bits, stats->pixels);
+	}
+
 	// Pass image data reference back to caller
 	_rgba = 0;
 
@@ -37,6 +37,8 @@
 #include "MonoReader.hpp"
 #include "SmartArray.hpp"
 #include "LZReader.hpp"
+#include "PixelFormat.hpp"
+#include "StageTimer.hpp"
 
 /*
  * Game Closure RGBA Decompression
@@ -50,6 +52,11 @@
  * then reversed to RGB and then the spatial filter is reversed back to the
  * original RGB data.
  *
+ * Large images may split the Y, U, V, alpha and filter symbols into separate
+ * word-aligned substreams that follow the tables, listed by a small table of
+ * substream lengths.  Each substream has its own bit reader, so consecutive
+ * symbol decodes of a pixel do not wait on each other's bit positions.
+ *
  * LZ and alpha masking are very cheap decoding operations.  The most expensive
  * per-pixel operation is the static Huffman decoding, which is just a table
  * lookup and some bit twiddling for the majority of decoding.  As a result the
@@ -76,6 +83,15 @@ public:
 
 	static const int HUFF_LUT_BITS = 7;
 
+	// Pixel data substreams
+	static const int STREAM_Y = 0; // Y and LZ symbols
+	static const int STREAM_U = 1;
+	static const int STREAM_V = 2;
+	static const int STREAM_A = 3;
+	static const int STREAM_SF = 4;
+	static const int STREAM_CF = 5;
+	static const int STREAM_COUNT = 6;
+
 protected:
 	ImageMaskReader * CAT_RESTRICT _mask;
 
@@ -83,6 +99,14 @@ protected:
 	u8 * CAT_RESTRICT _rgba;
 	u16 _xsize, _ysize;
 
+	// Output format conversion trails decoding by enough rows that LZ
+	// matches and spatial filters only ever read unconverted pixels
+	const PixelFormat *_format;
+	int _converted_rows, _convert_lag;
+
+	// Runtime stage stats, or 0 when not requested
+	GCIFReadStats *_stats;
+
 	// Tiles
 	u16 _tile_bits_x, _tile_bits_y;
 	u16 _tile_xsize, _tile_ysize;
@@ -103,6 +127,9 @@ protected:
 	int _sf_count;
 	SmartArray<FilterSelection> _filters;
 
+	// RGB images have no alpha plane and are opaque
+	bool _opaque;
+
 	// Filter/Alpha decoders
 	SmartArray<u8> _sf_tiles, _cf_tiles, _a_tiles;
 	MonoReader _sf_decoder, _cf_decoder, _a_decoder;
@@ -122,25 +149,43 @@ protected:
 	// LZ decoder
 	LZReader _lz;
 
-	CAT_INLINE FilterSelection *readFilter(u16 x, u16 y, ImageReader & CAT_RESTRICT reader) {
+	// Pixel data readers, pointing to the substreams or all to the image reader
+	ImageReader _substreams[STREAM_COUNT];
+	ImageReader *_streams[STREAM_COUNT];
+
+	CAT_INLINE FilterSelection *readFilter(u16 x, u16 y) {
 		const u16 tx = x >> _tile_bits_x;
 		FilterSelection * CAT_RESTRICT filter = &_filters[tx];
 
 		if (!filter->ready()) {
-			filter->cf = YUV2RGB_FILTERS[_cf_decoder_read(tx, reader)];
-			filter->sf = _sf[_sf_decoder_read(tx, reader)];
+			filter->cf = YUV2RGB_FILTERS[_cf_decoder_read(tx, *_streams[STREAM_CF])];
+			filter->sf = _sf[_sf_decoder_read(tx, *_streams[STREAM_SF])];
 		}
 
 		return filter;
 	}
 
-	CAT_INLINE void readSafe(u16 &x, const u16 y, u8 * CAT_RESTRICT &p, ImageReader & CAT_RESTRICT reader, u32 &mask, const u32 * CAT_RESTRICT &mask_next, int &mask_left, const u32 MASK_COLOR, const u8 MASK_ALPHA);
-	CAT_INLINE void readUnsafe(u16 &x, const u16 y, u8 * CAT_RESTRICT &p, ImageReader & CAT_RESTRICT reader, u32 &mask, const u32 * CAT_RESTRICT &mask_next, int &mask_left, const u32 MASK_COLOR, const u8 MASK_ALPHA);
+	// Pixel loops are specialized on whether the image has an alpha plane, so
+	// opaque images write 255 alpha without touching the alpha decoder
+	template<bool HAS_ALPHA> CAT_INLINE void readSafe(u16 &x, const u16 y, u8 * CAT_RESTRICT &p, ImageReader &reader, u32 &mask, const u32 * CAT_RESTRICT &mask_next, int &mask_left, const u32 MASK_COLOR, const u8 MASK_ALPHA);
+	template<bool HAS_ALPHA> CAT_INLINE void readUnsafe(u16 &x, const u16 y, u8 * CAT_RESTRICT &p, ImageReader &reader, u32 &mask, const u32 * CAT_RESTRICT &mask_next, int &mask_left, const u32 MASK_COLOR, const u8 MASK_ALPHA);
+	template<bool HAS_ALPHA> void readZeroRun(u16 &x, const u16 y, u8 * CAT_RESTRICT &p, ImageReader &reader, u32 &mask, const u32 * CAT_RESTRICT &mask_next, int &mask_left, u8 cy, u8 cu, u8 cv);
 
-	int readLZMatch(u16 pixel_code, ImageReader & CAT_RESTRICT reader, int x, u8 * CAT_RESTRICT p);
+	int readLZMatch(u16 pixel_code, ImageReader &reader, int x, u8 * CAT_RESTRICT p);
 	int readFilterTables(ImageReader & CAT_RESTRICT reader);
 	int readRGBATables(ImageReader & CAT_RESTRICT reader);
-	int readPixels(ImageReader & CAT_RESTRICT reader);
+	int readStreams(ImageReader & CAT_RESTRICT reader);
+	template<bool HAS_ALPHA> int readPixels();
+
+	// Convert rows that decoding will not read again, up to row y
+	CAT_INLINE void convertFinished(int y) {
+		const int rows = y - _convert_lag - _converted_rows;
+
+		if (rows > 0) {
+			_format->convertRows(_rgba, _xsize, _converted_rows, rows);
+			_converted_rows += rows;
+		}
+	}
 
 #ifdef CAT_COLLECT_STATS
 public:
@@ -151,7 +196,7 @@ public:
 #endif
 
 public:
-	int read(ImageReader & CAT_RESTRICT reader, ImageMaskReader & CAT_RESTRICT maskReader, GCIFImage * CAT_RESTRICT image);
+	int read(ImageReader & CAT_RESTRICT reader, ImageMaskReader & CAT_RESTRICT maskReader, GCIFImage * CAT_RESTRICT image, const PixelFormat &format, GCIFReadStats *stats);
 
 #ifdef CAT_COLLECT_STATS
 	bool dumpStats();
@@ -29,6 +29,7 @@
 #include "ImageReader.hpp"
 #include "EndianNeutral.hpp"
 #include "GCIFReader.h"
+#include "EntropyDictionary.hpp"
 using namespace cat;
 
 
@@ -36,6 +37,13 @@ using namespace cat;
 
 void ImageReader::clear() {
 	_words = 0;
+
+	// If a registered dictionary is held, give it back
+	if (_dict_held) {
+		EntropyDictionary::Release(_dict);
+		_dict_held = false;
+	}
+	_dict = 0;
 }
 
 u32 ImageReader::refill() {
@@ -63,6 +71,27 @@ u32 ImageReader::refill() {
 	return bits >> 32;
 }
 
+void ImageReader::initStream(const u32 * CAT_RESTRICT words, int wordCount) {
+	clear();
+
+	// Setup bit reader
+	_words = words;
+	_wordsLeft = wordCount;
+	_wordCount = wordCount;
+
+	_eof = false;
+
+	_bits = 0;
+	_bitsLeft = 0;
+
+	_header.xsize = 0;
+	_header.ysize = 0;
+	_header.dict_id = 0;
+	_header.channels = 4;
+	_header.legacy = false;
+	_dict = 0;
+}
+
 #ifdef CAT_COMPILE_MMAP
 
 int ImageReader::init(const char * CAT_RESTRICT path) {
@@ -89,7 +118,7 @@ int ImageReader::init(const char * CAT_RESTRICT path) {
 
 #endif // CAT_COMPILE_MMAP
 
-int ImageReader::init(const void * CAT_RESTRICT buffer, long fileSize) {
+int ImageReader::init(const void * CAT_RESTRICT buffer, long fileSize, EntropyDictionary *dict) {
 	const int MIN_FILE_WORDS = 2; // Enough for header
 
 	clear();
@@ -114,7 +143,7 @@ int ImageReader::init(const void * CAT_RESTRICT buffer, long fileSize) {
 
 	// Validate magic
 	u32 magic = readWord();
-	if CAT_UNLIKELY(magic != HEAD_MAGIC) {
+	if CAT_UNLIKELY(magic != HEAD_MAGIC && magic != CHANNELS_MAGIC) {
 		return GCIF_RE_BAD_HEAD;
 	}
 
@@ -122,6 +151,35 @@ int ImageReader::init(const void * CAT_RESTRICT buffer, long fileSize) {
 	_header.xsize = readBits(MAX_X_BITS);
 	_header.ysize = readBits(MAX_Y_BITS);
 
+	// If the image references a shared table dictionary,
+	_header.dict_id = 0;
+	_header.legacy = (magic == HEAD_MAGIC);
+	if (!_header.legacy && readBit()) {
+		_header.dict_id = readBits(DICT_ID_BITS);
+
+		// If no dictionary was given, hold the registered one until done
+		if (dict) {
+			_dict = dict;
+		} else {
+			_dict = EntropyDictionary::Acquire(_header.dict_id);
+			_dict_held = (_dict != 0);
+		}
+
+		if CAT_UNLIKELY(!_dict) {
+			return GCIF_RE_NO_DICT;
+		}
+	}
+
+	// Read the channel count
+	_header.channels = 4;
+	if (!_header.legacy) {
+		_header.channels = readBits(CHANNELS_BITS) + 1;
+
+		if CAT_UNLIKELY(_header.channels == 2) {
+			return GCIF_RE_BAD_HEAD;
+		}
+	}
+
 	return GCIF_RE_OK;
 }
 
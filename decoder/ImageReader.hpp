@@ -35,19 +35,44 @@
 
 namespace cat {
 
+class EntropyDictionary;
+
 
 //// ImageReader
 
 class ImageReader {
 public:
+	// Original layout: RGBA only, Huffman tables, no dictionary or substream
+	// flags.  Still decoded
 	static const u32 HEAD_MAGIC = 0x46494347; // "GCIF" (LE32)
+	static const u32 COLLECTION_MAGIC = 0x43494347; // "GCIC" (LE32)
 	static const u32 MAX_X_BITS = 14;
 	static const u32 MAX_X = (1 << MAX_X_BITS) - 1;
 	static const u32 MAX_Y_BITS = 14;
 	static const u32 MAX_Y = (1 << MAX_Y_BITS) - 1;
+	static const u32 DICT_ID_BITS = 8;
+
+	// Current layout: a dictionary flag, then the channel count, after the
+	// dimensions, an ANS flag on each entropy table, and a substream flag on
+	// RGBA pixel data.  Written for all images, including RGBA
+	static const u32 CHANNELS_MAGIC = 0x4e494347; // "GCIN" (LE32)
+	static const u32 CHANNELS_BITS = 2;
+
+	// Tiled images are made of independent images of at most MAX_X by MAX_Y
+	static const u32 TILED_MAGIC = 0x54494347; // "GCIT" (LE32)
+	static const u32 MIN_TILE_SIZE = 16;
+	static const u32 MAX_TILED_SIZE = 0x7fff;
+
+	// Large images are tiled with 32-bit dimensions and 64-bit tile offsets
+	static const u32 LARGE_MAGIC = 0x4c494347; // "GCIL" (LE32)
+	static const u32 MAX_LARGE_SIZE = 0x7fffffff;
+	static const u32 LARGE_TILE_SIZE = 1024;
 
 	struct Header {
 		u16 xsize, ysize; // pixels
+		u8 dict_id; // Shared table dictionary ID, or 0 for none
+		u8 channels; // 1 = gray, 3 = RGB, 4 = RGBA
+		bool legacy; // Original HEAD_MAGIC layout
 	};
 
 protected:
@@ -58,6 +83,9 @@ protected:
 
 	Header _header;
 
+	EntropyDictionary *_dict;
+	bool _dict_held;	// _dict was acquired from the registry
+
 	bool _eof;
 
 	const u32 * CAT_RESTRICT _words;
@@ -74,8 +102,11 @@ protected:
 public:
 	ImageReader() {
 		_words = 0;
+		_dict = 0;
+		_dict_held = false;
 	}
 	virtual ~ImageReader() {
+		clear();
 	}
 
 	CAT_INLINE int getTotalDataWords() {
@@ -86,16 +117,44 @@ public:
 		return _wordsLeft;
 	}
 
-	// Initialize with file or memory buffer
+	// Number of bits consumed so far
+	CAT_INLINE u64 getBitsRead() {
+		return (u64)(_wordCount - _wordsLeft) * 32 - _bitsLeft;
+	}
+
+	// Initialize with file or memory buffer.
+	// If dict is given, it is used instead of the registry for images that name a dictionary
 #ifdef CAT_COMPILE_MMAP
 	int init(const char * CAT_RESTRICT path);
 #endif // CAT_COMPILE_MMAP
-	int init(const void * CAT_RESTRICT buffer, long bytes);
+	int init(const void * CAT_RESTRICT buffer, long bytes, EntropyDictionary *dict = 0);
+
+	// Initialize as a headerless substream over the given words
+	void initStream(const u32 * CAT_RESTRICT words, int wordCount);
+
+	// Skip to the next word boundary and return the remaining words
+	CAT_INLINE const u32 * CAT_RESTRICT alignWords(int &wordsLeft) {
+		// Whole words still in the bit buffer are given back
+		const int buffered = _bitsLeft > 0 ? (_bitsLeft >> 5) : 0;
+
+		wordsLeft = _wordsLeft + buffered;
+		return _words - buffered;
+	}
 
 	CAT_INLINE Header *getHeader() {
 		return &_header;
 	}
 
+	// True if the image uses the original layout, which lacks the newer flags
+	CAT_INLINE bool isLegacy() {
+		return _header.legacy;
+	}
+
+	// Shared table dictionary named by the header, or 0 for none
+	CAT_INLINE EntropyDictionary *getDictionary() {
+		return _dict;
+	}
+
 	// Returns at least minBits in the high bits, supporting up to 32 bits
 	CAT_INLINE u32 peek(int minBits) {
 		if (_bitsLeft < minBits) {
@@ -262,10 +262,10 @@ bool MappedView::Open(MappedFile *file)
 	return true;
 }
 
-u8 *MappedView::MapView(u64 offset, u32 length)
+u8 *MappedView::MapView(u64 offset, u64 length)
 {
 	if (length == 0) {
-		length = static_cast<u32>( _file->GetLength() );
+		length = _file->GetLength();
 	}
 
 	if (offset) {
@@ -288,7 +288,7 @@ u8 *MappedView::MapView(u64 offset, u32 length)
 		flags |= FILE_MAP_WRITE;
 	}
 
-	_data = (u8*)MapViewOfFile(_map, flags, (u32)(offset >> 32), (u32)offset, length);
+	_data = (u8*)MapViewOfFile(_map, flags, (u32)(offset >> 32), (u32)offset, (SIZE_T)length);
 	if (!_data)
 	{
 		return 0;
@@ -301,7 +301,7 @@ u8 *MappedView::MapView(u64 offset, u32 length)
 		prot |= PROT_WRITE;
 	}
 
-	_map = mmap(0, length, prot, MAP_SHARED, _file->_file, offset);
+	_map = mmap(0, (size_t)length, prot, MAP_SHARED, _file->_file, offset);
 
 	if (_map == MAP_FAILED) {
 		return 0;
@@ -105,21 +105,21 @@ class CAT_EXPORT MappedView
 	MappedFile *_file;
 	u8 *_data;
 	u64 _offset;
-	u32 _length;
+	u64 _length;
 
 public:
 	MappedView();
 	~MappedView();
 
 	bool Open(MappedFile *file); // Returns false on error
-	u8 *MapView(u64 offset = 0, u32 length = 0); // Returns 0 on error, 0 length means whole file
+	u8 *MapView(u64 offset = 0, u64 length = 0); // Returns 0 on error, 0 length means whole file
 	void Close();
 
 	CAT_INLINE bool IsValid() { return _data != 0; }
 	CAT_INLINE MappedFile *GetFile() { return _file; }
 	CAT_INLINE u8 *GetFront() { return _data; }
 	CAT_INLINE u64 GetOffset() { return _offset; }
-	CAT_INLINE u32 GetLength() { return _length; }
+	CAT_INLINE u64 GetLength() { return _length; }
 };
 
 
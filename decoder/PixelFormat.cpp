@@ -0,0 +1,135 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "PixelFormat.hpp"
+#include "EndianNeutral.hpp"
+#include "Enforcer.hpp"
+using namespace cat;
+
+
+//// PixelFormat
+
+bool PixelFormat::init(int flags) {
+	static const int ALL_FLAGS = GCIF_FMT_PREMULTIPLY | GCIF_FMT_BGRA | NARROW_FLAGS | GCIF_FMT_NATIVE;
+
+	// If unknown flags are set or both 16-bit formats are requested,
+	if ((flags & ~ALL_FLAGS) != 0 || (flags & NARROW_FLAGS) == NARROW_FLAGS) {
+		return false;
+	}
+
+	// If native channels are combined with a conversion,
+	if ((flags & GCIF_FMT_NATIVE) && flags != GCIF_FMT_NATIVE) {
+		return false;
+	}
+
+	_flags = flags;
+	return true;
+}
+
+u32 PixelFormat::convert(u32 color) const {
+	const u32 rgba = getLE(color);
+	u32 r = (u8)rgba;
+	u32 g = (u8)(rgba >> 8);
+	u32 b = (u8)(rgba >> 16);
+	const u32 a = rgba >> 24;
+
+	// Scale color by alpha, rounding to nearest: x * a / 255
+	if (_flags & GCIF_FMT_PREMULTIPLY) {
+		u32 t = r * a + 128;
+		r = (t + (t >> 8)) >> 8;
+		t = g * a + 128;
+		g = (t + (t >> 8)) >> 8;
+		t = b * a + 128;
+		b = (t + (t >> 8)) >> 8;
+	}
+
+	if (_flags & GCIF_FMT_BGRA) {
+		const u32 temp = r;
+		r = b;
+		b = temp;
+	}
+
+	// 16-bit formats put the first channel in the high bits
+	if (_flags & GCIF_FMT_RGBA4444) {
+		return ((r >> 4) << 12) | ((g >> 4) << 8) | ((b >> 4) << 4) | (a >> 4);
+	}
+	if (_flags & GCIF_FMT_RGB565) {
+		return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+	}
+
+	return getLE(r | (g << 8) | (b << 16) | (a << 24));
+}
+
+void PixelFormat::convertRows(u8 * CAT_RESTRICT buffer, int xsize, int y0, int rows) const {
+	const u32 *src = reinterpret_cast<const u32 *>( buffer ) + y0 * xsize;
+	int count = xsize * rows;
+
+	// If output is 16 bits per pixel,
+	if (narrow()) {
+		// Writes trail the reads, so packing forward in place is safe
+		u16 *dst = reinterpret_cast<u16 *>( buffer ) + y0 * xsize;
+
+		while (count-- > 0) {
+			*dst++ = (u16)convert(*src++);
+		}
+	} else {
+		u32 *dst = const_cast<u32 *>( src );
+
+		while (count-- > 0) {
+			*dst = convert(*dst);
+			++dst;
+		}
+	}
+}
+
+void PixelFormat::narrowRows(u8 * CAT_RESTRICT buffer, int xsize, int y0, int rows) const {
+	CAT_DEBUG_ENFORCE(narrow());
+
+	const u32 *src = reinterpret_cast<const u32 *>( buffer ) + y0 * xsize;
+	u16 *dst = reinterpret_cast<u16 *>( buffer ) + y0 * xsize;
+	int count = xsize * rows;
+
+	while (count-- > 0) {
+		*dst++ = (u16)*src++;
+	}
+}
+
+void PixelFormat::packRGB(u8 * CAT_RESTRICT buffer, int xsize, int y0, int rows) {
+	const u8 *src = buffer + y0 * xsize * 4;
+	u8 *dst = buffer + y0 * xsize * 3;
+	int count = xsize * rows;
+
+	// Writes trail the reads, so packing forward in place is safe
+	while (count-- > 0) {
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+		dst += 3;
+		src += 4;
+	}
+}
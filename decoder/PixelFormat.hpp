@@ -0,0 +1,103 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PIXEL_FORMAT_HPP
+#define PIXEL_FORMAT_HPP
+
+#include "Platform.hpp"
+#include "GCIFReader.h"
+
+/*
+ * Output pixel format conversion
+ *
+ * The decoders produce RGBA pixels, and the spatial filters and LZ copies
+ * read earlier output back, so conversion to the caller's format is done
+ * once a scanline can no longer be referenced.  Palette readers convert
+ * their color tables instead, so they pay nothing per pixel.
+ *
+ * The 16-bit formats pack pixels to the front of the same buffer, which is
+ * still sized at 4 bytes per pixel while decoding.  Native RGB output is
+ * packed the same way once the image is done.
+ */
+
+namespace cat {
+
+
+//// PixelFormat
+
+class PixelFormat {
+	static const int NARROW_FLAGS = GCIF_FMT_RGBA4444 | GCIF_FMT_RGB565;
+
+	int _flags;
+
+public:
+	CAT_INLINE PixelFormat() {
+		_flags = 0;
+	}
+
+	// Returns false if the GCIF_FMT_* flag combination is not supported
+	bool init(int flags);
+
+	// No conversion is needed while decoding
+	CAT_INLINE bool passthrough() const {
+		return (_flags & ~GCIF_FMT_NATIVE) == 0;
+	}
+
+	// Gray and RGB images keep their channel count
+	CAT_INLINE bool native() const {
+		return (_flags & GCIF_FMT_NATIVE) != 0;
+	}
+
+	// Output pixels are 16 bits
+	CAT_INLINE bool narrow() const {
+		return (_flags & NARROW_FLAGS) != 0;
+	}
+
+	CAT_INLINE int bytesPerPixel() const {
+		return narrow() ? 2 : 4;
+	}
+
+	// Convert one color word in RGBA byte order.  Narrow formats return the
+	// 16-bit pixel in the low bits
+	u32 convert(u32 color) const;
+
+	// Convert RGBA rows [y0, y0 + rows) in place to the output layout.
+	// Rows must be converted in order for narrow formats
+	void convertRows(u8 * CAT_RESTRICT buffer, int xsize, int y0, int rows) const;
+
+	// Pack rows of color words that were already converted, for narrow formats
+	void narrowRows(u8 * CAT_RESTRICT buffer, int xsize, int y0, int rows) const;
+
+	// Pack RGBA rows in order to 3 bytes per pixel at the front of the buffer
+	static void packRGB(u8 * CAT_RESTRICT buffer, int xsize, int y0, int rows);
+};
+
+
+} // namespace cat
+
+#endif // PIXEL_FORMAT_HPP
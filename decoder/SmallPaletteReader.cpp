@@ -48,6 +48,13 @@ int SmallPaletteReader::readSmallPalette(ImageReader & CAT_RESTRICT reader) {
 		_palette[ii] = getLE(reader.readWord());
 	}
 
+	// Convert the palette once instead of each pixel
+	if (!_format->passthrough()) {
+		for (int ii = 0; ii < _palette_size; ++ii) {
+			_palette[ii] = _format->convert(_palette[ii]);
+		}
+	}
+
 	if (_palette_size > 4) { // 3-4 bits/pixel
 		_pack_x = (_xsize + 1) >> 1;
 		_pack_y = _ysize;
@@ -61,6 +68,19 @@ int SmallPaletteReader::readSmallPalette(ImageReader & CAT_RESTRICT reader) {
 		// Just emit that single color and done!
 		int count = _ysize * _xsize;
 		const u32 COLOR = _palette[0];
+
+		// If output is 16 bits per pixel,
+		if (_format->narrow()) {
+			u16 * CAT_RESTRICT pixel = reinterpret_cast<u16 *>( _rgba );
+
+			while (count > 0) {
+				*pixel++ = (u16)COLOR;
+				--count;
+			}
+
+			return GCIF_RE_OK;
+		}
+
 		u32 * CAT_RESTRICT rgba = reinterpret_cast<u32 *>( _rgba );
 
 		// Unroll sets of 4 words for this incredibly important case
@@ -463,15 +483,21 @@ int SmallPaletteReader::unpackPixels() {
 		}
 	}
 
+	// If output is 16 bits per pixel, pack the converted palette colors
+	if (_format->narrow()) {
+		_format->narrowRows(_rgba, _xsize, 0, _ysize);
+	}
+
 	return GCIF_RE_OK;
 }
 
-int SmallPaletteReader::readHead(ImageReader & CAT_RESTRICT reader, u8 * CAT_RESTRICT rgba) {
+int SmallPaletteReader::readHead(ImageReader & CAT_RESTRICT reader, u8 * CAT_RESTRICT rgba, const PixelFormat &format) {
 	// Initialize dimensions
 	ImageReader::Header *header = reader.getHeader();
 	_xsize = header->xsize;
 	_ysize = header->ysize;
 	_rgba = rgba;
+	_format = &format;
 
 #ifdef CAT_COLLECT_STATS
 	m_clock = Clock::ref();
@@ -34,6 +34,7 @@
 #include "ImageReader.hpp"
 #include "ImageMaskReader.hpp"
 #include "MonoReader.hpp"
+#include "PixelFormat.hpp"
 
 #include <vector>
 #include <map>
@@ -61,6 +62,7 @@ protected:
 
 	u8 * CAT_RESTRICT _rgba;
 	u16 _xsize, _ysize, _pack_x, _pack_y;
+	const PixelFormat *_format;	// Output pixel format
 
 	SmartArray<u8> _image;
 
@@ -98,7 +100,7 @@ public:
 		return _palette_size > 1;
 	}
 
-	int readHead(ImageReader & CAT_RESTRICT reader, u8 * CAT_RESTRICT rgba);
+	int readHead(ImageReader & CAT_RESTRICT reader, u8 * CAT_RESTRICT rgba, const PixelFormat &format);
 	int readTail(ImageReader & CAT_RESTRICT reader, ImageMaskReader & CAT_RESTRICT mask);
 
 	CAT_INLINE u16 getPackX() {
@@ -0,0 +1,77 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef STAGE_TIMER_HPP
+#define STAGE_TIMER_HPP
+
+#include "Platform.hpp"
+#include "GCIFReader.h"
+
+/*
+ * Runtime stage timing
+ *
+ * The CAT_COLLECT_STATS timers need the encoder's Clock singleton, which the
+ * stand-alone decoder does not link.  This is a monotonic nanosecond clock
+ * for the stats structs of gcif_read_ex() and gcif_write_ex2(), and it is
+ * only read when the caller asked for stats.
+ */
+
+namespace cat {
+
+
+//// StageTimer
+
+class StageTimer {
+	u64 _nsec, _bits;
+
+public:
+	CAT_INLINE StageTimer() {
+		_nsec = 0;
+		_bits = 0;
+	}
+
+	// Monotonic timestamp in nanoseconds
+	static u64 nsec();
+
+	// Mark the start of a stage, given the bit position of its stream
+	CAT_INLINE void start(u64 bits) {
+		_bits = bits;
+		_nsec = nsec();
+	}
+
+	// Add the elapsed time and bytes since start() to a stage
+	CAT_INLINE void stop(u64 bits, GCIFStageStats &stage) {
+		stage.nsec += nsec() - _nsec;
+		stage.bytes += (bits - _bits + 7) >> 3;
+	}
+};
+
+
+} // namespace cat
+
+#endif // STAGE_TIMER_HPP
@@ -0,0 +1,269 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ANSEncoder.hpp"
+#include <math.h>
+#include <vector>
+#include <algorithm>
+using namespace cat;
+
+
+//// ANSEncoder
+
+int ANSEncoder::simulateGolomb(u32 value) {
+	return BSR32(value + 1) * 2 + 1;
+}
+
+int ANSEncoder::writeGolomb(u32 value, ImageWriter &writer) {
+	const u32 code = value + 1;
+	const int len = BSR32(code);
+
+	// Zero prefix, then the code starting from its leading one bit
+	if (len > 0) {
+		writer.writeBits(0, len);
+	}
+	writer.writeBits(code, len + 1);
+
+	return len * 2 + 1;
+}
+
+int ANSEncoder::minTableBits(FreqHistogram &hist) {
+	int used = 0;
+	for (int ii = 0, iiend = hist.size(); ii < iiend; ++ii) {
+		if (hist.hist[ii] > 0) {
+			++used;
+		}
+	}
+
+	int table_bits = ANSDecoder::MIN_TABLE_BITS;
+	while ((1 << table_bits) < used) {
+		++table_bits;
+	}
+
+	return table_bits;
+}
+
+void ANSEncoder::normalize(FreqHistogram &hist, u32 total) {
+	const u32 table_size = 1 << _table_bits;
+	const u32 * CAT_RESTRICT counts = hist.hist.get();
+	u16 * CAT_RESTRICT freqs = _freqs.get();
+
+	// Sort key for rounding up: remainder in the high bits, symbol in the low bits
+	std::vector<u64> remainders;
+
+	u32 sum = 0;
+	for (int sym = 0; sym < _num_syms; ++sym) {
+		const u32 count = counts[sym];
+
+		if (count == 0) {
+			freqs[sym] = 0;
+			continue;
+		}
+
+		const u64 share = (u64)count * table_size;
+		u32 freq = (u32)(share / total);
+
+		// If it would round to zero, give it the smallest slot
+		if (freq == 0) {
+			freq = 1;
+		} else {
+			remainders.push_back(((share % total) << 16) | sym);
+		}
+
+		freqs[sym] = (u16)freq;
+		sum += freq;
+	}
+
+	// If slots are left over, round up the symbols that lost the most
+	if (sum < table_size) {
+		std::sort(remainders.begin(), remainders.end());
+
+		CAT_DEBUG_ENFORCE(table_size - sum <= remainders.size());
+
+		for (int ii = (int)remainders.size() - 1; sum < table_size; --ii) {
+			freqs[(u16)remainders[ii]]++;
+			++sum;
+		}
+	}
+
+	// If rare symbols took too many slots, take them back from the most common
+	while (sum > table_size) {
+		int best_sym = 0;
+		for (int sym = 1; sym < _num_syms; ++sym) {
+			if (freqs[best_sym] < freqs[sym]) {
+				best_sym = sym;
+			}
+		}
+
+		CAT_DEBUG_ENFORCE(freqs[best_sym] > 1);
+
+		freqs[best_sym]--;
+		--sum;
+	}
+}
+
+void ANSEncoder::init(FreqHistogram &hist, int table_bits) {
+	CAT_DEBUG_ENFORCE(table_bits >= ANSDecoder::MIN_TABLE_BITS && table_bits <= ANSDecoder::MAX_TABLE_BITS);
+
+	_num_syms = hist.size();
+	_table_bits = table_bits;
+	_freqs.resize(_num_syms);
+
+	u32 total = 0;
+	_used_syms = 0;
+	for (int sym = 0; sym < _num_syms; ++sym) {
+		const u32 count = hist.hist[sym];
+		if (count > 0) {
+			total += count;
+			++_used_syms;
+		}
+	}
+
+	CAT_DEBUG_ENFORCE(_used_syms <= (1 << table_bits));
+
+	// If the table is never used,
+	if (total == 0) {
+		_freqs.fill_00();
+		return;
+	}
+
+	normalize(hist, total);
+}
+
+u32 ANSEncoder::estimateBits(FreqHistogram &hist) {
+	double bits = 0;
+
+	for (int sym = 0; sym < _num_syms; ++sym) {
+		const u32 count = hist.hist[sym];
+
+		if (count > 0) {
+			bits += count * (_table_bits - log((double)_freqs[sym]) / log(2.));
+		}
+	}
+
+	return (u32)bits;
+}
+
+int ANSEncoder::simulateTable() {
+	int bits = 0;
+
+	for (int sym = 0; sym < _num_syms;) {
+		const u32 freq = _freqs[sym];
+
+		// If a run of unused symbols,
+		if (freq == 0) {
+			int run = 1;
+			while (sym + run < _num_syms && _freqs[sym + run] == 0) {
+				++run;
+			}
+
+			bits += simulateGolomb(0) + simulateGolomb(run - 1);
+			sym += run;
+		} else {
+			bits += simulateGolomb(freq);
+			++sym;
+		}
+	}
+
+	return bits;
+}
+
+int ANSEncoder::writeTable(ImageWriter &writer) {
+	int bits = 0;
+
+	for (int sym = 0; sym < _num_syms;) {
+		const u32 freq = _freqs[sym];
+
+		// If a run of unused symbols,
+		if (freq == 0) {
+			int run = 1;
+			while (sym + run < _num_syms && _freqs[sym + run] == 0) {
+				++run;
+			}
+
+			bits += writeGolomb(0, writer);
+			bits += writeGolomb(run - 1, writer);
+			sym += run;
+		} else {
+			bits += writeGolomb(freq, writer);
+			++sym;
+		}
+	}
+
+	return bits;
+}
+
+void ANSEncoder::initStates() {
+	const u32 table_size = 1 << _table_bits;
+	const u32 mask = table_size - 1;
+	const u32 step = ANSDecoder::spreadStep(table_size);
+
+	_first.resize(_num_syms);
+	_freq_bits.resize(_num_syms);
+	_states.resize(table_size);
+
+	// Lay out each symbol's states after the previous symbol's
+	u32 first = 0;
+	for (int sym = 0; sym < _num_syms; ++sym) {
+		const u32 freq = _freqs[sym];
+
+		_first[sym] = (u16)first;
+		_freq_bits[sym] = freq > 0 ? (u8)BSR32(freq) : 0;
+		first += freq;
+	}
+
+	// If the table is never used,
+	if (first == 0) {
+		return;
+	}
+
+	CAT_DEBUG_ENFORCE(first == table_size);
+
+	// Spread symbols over the table in the same order as the decoder
+	SmartArray<u16> spread;
+	spread.resize(table_size);
+
+	u32 pos = 0;
+	for (int sym = 0; sym < _num_syms; ++sym) {
+		for (int ii = 0, count = _freqs[sym]; ii < count; ++ii) {
+			spread[pos] = (u16)sym;
+			pos = (pos + step) & mask;
+		}
+	}
+
+	// Occurrences of each symbol are numbered in table order
+	SmartArray<u16> next;
+	next.resize(_num_syms);
+	for (int sym = 0; sym < _num_syms; ++sym) {
+		next[sym] = _first[sym];
+	}
+
+	for (u32 ii = 0; ii < table_size; ++ii) {
+		_states[next[spread[ii]]++] = (u16)(table_size + ii);
+	}
+}
@@ -0,0 +1,113 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CAT_ANS_ENCODER_HPP
+#define CAT_ANS_ENCODER_HPP
+
+#include "../decoder/ANSDecoder.hpp"
+#include "../decoder/BitMath.hpp"
+#include "HuffmanEncoder.hpp"
+#include "ImageWriter.hpp"
+
+/*
+ * Table-based Asymmetric Numeral System (tANS) Encoder
+ *
+ * The symbol histogram is normalized to a power-of-two table size L, and the
+ * symbols are spread over the table the same way as in ANSDecoder.hpp.
+ *
+ * ANS encodes in the reverse order of decoding, so the caller runs encode()
+ * over its symbols backwards, on state i % ANSDecoder::WAYS for symbol i, and
+ * stores the returned bit chunks.  The chunks
+ * are then written forward in the same places the symbols would have been
+ * written, which allows them to be mixed with other data in one bitstream.
+ */
+
+namespace cat {
+
+
+//// ANSEncoder
+
+class ANSEncoder {
+public:
+	// Encoded bit chunk: bit count in the low 4 bits, bits above
+	static const int CHUNK_LEN_BITS = 4;
+	static const u16 CHUNK_LEN_MASK = (1 << CHUNK_LEN_BITS) - 1;
+
+protected:
+	int _num_syms, _table_bits;
+	int _used_syms;
+
+	SmartArray<u16> _freqs;		// Normalized symbol frequencies
+	SmartArray<u16> _first;		// Start of each symbol in _states
+	SmartArray<u16> _states;	// Next states in [L, 2L) for each symbol occurrence
+	SmartArray<u8> _freq_bits;	// BSR32() of each nonzero frequency
+
+	void normalize(FreqHistogram &hist, u32 total);
+
+public:
+	static int simulateGolomb(u32 value);
+	static int writeGolomb(u32 value, ImageWriter &writer);
+
+	// Smallest table bits that give every used symbol of the histogram a slot
+	static int minTableBits(FreqHistogram &hist);
+
+	// Normalize the histogram to a table with 2^table_bits entries
+	void init(FreqHistogram &hist, int table_bits);
+
+	// Estimated bits to encode the histogram symbols with this table
+	u32 estimateBits(FreqHistogram &hist);
+
+	// Bits to write the normalized frequencies
+	int simulateTable();
+	int writeTable(ImageWriter &writer);
+
+	// Build the encoding table; call before encode()
+	void initStates();
+
+	// Encode a symbol with the given state in [L, 2L), returning the bit chunk to write
+	CAT_INLINE u16 encode(u16 sym, u32 &state) {
+		CAT_DEBUG_ENFORCE(sym < _num_syms && _freqs[sym] > 0);
+
+		const u32 freq = _freqs[sym];
+
+		// Shift the state down into [freq, 2 * freq)
+		int bits = BSR32(state) - _freq_bits[sym];
+		bits -= (state >> bits) < freq;
+
+		const u16 chunk = (u16)(((state & ((1 << bits) - 1)) << CHUNK_LEN_BITS) | bits);
+
+		state = _states[_first[sym] + (state >> bits) - freq];
+
+		return chunk;
+	}
+};
+
+
+} // namespace cat
+
+#endif // CAT_ANS_ENCODER_HPP
@@ -0,0 +1,270 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "DictionaryTrainer.hpp"
+#include "Log.hpp"
+#include <algorithm>
+using namespace cat;
+
+
+static void copyHist(FreqHistogram &hist, std::vector<u32> &out) {
+	const int num_syms = hist.size();
+
+	out.resize(num_syms);
+	for (int ii = 0; ii < num_syms; ++ii) {
+		out[ii] = hist.hist[ii];
+	}
+}
+
+static void pushLE16(std::vector<u8> &out, int x) {
+	out.push_back((u8)x);
+	out.push_back((u8)(x >> 8));
+}
+
+// Add a histogram normalized to unit weight onto a running sum
+static void accumulatePDF(const std::vector<u32> &hist, std::vector<double> &pdf) {
+	u64 total = 0;
+	for (int ii = 0, iiend = (int)hist.size(); ii < iiend; ++ii) {
+		total += hist[ii];
+	}
+
+	if (total > 0) {
+		const double scale = 1. / total;
+
+		for (int ii = 0, iiend = (int)hist.size(); ii < iiend; ++ii) {
+			pdf[ii] += hist[ii] * scale;
+		}
+	}
+}
+
+static bool sampleShapeLess(const DictionaryTrainer::Sample &a, const DictionaryTrainer::Sample &b) {
+	if (a.num_syms != b.num_syms) {
+		return a.num_syms < b.num_syms;
+	}
+	return a.zrle_syms < b.zrle_syms;
+}
+
+
+//// DictionaryTrainer
+
+void DictionaryTrainer::buildCodelens(const std::vector<double> &pdf, u8 *codelens) {
+	const int num_syms = (int)pdf.size();
+
+	double max_p = 0;
+	for (int ii = 0; ii < num_syms; ++ii) {
+		if (max_p < pdf[ii]) {
+			max_p = pdf[ii];
+		}
+	}
+
+	// Scale to 16-bit frequencies, giving every symbol a code
+	SmartArray<u16> freqs;
+	freqs.resize(num_syms);
+	for (int ii = 0; ii < num_syms; ++ii) {
+		u32 freq = 1;
+		if (max_p > 0) {
+			freq += (u32)(pdf[ii] / max_p * 65000.);
+		}
+		freqs[ii] = (u16)freq;
+	}
+
+	HuffmanEncoder encoder;
+	encoder.init(freqs.get(), num_syms);
+
+	memcpy(codelens, encoder._codelens.get(), num_syms);
+}
+
+u32 DictionaryTrainer::price(const std::vector<u32> &hist, const u8 *codelens) {
+	u32 bits = 0;
+
+	for (int ii = 0, iiend = (int)hist.size(); ii < iiend; ++ii) {
+		bits += hist[ii] * codelens[ii];
+	}
+
+	return bits;
+}
+
+void DictionaryTrainer::add(int num_syms, int zrle_syms, bool zrle, FreqHistogram &az, FreqHistogram &bz, FreqHistogram &basic) {
+	Sample sample;
+
+	sample.num_syms = num_syms;
+	sample.zrle_syms = zrle_syms;
+	sample.zrle = zrle;
+
+	copyHist(az, sample.az);
+	copyHist(bz, sample.bz);
+	copyHist(basic, sample.basic);
+
+	_samples.push_back(sample);
+}
+
+void DictionaryTrainer::trainShape(int first, int count, std::vector<u8> &out, int &table_count) {
+	const Sample *samples = &_samples[first];
+	const int num_syms = samples[0].num_syms;
+	const int zrle_syms = samples[0].zrle_syms;
+
+	// Pick the mode most images chose for this shape
+	int zrle_votes = 0;
+	for (int ii = 0; ii < count; ++ii) {
+		if (samples[ii].zrle) {
+			++zrle_votes;
+		}
+	}
+	const bool zrle = zrle_votes * 2 >= count;
+
+	const int az_syms = zrle ? num_syms : 0;
+	const int bz_syms = zrle ? num_syms + zrle_syms : num_syms;
+
+	int k = count;
+	if (k > MAX_TABLES_PER_SHAPE) {
+		k = MAX_TABLES_PER_SHAPE;
+	}
+
+	// Spread the initial assignment across the clusters
+	std::vector<int> assignment(count);
+	for (int ii = 0; ii < count; ++ii) {
+		assignment[ii] = ii % k;
+	}
+
+	std::vector<u8> az_lens(k * az_syms), bz_lens(k * bz_syms);
+	std::vector<int> members(k);
+
+	for (int iter = 0; iter < TRAIN_ITERATIONS; ++iter) {
+		// Build a table for each cluster from its member distributions
+		for (int c = 0; c < k; ++c) {
+			std::vector<double> az_pdf(az_syms, 0.), bz_pdf(bz_syms, 0.);
+
+			members[c] = 0;
+			for (int ii = 0; ii < count; ++ii) {
+				if (assignment[ii] == c) {
+					const Sample &s = samples[ii];
+
+					if (zrle) {
+						accumulatePDF(s.az, az_pdf);
+						accumulatePDF(s.bz, bz_pdf);
+					} else {
+						accumulatePDF(s.basic, bz_pdf);
+					}
+
+					++members[c];
+				}
+			}
+
+			if (zrle) {
+				buildCodelens(az_pdf, &az_lens[c * az_syms]);
+			}
+			buildCodelens(bz_pdf, &bz_lens[c * bz_syms]);
+		}
+
+		// Reassign each sample to the table that encodes it in the fewest bits
+		bool changed = false;
+		for (int ii = 0; ii < count; ++ii) {
+			const Sample &s = samples[ii];
+			int best = assignment[ii];
+			u32 best_bits = 0xffffffff;
+
+			for (int c = 0; c < k; ++c) {
+				if (members[c] <= 0) {
+					continue;
+				}
+
+				u32 bits;
+				if (zrle) {
+					bits = price(s.az, &az_lens[c * az_syms]) + price(s.bz, &bz_lens[c * bz_syms]);
+				} else {
+					bits = price(s.basic, &bz_lens[c * bz_syms]);
+				}
+
+				if (best_bits > bits) {
+					best_bits = bits;
+					best = c;
+				}
+			}
+
+			if (assignment[ii] != best) {
+				assignment[ii] = best;
+				changed = true;
+			}
+		}
+
+		if (!changed) {
+			break;
+		}
+	}
+
+	// Write out the tables that ended up with members
+	for (int c = 0; c < k; ++c) {
+		if (members[c] <= 0) {
+			continue;
+		}
+
+		pushLE16(out, num_syms);
+		pushLE16(out, zrle_syms);
+		out.push_back(zrle ? 1 : 0);
+
+		if (zrle) {
+			out.insert(out.end(), az_lens.begin() + c * az_syms, az_lens.begin() + (c + 1) * az_syms);
+		}
+		out.insert(out.end(), bz_lens.begin() + c * bz_syms, bz_lens.begin() + (c + 1) * bz_syms);
+
+		++table_count;
+	}
+}
+
+void DictionaryTrainer::train(int dict_id, std::vector<u8> &out) {
+	// Group samples by shape
+	std::stable_sort(_samples.begin(), _samples.end(), sampleShapeLess);
+
+	// Write header with table count filled in at the end
+	out.clear();
+	const u32 magic = EntropyDictionary::HEAD_MAGIC;
+	pushLE16(out, magic & 0xffff);
+	pushLE16(out, magic >> 16);
+	out.push_back((u8)dict_id);
+	out.push_back(0);
+	pushLE16(out, 0);
+
+	int table_count = 0;
+
+	// For each shape,
+	for (int ii = 0, iiend = (int)_samples.size(); ii < iiend;) {
+		int jj = ii + 1;
+		while (jj < iiend && !sampleShapeLess(_samples[ii], _samples[jj])) {
+			++jj;
+		}
+
+		trainShape(ii, jj - ii, out, table_count);
+
+		ii = jj;
+	}
+
+	out[6] = (u8)table_count;
+	out[7] = (u8)(table_count >> 8);
+
+	CAT_INANE("DictionaryTrainer") << "Trained " << table_count << " tables from " << _samples.size() << " encoders";
+}
@@ -0,0 +1,92 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef DICTIONARY_TRAINER_HPP
+#define DICTIONARY_TRAINER_HPP
+
+#include "../decoder/Platform.hpp"
+#include "../decoder/EntropyDictionary.hpp"
+#include "HuffmanEncoder.hpp"
+#include <vector>
+
+/*
+ * Game Closure Shared Table Dictionary Trainer
+ *
+ * Collects the symbol histograms of every EntropyEncoder table written while
+ * compressing a training set of images, and then clusters the histograms of
+ * each table shape into a few representative Huffman tables.
+ *
+ * Each image contributes equally to a cluster regardless of its size, since
+ * the point of the dictionary is to help images too small to pay for their
+ * own tables.  Every symbol gets a code in the trained tables so that any
+ * image can use them.
+ *
+ * See decoder/EntropyDictionary.hpp for the output file format.
+ */
+
+namespace cat {
+
+
+//// DictionaryTrainer
+
+class DictionaryTrainer {
+public:
+	static const int MAX_TABLES_PER_SHAPE = 4;	// Up to 2 bits to select a table
+	static const int TRAIN_ITERATIONS = 8;		// Clustering passes
+
+	struct Sample {
+		int num_syms, zrle_syms;
+		bool zrle;	// Chosen mode
+
+		std::vector<u32> az, bz, basic;
+	};
+
+protected:
+	std::vector<Sample> _samples;
+
+	static void buildCodelens(const std::vector<double> &pdf, u8 *codelens);
+	static u32 price(const std::vector<u32> &hist, const u8 *codelens);
+
+	void trainShape(int first, int count, std::vector<u8> &out, int &table_count);
+
+public:
+	// Record the histograms of one EntropyEncoder
+	void add(int num_syms, int zrle_syms, bool zrle, FreqHistogram &az, FreqHistogram &bz, FreqHistogram &basic);
+
+	CAT_INLINE int getSampleCount() {
+		return (int)_samples.size();
+	}
+
+	// Cluster the samples and produce dictionary file data
+	void train(int dict_id, std::vector<u8> &out);
+};
+
+
+} // namespace cat
+
+#endif // DICTIONARY_TRAINER_HPP
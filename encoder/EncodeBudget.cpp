@@ -0,0 +1,69 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "EncodeBudget.hpp"
+#include "../decoder/StageTimer.hpp"
+using namespace cat;
+
+
+//// EncodeBudget
+
+// Start and end of the budget for this thread, or 0 deadline for no limit
+static CAT_TLS u64 m_start = 0;
+static CAT_TLS u64 m_deadline = 0;
+
+EncodeBudget::EncodeBudget(int msec) {
+	_prev_start = m_start;
+	_prev_deadline = m_deadline;
+
+	// If a budget was requested,
+	if (msec > 0) {
+		m_start = StageTimer::nsec();
+		m_deadline = m_start + (u64)msec * 1000000;
+	}
+}
+
+EncodeBudget::~EncodeBudget() {
+	m_start = _prev_start;
+	m_deadline = _prev_deadline;
+}
+
+bool EncodeBudget::expired() {
+	return m_deadline != 0 && StageTimer::nsec() >= m_deadline;
+}
+
+bool EncodeBudget::spent(float fraction) {
+	// If there is no budget,
+	if (m_deadline == 0) {
+		return false;
+	}
+
+	const u64 elapsed = StageTimer::nsec() - m_start;
+
+	return elapsed >= (u64)((m_deadline - m_start) * (double)fraction);
+}
@@ -0,0 +1,73 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ENCODE_BUDGET_HPP
+#define ENCODE_BUDGET_HPP
+
+#include "../decoder/Platform.hpp"
+
+/*
+ * Encode Budget
+ *
+ * Bounds the wall time of an encode for callers with a latency target.  The
+ * writer opens an EncodeBudget scope for the calling thread, and the design
+ * searches that can run long poll it: filter tile revisits, chaos level
+ * search, tile size search, and LZ hash chain walks.  When the budget runs
+ * short they settle for the best choice found so far, which is always a
+ * valid encoding, so the file only gets larger rather than failing.
+ *
+ * The deadline is kept per thread like the tracer buffers, since an encode
+ * runs on one thread and the batch modes run several encodes at once.
+ */
+
+namespace cat {
+
+
+//// EncodeBudget
+
+class EncodeBudget {
+	u64 _prev_start, _prev_deadline;
+
+public:
+	// Start a budget of msec milliseconds from now for this thread.
+	// A budget of 0 leaves any enclosing budget in place
+	EncodeBudget(int msec);
+	~EncodeBudget();
+
+	// Returns true if this thread has spent its whole budget
+	static bool expired();
+
+	// Returns true if this thread has spent at least the given fraction of
+	// its budget, for deciding whether a costly phase can still fit
+	static bool spent(float fraction);
+};
+
+
+} // namespace cat
+
+#endif // ENCODE_BUDGET_HPP
@@ -27,8 +27,44 @@
 */
 
 #include "EntropyEncoder.hpp"
+#include "DictionaryTrainer.hpp"
+#include "../decoder/EntropyDictionary.hpp"
 using namespace cat;
 
+
+// Bits to encode the histogram with the given codelens, or -1 if a used symbol has no code
+static int priceCodelens(FreqHistogram &hist, const u8 *codelens) {
+	const int num_syms = hist.size();
+
+	// If only one symbol has a code, it is free to write
+	int used = 0;
+	for (int ii = 0; ii < num_syms; ++ii) {
+		if (codelens[ii]) {
+			++used;
+		}
+	}
+
+	int bits = 0;
+
+	for (int ii = 0; ii < num_syms; ++ii) {
+		const u32 count = hist.hist[ii];
+
+		if (count > 0) {
+			const u8 len = codelens[ii];
+
+			if (!len) {
+				return -1;
+			}
+
+			if (used > 1) {
+				bits += count * len;
+			}
+		}
+	}
+
+	return bits;
+}
+
 int EntropyEncoder::simulateZeroRun(int run) {
 	if (run <= 0) {
 		return 0;
@@ -54,11 +90,15 @@ int EntropyEncoder::writeZeroRun(int run, ImageWriter &writer) {
 
 	int bits;
 
-	if (run < _zrle_syms) {
+	if (_using_ans) {
+		bits = writeANSChunk(writer);
+	} else if (run < _zrle_syms) {
 		bits = _bz.writeSymbol(_num_syms + run - 1, writer);
 	} else {
 		bits = _bz.writeSymbol(_bz_tail_sym, writer);
+	}
 
+	if (run >= _zrle_syms) {
 		writer.write255255(run - _zrle_syms);
 	}
 
@@ -81,6 +121,10 @@ void EntropyEncoder::init(int num_syms, int zrle_syms) {
 	_runList.clear();
 	_basic_syms.clear();
 
+	_using_ans = false;
+	_ans_chunks.clear();
+	_ans_read_index = 0;
+
 #ifdef CAT_DEBUG
 	_basic_recall = 0;
 #endif
@@ -144,6 +188,7 @@ int EntropyEncoder::finalize() {
 	reset();
 
 	_using_basic = false;
+	_using_ans = false;
 
 	// Evaluate basic encoder
 	_basic.init(_basic_hist);
@@ -251,9 +296,342 @@ int EntropyEncoder::price(u16 symbol) {
 	}
 }
 
+int EntropyEncoder::chooseDictionaryTable(EntropyDictionary *dict, int first, int count) {
+	int explicit_bits;
+
+	// Price writing the tables explicitly
+	ImageWriter scratch;
+	scratch.init(0, 0);
+
+	if (!_using_basic) {
+		explicit_bits = _az.writeTable(scratch) + _bz.writeTable(scratch);
+		explicit_bits += priceCodelens(_az_hist, _az._codelens.get());
+		explicit_bits += priceCodelens(_bz_hist, _bz._codelens.get());
+	} else {
+		explicit_bits = _basic.writeTable(scratch);
+		explicit_bits += priceCodelens(_basic_hist, _basic._codelens.get());
+	}
+
+	int best_index = -1, best_bits = explicit_bits + 1;
+	const int index_bits = EntropyDictionary::indexBits(count);
+
+	// For each dictionary table of this shape,
+	for (int ii = 0; ii < count; ++ii) {
+		EntropyDictionary::Table *table = dict->getTable(first + ii);
+		int bits;
+
+		if (table->zrle) {
+			int az_bits = priceCodelens(_az_hist, table->az_codelens.get());
+			int bz_bits = priceCodelens(_bz_hist, table->bz_codelens.get());
+
+			if (az_bits < 0 || bz_bits < 0) {
+				continue;
+			}
+
+			bits = az_bits + bz_bits;
+		} else {
+			bits = priceCodelens(_basic_hist, table->bz_codelens.get());
+
+			if (bits < 0) {
+				continue;
+			}
+		}
+
+		bits += index_bits;
+
+		if (best_bits > bits) {
+			best_bits = bits;
+			best_index = ii;
+		}
+	}
+
+	return best_index;
+}
+
+u32 EntropyEncoder::encodeANS(bool basic) {
+	// Collect the symbols in the order they will be written
+	std::vector<u16> tokens;
+	static const u16 AZ_FLAG = 0x8000; // Symbol is coded with the after-zero table
+
+	if (basic) {
+		for (int ii = 0, iiend = (int)_basic_syms.size(); ii < iiend; ++ii) {
+			const u16 symbol = _basic_syms[ii];
+
+			// If not a fake zero,
+			if (symbol < FAKE_ZERO) {
+				tokens.push_back(symbol);
+			}
+		}
+	} else {
+		int run = 0, readIndex = 0;
+		for (int ii = 0, iiend = (int)_basic_syms.size(); ii < iiend; ++ii) {
+			u16 symbol = _basic_syms[ii];
+
+			// Convert fake zero to a zero
+			if (symbol == FAKE_ZERO) {
+				symbol = 0;
+			}
+
+			// If zero,
+			if (symbol == 0) {
+				// If starting a zero run,
+				if (run == 0) {
+					int code = _num_syms + _runList[readIndex++] - 1;
+					if (code > _bz_tail_sym) {
+						code = _bz_tail_sym;
+					}
+					tokens.push_back((u16)code);
+				}
+
+				++run;
+			} else {
+				// If just out of a zero run,
+				if (run > 0) {
+					run = 0;
+					tokens.push_back(symbol | AZ_FLAG);
+				} else {
+					tokens.push_back(symbol);
+				}
+			}
+		}
+	}
+
+	if (!basic) {
+		_az_ans.initStates();
+	}
+	_bz_ans.initStates();
+
+	// Encode backwards so the decoder reads the chunks forwards
+	const int count = (int)tokens.size();
+	const u32 table_size = 1 << _ans_table_bits;
+
+	for (int ii = 0; ii < ANSDecoder::WAYS; ++ii) {
+		_ans_states[ii] = table_size;
+	}
+
+	_ans_chunks.resize(count);
+
+	u32 bits = 0;
+	for (int ii = count - 1; ii >= 0; --ii) {
+		const u16 token = tokens[ii];
+		u32 &state = _ans_states[ii % ANSDecoder::WAYS];
+		u16 chunk;
+
+		if (token & AZ_FLAG) {
+			chunk = _az_ans.encode(token & ~AZ_FLAG, state);
+		} else {
+			chunk = _bz_ans.encode(token, state);
+		}
+
+		_ans_chunks[ii] = chunk;
+		bits += chunk & ANSEncoder::CHUNK_LEN_MASK;
+	}
+
+	return bits;
+}
+
+bool EntropyEncoder::chooseANS() {
+	_using_ans = false;
+
+	// Price the Huffman tables and symbols
+	ImageWriter scratch;
+	scratch.init(0, 0);
+
+	u32 extra_bits = 0;
+	for (int ii = 0, iiend = (int)_runList.size(); ii < iiend; ++ii) {
+		const int run = _runList[ii];
+
+		if (run >= _zrle_syms) {
+			extra_bits += ImageWriter::simulate255255(run - _zrle_syms);
+		}
+	}
+
+	u32 huffman_bits;
+	if (_using_basic) {
+		huffman_bits = _basic.writeTable(scratch);
+		huffman_bits += priceCodelens(_basic_hist, _basic._codelens.get());
+	} else {
+		huffman_bits = _az.writeTable(scratch) + _bz.writeTable(scratch);
+		huffman_bits += priceCodelens(_az_hist, _az._codelens.get());
+		huffman_bits += priceCodelens(_bz_hist, _bz._codelens.get());
+		huffman_bits += extra_bits;
+	}
+
+	// Header bits for zRLE flag and table size
+	const int header_bits = 1 + ANSDecoder::TABLE_BITS_BITS;
+
+	u32 best_bits = huffman_bits;
+	int best_table_bits = 0;
+	bool best_basic = false;
+
+	// For basic and zRLE symbols,
+	for (int basic = 0; basic < 2; ++basic) {
+		int min_bits, total = 0;
+
+		if (basic) {
+			min_bits = ANSEncoder::minTableBits(_basic_hist);
+			for (int ii = 0; ii < _num_syms; ++ii) {
+				total += _basic_hist.hist[ii];
+			}
+		} else {
+			min_bits = ANSEncoder::minTableBits(_bz_hist);
+			int az_bits = ANSEncoder::minTableBits(_az_hist);
+			if (min_bits < az_bits) {
+				min_bits = az_bits;
+			}
+			for (int ii = 0; ii < _bz_syms; ++ii) {
+				total += _bz_hist.hist[ii];
+			}
+			for (int ii = 0; ii < _az_syms; ++ii) {
+				total += _az_hist.hist[ii];
+			}
+		}
+
+		// Larger tables than the symbol count do not pay for their headers
+		int max_bits = min_bits;
+		while (max_bits < ANSDecoder::MAX_TABLE_BITS && (1 << max_bits) < total) {
+			++max_bits;
+		}
+
+		// For each table size,
+		for (int table_bits = min_bits; table_bits <= max_bits; ++table_bits) {
+			u32 bits = header_bits + table_bits * ANSDecoder::WAYS;
+
+			if (basic) {
+				_bz_ans.init(_basic_hist, table_bits);
+				bits += _bz_ans.simulateTable() + _bz_ans.estimateBits(_basic_hist);
+			} else {
+				_az_ans.init(_az_hist, table_bits);
+				_bz_ans.init(_bz_hist, table_bits);
+				bits += _az_ans.simulateTable() + _az_ans.estimateBits(_az_hist);
+				bits += _bz_ans.simulateTable() + _bz_ans.estimateBits(_bz_hist);
+				bits += extra_bits;
+			}
+
+			if (best_bits > bits) {
+				best_bits = bits;
+				best_table_bits = table_bits;
+				best_basic = basic != 0;
+			}
+		}
+	}
+
+	// If Huffman is estimated to be best,
+	if (best_table_bits == 0) {
+		return false;
+	}
+
+	// Encode with the best table size
+	_ans_table_bits = best_table_bits;
+	u32 bits = header_bits + best_table_bits * ANSDecoder::WAYS;
+
+	if (best_basic) {
+		_bz_ans.init(_basic_hist, best_table_bits);
+		bits += _bz_ans.simulateTable();
+	} else {
+		_az_ans.init(_az_hist, best_table_bits);
+		_bz_ans.init(_bz_hist, best_table_bits);
+		bits += _az_ans.simulateTable() + _bz_ans.simulateTable();
+		bits += extra_bits;
+	}
+
+	bits += encodeANS(best_basic);
+
+	// If the estimate was too optimistic,
+	if (bits >= huffman_bits) {
+		_ans_chunks.clear();
+		return false;
+	}
+
+	_using_ans = true;
+	_using_basic = best_basic;
+	return true;
+}
+
+int EntropyEncoder::writeANSTables(ImageWriter &writer) {
+	int bits = 1 + ANSDecoder::TABLE_BITS_BITS;
+
+	writer.writeBit(_using_basic ? 0 : 1);
+	writer.writeBits(_ans_table_bits - ANSDecoder::MIN_TABLE_BITS, ANSDecoder::TABLE_BITS_BITS);
+
+	if (!_using_basic) {
+		bits += _az_ans.writeTable(writer);
+	}
+	bits += _bz_ans.writeTable(writer);
+
+	// Write initial decoder states
+	const u32 table_size = 1 << _ans_table_bits;
+	for (int ii = 0; ii < ANSDecoder::WAYS; ++ii) {
+		writer.writeBits(_ans_states[ii] - table_size, _ans_table_bits);
+		bits += _ans_table_bits;
+	}
+
+	_ans_read_index = 0;
+
+	return bits;
+}
+
 int EntropyEncoder::writeTables(ImageWriter &writer) {
 	int bits = 0;
 
+	// If collecting statistics for dictionary training,
+	DictionaryTrainer *trainer = writer.getTrainer();
+	if (trainer) {
+		trainer->add(_num_syms, _zrle_syms, !_using_basic, _az_hist, _bz_hist, _basic_hist);
+	}
+
+	// If writing against a shared table dictionary,
+	EntropyDictionary *dict = writer.getDictionary();
+	if (dict) {
+		int first, count = dict->findTables(_num_syms, _zrle_syms, first);
+
+		// If it has tables of this shape,
+		if (count > 0) {
+			int index = chooseDictionaryTable(dict, first, count);
+
+			// If a dictionary table is cheaper,
+			if (index >= 0) {
+				writer.writeBit(1);
+				bits++;
+
+				const int index_bits = EntropyDictionary::indexBits(count);
+				if (index_bits > 0) {
+					writer.writeBits(index, index_bits);
+					bits += index_bits;
+				}
+
+				// Switch to the dictionary codes
+				EntropyDictionary::Table *table = dict->getTable(first + index);
+				if (table->zrle) {
+					_az.initFromCodelens(table->az_codelens.get(), _az_syms);
+					_bz.initFromCodelens(table->bz_codelens.get(), _bz_syms);
+					_using_basic = false;
+				} else {
+					_basic.initFromCodelens(table->bz_codelens.get(), _num_syms);
+					_using_basic = true;
+				}
+
+				return bits;
+			}
+
+			writer.writeBit(0);
+			bits++;
+		}
+	}
+
+#ifdef CAT_ENABLE_ANS
+	// If ANS is smaller than Huffman coding,
+	if (chooseANS()) {
+		writer.writeBit(1);
+		bits++;
+
+		return bits + writeANSTables(writer);
+	}
+#endif
+
+	writer.writeBit(0);
+	bits++;
+
 	if (!_using_basic) {
 		writer.writeBit(1);
 
@@ -285,6 +663,9 @@ int EntropyEncoder::write(u16 symbol, ImageWriter &writer) {
 		} else {
 			_zeroRun = 0;
 		}
+		if (_using_ans) {
+			return writeANSChunk(writer);
+		}
 		return _basic.writeSymbol(symbol, writer);
 	}
 
@@ -307,9 +688,9 @@ int EntropyEncoder::write(u16 symbol, ImageWriter &writer) {
 		// If just out of a zero run,
 		if (_zeroRun > 0) {
 			_zeroRun = 0;
-			bits += _az.writeSymbol(symbol, writer);
+			bits += _using_ans ? writeANSChunk(writer) : _az.writeSymbol(symbol, writer);
 		} else {
-			bits += _bz.writeSymbol(symbol, writer);
+			bits += _using_ans ? writeANSChunk(writer) : _bz.writeSymbol(symbol, writer);
 		}
 	}
 
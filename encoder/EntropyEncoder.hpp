@@ -31,6 +31,7 @@
 
 #include "ImageWriter.hpp"
 #include "HuffmanEncoder.hpp"
+#include "ANSEncoder.hpp"
 #include <vector>
 
 /*
@@ -52,6 +53,13 @@
  *
  * Alternatively, if normal Huffman encoding is more effective, it is used,
  * making this class much more generic.
+ *
+ * When the image is written against a shared table dictionary, a dictionary
+ * table is referenced instead of writing the tables if that is cheaper.
+ *
+ * Otherwise the same zRLE or basic symbols may be written with a tANS table
+ * (see ANSEncoder.hpp) when that is smaller than the Huffman codes, which
+ * helps on skewed data where Huffman wastes up to a bit per symbol.
  */
 
 namespace cat {
@@ -75,6 +83,14 @@ class EntropyEncoder {
 	HuffmanEncoder _basic;
 	bool _using_basic;
 
+	bool _using_ans;
+	ANSEncoder _bz_ans;
+	ANSEncoder _az_ans;
+	int _ans_table_bits;
+	u32 _ans_states[ANSDecoder::WAYS];
+	std::vector<u16> _ans_chunks; // Bit chunks for each symbol in write order
+	int _ans_read_index;
+
 	int _zeroRun;
 	std::vector<int> _runList;
 	int _runListReadIndex;
@@ -87,6 +103,27 @@ class EntropyEncoder {
 	int simulateZeroRun(int run);
 	int writeZeroRun(int run, ImageWriter &writer);
 
+	// Returns the dictionary table index to use, or -1 to write tables
+	int chooseDictionaryTable(EntropyDictionary *dict, int first, int count);
+
+	// Returns true if the ANS tables should be written instead of Huffman tables
+	bool chooseANS();
+	u32 encodeANS(bool basic);
+	int writeANSTables(ImageWriter &writer);
+
+	CAT_INLINE int writeANSChunk(ImageWriter &writer) {
+		CAT_DEBUG_ENFORCE(_ans_read_index < (int)_ans_chunks.size());
+
+		const u16 chunk = _ans_chunks[_ans_read_index++];
+		const int len = chunk & ANSEncoder::CHUNK_LEN_MASK;
+
+		if (len > 0) {
+			writer.writeBits(chunk >> ANSEncoder::CHUNK_LEN_BITS, len);
+		}
+
+		return len;
+	}
+
 public:
 	static const u16 FAKE_ZERO = 0xfffe;
 
@@ -103,6 +140,7 @@ public:
 
 		// Set the run list read index for writing
 		_runListReadIndex = 0;
+		_ans_read_index = 0;
 
 #ifdef CAT_DEBUG
 		_basic_recall = 0;
@@ -35,38 +35,46 @@ using namespace cat;
 
 //// EntropyEstimator
 
-static u32 calculateEntropy(u32 inst, u32 total) {
-	// Calculate fixed-point likelihood
-	u32 fpLikelihood = ((u64)inst << 24) / total;
+void EntropyEstimator::updateThresholds(u32 total) {
+	_thresh_total = total;
 
-	if (fpLikelihood <= 0) {
+	// Smallest instance count with fixed-point likelihood >= 2^k:
+	// ((u64)inst << 24) / total >= (1 << k)  <=>  inst >= ceil(total / 2^(24-k))
+	for (int k = 0; k < THRESH_COUNT; ++k) {
+		_thresh[k] = (u32)((((u64)total << k) + 0xffffff) >> 24);
+	}
+}
+
+CAT_INLINE u32 EntropyEstimator::codelen(u32 inst) {
+	if (inst < _thresh[0]) {
 		// Very unlikely: Give it the worst score we can
 		return 24;
-	} else if (fpLikelihood >= 0x800000) {
+	} else if (inst >= _thresh[23]) {
 		// Very likely: Give it the best score we can above 0
 		return 1;
-	} else if (fpLikelihood >= 0x8000) {
-		// Find MSB index using assembly code instruction intrinsic
-		int msb = BSR32(fpLikelihood);
-
-		// This is quantized log2(likelihood)
-		return 23 - msb;
-	} else {
-		// Adapted from the Stanford Bit Twiddling Hacks collection
-		u32 shift, r, x = fpLikelihood;
-		r = (x > 0xFF) << 3; x >>= r;
-		shift = (x > 0xF) << 2; x >>= shift; r |= shift;
-		shift = (x > 0x3) << 1; x >>= shift; r |= shift;
-		r |= (x >> 1);
-
-		// This is quantized log2(likelihood)
-		return 24 - r;
 	}
+
+	// Estimate MSB of the fixed-point likelihood from the operand MSBs,
+	// which is either exact or one too high
+	int msb = BSR32(inst) + 24 - BSR32(_thresh_total);
+	if (msb > 22) {
+		msb = 22;
+	} else if (msb < 0) {
+		msb = 0;
+	}
+	if (inst < _thresh[msb]) {
+		--msb;
+	}
+
+	// This is quantized log2(likelihood)
+	return msb >= 15 ? 23 - msb : 24 - msb;
 }
 
 void EntropyEstimator::init() {
 	_hist_total = 0;
 	CAT_OBJCLR(_hist);
+	CAT_OBJCLR(_block);
+	updateThresholds(1);
 }
 
 void EntropyEstimator::add(const u8 * CAT_RESTRICT symbols, int count) {
@@ -104,42 +112,42 @@ u32 EntropyEstimator::entropy(const u8 * CAT_RESTRICT symbols, int count) {
 		return 0;
 	}
 
-	u32 hist[NUM_SYMS] = {0};
+	u32 * CAT_RESTRICT block = _block;
 
 	// Generate histogram for symbols
 	for (int ii = 0; ii < count; ++ii) {
 		const u8 symbol = symbols[ii];
 
 		if (symbol > 0) {
-			hist[symbol]++;
+			block[symbol]++;
 		}
 	}
 
+	// If the total changed since last time,
+	const u32 total = _hist_total + count;
+	if (total != _thresh_total) {
+		updateThresholds(total);
+	}
+
 	// Calculate bits required for symbols
-	u8 codelens[NUM_SYMS] = {0};
 	u32 bits = 0;
-	const u32 total = _hist_total + count;
 
-	// If the total is nonzero,
-	if (total > 0) {
-		// For each symbol,
-		for (int ii = 0; ii < count; ++ii) {
-			const u8 symbol = symbols[ii];
-
-			// Zeroes are not counted towards entropy since they are the ideal
-			if (symbol > 0) {
-				// If codelen not determined yet,
-				if (!codelens[symbol]) {
-					// Get number of instances of this symbol out of total
-					u32 inst = _hist[symbol] + hist[symbol];
-
-					// Calculate codelen
-					codelens[symbol] = calculateEntropy(inst, total);
-				}
-
-				// Accumulate bits for symbol
-				bits += codelens[symbol];
-			}
+	// For each symbol,
+	for (int ii = 0; ii < count; ++ii) {
+		const u8 symbol = symbols[ii];
+		const u32 n = block[symbol];
+
+		// Zeroes are not counted towards entropy since they are the ideal;
+		// repeats were already charged on first sight
+		if (n > 0) {
+			// Get number of instances of this symbol out of total
+			const u32 inst = _hist[symbol] + n;
+
+			// Accumulate bits for all instances of the symbol
+			bits += codelen(inst) * n;
+
+			// Leave scratch histogram zeroed for next call
+			block[symbol] = 0;
 		}
 	}
 
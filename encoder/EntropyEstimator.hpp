@@ -51,6 +51,12 @@ namespace cat {
  *
  * Likelihood is defined as the number of times a symbol occurs divided by
  * the total number of occurrences of all symbols.
+ *
+ * Scoring is incremental: Only the symbols in the candidate block are touched,
+ * so the cost of entropy() is proportional to the block size rather than to
+ * the alphabet size.  The scratch histogram is left zeroed after each call,
+ * and the codelen of a symbol is found by comparing against a small table of
+ * likelihood thresholds that is rebuilt only when the running total changes.
  */
 
 class EntropyEstimator {
@@ -60,6 +66,17 @@ class EntropyEstimator {
 	u32 _hist[NUM_SYMS];
 	u32 _hist_total;
 
+	// Scratch histogram for the block being scored; zero between calls
+	u32 _block[NUM_SYMS];
+
+	// Minimum instance count for each likelihood bit, for _thresh_total
+	static const int THRESH_COUNT = 24;
+	u32 _thresh[THRESH_COUNT];
+	u32 _thresh_total;
+
+	void updateThresholds(u32 total);
+	u32 codelen(u32 inst);
+
 public:
 	void init();
 
@@ -31,7 +31,16 @@
 #include "ImageMaskWriter.hpp"
 #include "ImagePaletteWriter.hpp"
 #include "ImageRGBAWriter.hpp"
+#include "ImageGrayWriter.hpp"
 #include "SmallPaletteWriter.hpp"
+#include "DictionaryTrainer.hpp"
+#include "EncodeBudget.hpp"
+#include "Log.hpp"
+#include "../decoder/EntropyDictionary.hpp"
+#include "../decoder/ImageReader.hpp"
+#include "../decoder/EndianNeutral.hpp"
+#include "../decoder/MappedFile.hpp"
+#include "../decoder/StageTimer.hpp"
 using namespace cat;
 
 
@@ -45,6 +54,8 @@ extern "C" const char *gcif_write_errstr(int err) {
 		return "File access error:GCIF_WE_FILE";
 	case GCIF_WE_BUG:		// Internal error
 		return "IOno:GCIF_WE_BUG";
+	case GCIF_WE_NO_DICT:	// Dictionary ID is not registered
+		return "Dictionary not registered:GCIF_WE_NO_DICT";
 	default:
 		break;
 	}
@@ -106,6 +117,9 @@ static const GCIFKnobs DEFAULT_KNOBS[COMPRESS_LEVELS] = {
 		0,			// mono_revisitCount
 		2070,		// mono_lzPrematchLimit
 		512,		// mono_lzInmatchLimit
+
+		65536,		// rgba_streamThresh
+		0,			// budget_msec
 	},
 	{	// L1 Better
 		0,			// Bump
@@ -156,6 +170,9 @@ static const GCIFKnobs DEFAULT_KNOBS[COMPRESS_LEVELS] = {
 		0,			// mono_revisitCount
 		2070,		// mono_lzPrematchLimit
 		512,		// mono_lzInmatchLimit
+
+		65536,		// rgba_streamThresh
+		0,			// budget_msec
 	},
 	{	// L2 Harder
 		0,			// Bump
@@ -206,6 +223,9 @@ static const GCIFKnobs DEFAULT_KNOBS[COMPRESS_LEVELS] = {
 		0,			// mono_revisitCount
 		2070,		// mono_lzPrematchLimit
 		512,		// mono_lzInmatchLimit
+
+		65536,		// rgba_streamThresh
+		0,			// budget_msec
 	},
 	{	// L3 Stronger
 		0,			// Bump
@@ -256,6 +276,9 @@ static const GCIFKnobs DEFAULT_KNOBS[COMPRESS_LEVELS] = {
 		4096,		// mono_revisitCount
 		2070,		// mono_lzPrematchLimit
 		512,		// mono_lzInmatchLimit
+
+		65536,		// rgba_streamThresh
+		0,			// budget_msec
 	}
 };
 
@@ -278,38 +301,178 @@ void stripTransparentRGB(const u8 *rgba, int xsize, int ysize, SmartArray<u8> &i
 }
 
 
-extern "C" int gcif_write_ex(const void *pixels, int xsize, int ysize, const char *output_file_path, const GCIFKnobs *knobs, int strip_transparent_color) {
-	// Validate input
-	if (!pixels || xsize < 0 || ysize < 0 || !output_file_path || !*output_file_path) {
-		return GCIF_WE_BAD_PARAMS;
+// Returns true if every pixel has 255 alpha
+static bool isOpaque(const u8 *rgba, int xsize, int ysize) {
+	const u32 *p = reinterpret_cast<const u32 *>( rgba );
+	const u32 ALPHA_MASK = getLE(0xff000000);
+
+	// Accumulate alpha over each row so the early-out test is cheap
+	u32 a = ALPHA_MASK;
+	for (int y = 0; y < ysize; ++y) {
+		for (int x = 0; x < xsize; ++x) {
+			a &= p[x];
+		}
+
+		if (a != ALPHA_MASK) {
+			return false;
+		}
+
+		p += xsize;
+	}
+
+	return true;
+}
+
+// Expand RGB pixels to RGBA with opaque alpha for the color stages
+static void expandRGB(const u8 *rgb, int xsize, int ysize, SmartArray<u8> &image) {
+	image.resize(xsize * ysize * 4);
+
+	u8 *p = image.get();
+	for (int ii = 0, count = xsize * ysize; ii < count; ++ii) {
+		p[0] = rgb[0];
+		p[1] = rgb[1];
+		p[2] = rgb[2];
+		p[3] = 255;
+		rgb += 3;
+		p += 4;
+	}
+}
+
+
+// Times encoder stages and the bits they write, when stats are requested
+class WriteStageTimer {
+	ImageWriter &_writer;
+	bool _enabled;
+	u64 _nsec, _bits;
+
+public:
+	CAT_INLINE WriteStageTimer(ImageWriter &writer, bool enabled) : _writer(writer) {
+		_enabled = enabled;
+		_nsec = 0;
+		_bits = 0;
+	}
+
+	CAT_INLINE void start() {
+		if (_enabled) {
+			_bits = _writer.getBitCount();
+			_nsec = StageTimer::nsec();
+		}
+	}
+
+	// Only called when enabled
+	CAT_INLINE void stop(unsigned long long &nsec, unsigned long long &bytes) {
+		nsec += StageTimer::nsec() - _nsec;
+		bytes += (_writer.getBitCount() - _bits + 7) >> 3;
+	}
+};
+
+// Finalize the compressed image
+static int gcif_finalize(ImageWriter &writer, GCIFWriteStats *stats) {
+	// Output bytes are counted once the file is written
+	u64 t0 = 0;
+	if (stats) {
+		t0 = StageTimer::nsec();
+	}
+
+	writer.finalize();
+
+	if (stats) {
+		stats->output.nsec += StageTimer::nsec() - t0;
+	}
+
+	return GCIF_WE_OK;
+}
+
+static CAT_INLINE void clampKnob(int &knob, int limit) {
+	if (knob > limit) {
+		knob = limit;
+	}
+}
+
+// Knobs for the next stage.  Once the encode budget is spent, the search
+// knobs are clamped to the Faster preset and the caller's other knobs kept
+static const GCIFKnobs *gcif_budget_knobs(const GCIFKnobs *knobs, GCIFKnobs &clamped) {
+	// If there is time left, or the knobs are already clamped,
+	if (!EncodeBudget::expired() || knobs == &clamped) {
+		return knobs;
 	}
 
+	const GCIFKnobs *fast = &DEFAULT_KNOBS[0];
+
+	clamped = *knobs;
+	clamped.rgba_fastMode = true;
+	clampKnob(clamped.rgba_revisitCount, fast->rgba_revisitCount);
+	clampKnob(clamped.rgba_lzPrematchLimit, fast->rgba_lzPrematchLimit);
+	clampKnob(clamped.rgba_lzInmatchLimit, fast->rgba_lzInmatchLimit);
+	clampKnob(clamped.mono_revisitCount, fast->mono_revisitCount);
+	clampKnob(clamped.mono_lzPrematchLimit, fast->mono_lzPrematchLimit);
+	clampKnob(clamped.mono_lzInmatchLimit, fast->mono_lzInmatchLimit);
+	clamped.alpha_enableLZ = clamped.alpha_enableLZ && fast->alpha_enableLZ;
+	clamped.sf_enableLZ = clamped.sf_enableLZ && fast->sf_enableLZ;
+	clamped.cf_enableLZ = clamped.cf_enableLZ && fast->cf_enableLZ;
+
+	CAT_INFO("GCIF") << "Encode budget spent: clamping search knobs to the Faster preset";
+
+	return &clamped;
+}
+
+// Compress the image into the writer and finalize it
+static int gcif_encode(const void *pixels, int channels, int xsize, int ysize, const GCIFKnobs *knobs, int strip_transparent_color, EntropyDictionary *dict, ImageWriter &writer, GCIFWriteStats *stats) {
 	int err;
 
 	// Select RGBA data from input pixels
 	SmartArray<u8> image;
 	const u8 *rgba = reinterpret_cast<const u8*>( pixels );
 
-	// If stripping RGB color data from fully-transparent pixels,
-	if (strip_transparent_color) {
+	// If an RGBA image has constant 255 alpha, store it as RGB so that alpha
+	// design and alpha decoding are skipped.  It still reads back as RGBA
+	if (channels == 4 && isOpaque(rgba, xsize, ysize)) {
+		channels = 3;
+	} else if (channels == 3) {
+		// Expand RGB for the color stages, which then skip the alpha channel
+		expandRGB(rgba, xsize, ysize, image);
+		rgba = image.get();
+	} else if (channels == 4 && strip_transparent_color) {
 		// Make a copy of the image and strip out the RGB information from fully-transparent pixels
 		stripTransparentRGB(rgba, xsize, ysize, image);
 		rgba = image.get();
 	}
 
 	// Initialize image writer
-	ImageWriter writer;
-	if ((err = writer.init(xsize, ysize))) {
+	if ((err = writer.init(xsize, ysize, dict, channels))) {
 		return err;
 	}
 
+	WriteStageTimer timer(writer, stats != 0);
+
+	// If the image is grayscale, it goes straight to the monochrome compressor
+	if (channels == 1) {
+		timer.start();
+		ImageGrayWriter imageGrayWriter;
+		if ((err = imageGrayWriter.init(rgba, xsize, ysize, knobs))) {
+			return err;
+		}
+
+		imageGrayWriter.write(writer);
+		if (stats) {
+			timer.stop(stats->rgba.nsec, stats->rgba.bytes);
+		}
+		imageGrayWriter.dumpStats();
+
+		return gcif_finalize(writer, stats);
+	}
+
 	// Small Palette
+	timer.start();
 	SmallPaletteWriter smallPaletteWriter;
 	if ((err = smallPaletteWriter.init(rgba, xsize, ysize, knobs))) {
 		return err;
 	}
 
 	smallPaletteWriter.writeHead(writer);
+	if (stats) {
+		timer.stop(stats->small_palette.nsec, stats->small_palette.bytes);
+	}
 
 	// If small palette mode is enabled,
 	if (smallPaletteWriter.enabled()) {
@@ -320,78 +483,628 @@ extern "C" int gcif_write_ex(const void *pixels, int xsize, int ysize, const cha
 			const u8 *pack_image = smallPaletteWriter.get();
 
 			// Dominant Color Mask
+			timer.start();
 			ImageMaskWriter imageMaskWriter;
 			if ((err = imageMaskWriter.init(pack_image, 1, pack_x, pack_y, knobs))) {
 				return err;
 			}
 
 			imageMaskWriter.write(writer);
+			if (stats) {
+				timer.stop(stats->mask.nsec, stats->mask.bytes);
+			}
 			imageMaskWriter.dumpStats();
 
 			// Small Palette Compression
+			timer.start();
 			if ((err = smallPaletteWriter.compress(imageMaskWriter))) {
 				return err;
 			}
 
 			smallPaletteWriter.writeTail(writer);
+			if (stats) {
+				timer.stop(stats->small_palette.nsec, stats->small_palette.bytes);
+			}
 		}
 
 		smallPaletteWriter.dumpStats();
 	} else {
 		// Dominant Color Mask
+		timer.start();
 		ImageMaskWriter imageMaskWriter;
 		if ((err = imageMaskWriter.init(rgba, 4, xsize, ysize, knobs))) {
 			return err;
 		}
 
 		imageMaskWriter.write(writer);
+		if (stats) {
+			timer.stop(stats->mask.nsec, stats->mask.bytes);
+		}
 		imageMaskWriter.dumpStats();
 
+		// If the mask used up the encode budget, hurry through the rest
+		GCIFKnobs clamped;
+		knobs = gcif_budget_knobs(knobs, clamped);
+
 		// Global Palette
+		timer.start();
 		ImagePaletteWriter imagePaletteWriter;
 		if ((err = imagePaletteWriter.init(rgba, xsize, ysize, knobs, imageMaskWriter))) {
 			return err;
 		}
 
 		imagePaletteWriter.write(writer);
+		if (stats) {
+			timer.stop(stats->palette.nsec, stats->palette.bytes);
+		}
 		imagePaletteWriter.dumpStats();
 
 		if (!imagePaletteWriter.enabled()) {
+			// If palette analysis used up the encode budget, hurry through the rest
+			knobs = gcif_budget_knobs(knobs, clamped);
+
 			// Context Modeling Decompression
+			timer.start();
 			ImageRGBAWriter imageRGBAWriter;
-			if ((err = imageRGBAWriter.init(rgba, xsize, ysize, imageMaskWriter, knobs))) {
+			if ((err = imageRGBAWriter.init(rgba, xsize, ysize, imageMaskWriter, knobs, channels == 3))) {
 				return err;
 			}
 
 			imageRGBAWriter.write(writer);
+			if (stats) {
+				timer.stop(stats->rgba.nsec, stats->rgba.bytes);
+			}
 			imageRGBAWriter.dumpStats();
 		}
 	}
 
-	// Finalize file
-	writer.finalize();
+	return gcif_finalize(writer, stats);
+}
+
+// Where an encoded file goes: a mapped file, or a buffer from malloc()
+struct GCIFOutput {
+	const char *path;	// File to write, or 0 for a buffer
+	void *data;			// Buffer when path is 0
+	long bytes;
+
+	MappedFile file;
+	MappedView view;
+
+	CAT_INLINE GCIFOutput(const char *output_file_path) {
+		path = output_file_path;
+		data = 0;
+		bytes = 0;
+	}
+
+	// Returns the space to fill, or 0 on failure
+	u8 *open(u64 total_bytes) {
+		// If writing to a file,
+		if (path) {
+			if (!file.OpenWrite(path, total_bytes) || !view.Open(&file)) {
+				return 0;
+			}
+
+			return view.MapView();
+		}
+
+		// If the size does not fit the API,
+		if ((u64)(long)total_bytes != total_bytes) {
+			return 0;
+		}
+
+		data = malloc(total_bytes > 0 ? (size_t)total_bytes : 1);
+		bytes = (long)total_bytes;
+
+		return reinterpret_cast<u8 *>( data );
+	}
+};
+
+// Compress each tile as an independent image and write the tiled file
+static int gcif_write_tiles(const void *pixels, int channels, int xsize, int ysize, GCIFOutput &output, const GCIFKnobs *knobs, int strip_transparent_color, EntropyDictionary *dict, int tile_size, GCIFWriteStats *stats) {
+	if ((u32)xsize > ImageReader::MAX_LARGE_SIZE ||
+		(u32)ysize > ImageReader::MAX_LARGE_SIZE ||
+		tile_size < (int)ImageReader::MIN_TILE_SIZE ||
+		tile_size > (int)ImageWriter::MAX_X ||
+		tile_size > (int)ImageWriter::MAX_Y) {
+		return GCIF_WE_BAD_DIMS;
+	}
+
+	const u8 *rgba = reinterpret_cast<const u8 *>( pixels );
+	int err;
+
+	const int tiles_x = (xsize + tile_size - 1) / tile_size;
+	const int tiles_y = (ysize + tile_size - 1) / tile_size;
+	const u64 tile_count = (u64)tiles_x * tiles_y;
+
+	// Encoder memory is bounded by the tile size rather than the image size
+	SmartArray<u8> tile_rgba;
+	tile_rgba.resize(tile_size * tile_size * channels);
+
+	std::vector<u32> tile_data;
+	std::vector<u32> tile_words((size_t)tile_count);
+
+	u64 tile_index = 0;
+	for (int ty = 0; ty < tiles_y; ++ty) {
+		for (int tx = 0; tx < tiles_x; ++tx, ++tile_index) {
+			const int x0 = tx * tile_size, y0 = ty * tile_size;
+			const int tw = xsize - x0 < tile_size ? xsize - x0 : tile_size;
+			const int th = ysize - y0 < tile_size ? ysize - y0 : tile_size;
+
+			// Gather tile pixels
+			u8 *dst = tile_rgba.get();
+			for (int y = 0; y < th; ++y) {
+				memcpy(dst, rgba + ((u64)(y0 + y) * xsize + x0) * channels, tw * channels);
+				dst += tw * channels;
+			}
+
+			ImageWriter writer;
+			if ((err = gcif_encode(tile_rgba.get(), channels, tw, th, knobs, strip_transparent_color, dict, writer, stats))) {
+				return err;
+			}
+
+			const int word_count = writer.getWordCount();
+			tile_words[tile_index] = word_count;
+
+			const size_t tile_offset = tile_data.size();
+			tile_data.resize(tile_offset + word_count);
+			writer.write(&tile_data[tile_offset]);
+		}
+	}
+
+	// Use the large-image variant if the dimensions or file size need it
+	bool large = (u32)xsize > ImageReader::MAX_TILED_SIZE ||
+				 (u32)ysize > ImageReader::MAX_TILED_SIZE;
+	u64 head_words = 4 + tile_count * 2;
+
+	if ((head_words + tile_data.size()) * 4 > 0xffffffffULL) {
+		large = true;
+	}
+
+	if (large) {
+		head_words = 4 + tile_count * 3;
+	}
+
+	const u64 total_bytes = (head_words + tile_data.size()) * 4;
+
+	u64 t0 = 0;
+	if (stats) {
+		t0 = StageTimer::nsec();
+	}
 
 	// Write it out
-	if ((err = writer.write(output_file_path))) {
+	u8 *fileData = output.open(total_bytes);
+	if (!fileData) {
+		return GCIF_WE_FILE;
+	}
+
+	u32 *words = reinterpret_cast<u32 *>( fileData );
+	words[0] = getLE(large ? ImageReader::LARGE_MAGIC : ImageReader::TILED_MAGIC);
+	words[1] = getLE((u32)xsize);
+	words[2] = getLE((u32)ysize);
+	words[3] = getLE((u32)tile_size);
+
+	u32 *index = words + 4;
+	u64 offset = head_words * 4;
+	for (u64 ii = 0; ii < tile_count; ++ii) {
+		if (large) {
+			*index++ = getLE((u32)offset);
+			*index++ = getLE((u32)(offset >> 32));
+		} else {
+			*index++ = getLE((u32)offset);
+		}
+		*index++ = getLE(tile_words[ii] * 4);
+
+		offset += tile_words[ii] * 4;
+	}
+
+	// Tile words are already little-endian
+	if (tile_data.size() > 0) {
+		memcpy(words + head_words, &tile_data[0], tile_data.size() * 4);
+	}
+
+	if (stats) {
+		stats->output.nsec += StageTimer::nsec() - t0;
+		stats->output.bytes += total_bytes;
+	}
+
+	return GCIF_WE_OK;
+}
+
+static int gcif_write_output(const void *pixels, int channels, int xsize, int ysize, GCIFOutput &output, const GCIFKnobs *knobs, int strip_transparent_color, EntropyDictionary *dict, GCIFWriteStats *stats) {
+	// Validate input
+	if (!pixels || xsize < 0 || ysize < 0 ||
+		(channels != 1 && channels != 3 && channels != 4)) {
+		return GCIF_WE_BAD_PARAMS;
+	}
+
+	// Bound the encode time, including every tile of a large image
+	EncodeBudget budget(knobs->budget_msec);
+
+	// If the image is too large for a single image header, tile it
+	if (xsize > (int)ImageWriter::MAX_X || ysize > (int)ImageWriter::MAX_Y) {
+		return gcif_write_tiles(pixels, channels, xsize, ysize, output, knobs, strip_transparent_color, dict, ImageReader::LARGE_TILE_SIZE, stats);
+	}
+
+	int err;
+
+	ImageWriter writer;
+	if ((err = gcif_encode(pixels, channels, xsize, ysize, knobs, strip_transparent_color, dict, writer, stats))) {
 		return err;
 	}
 
+	u64 t0 = 0;
+	if (stats) {
+		t0 = StageTimer::nsec();
+	}
+
+	// Write it out
+	const u64 total_bytes = (u64)writer.getWordCount() * 4;
+
+	u8 *fileData = output.open(total_bytes);
+	if (!fileData) {
+		return GCIF_WE_FILE;
+	}
+
+	writer.write(reinterpret_cast<u32 *>( fileData ));
+
+	if (stats) {
+		stats->output.nsec += StageTimer::nsec() - t0;
+		stats->output.bytes += total_bytes;
+	}
+
 	return GCIF_WE_OK;
 }
 
-extern "C" int gcif_write(const void *rgba, int xsize, int ysize, const char *output_file_path, int compression_level, int strip_transparent_color) {
-	// Error on invalid input
-	if (compression_level < 0) {
+static int gcif_write_file(const void *pixels, int channels, int xsize, int ysize, const char *output_file_path, const GCIFKnobs *knobs, int strip_transparent_color, EntropyDictionary *dict, GCIFWriteStats *stats) {
+	// Validate input
+	if (!output_file_path || !*output_file_path) {
 		return GCIF_WE_BAD_PARAMS;
 	}
 
+	GCIFOutput output(output_file_path);
+
+	return gcif_write_output(pixels, channels, xsize, ysize, output, knobs, strip_transparent_color, dict, stats);
+}
+
+static const GCIFKnobs *gcif_level_knobs(int compression_level) {
 	// Limit to the available options
 	if (compression_level >= COMPRESS_LEVELS) {
 		compression_level = COMPRESS_LEVELS - 1;
 	}
 
-	const GCIFKnobs *knobs = &DEFAULT_KNOBS[compression_level];
+	return &DEFAULT_KNOBS[compression_level];
+}
+
+extern "C" int gcif_get_knobs(int compression_level, GCIFKnobs *knobs_out) {
+	// Error on invalid input
+	if (compression_level < 0 || !knobs_out) {
+		return GCIF_WE_BAD_PARAMS;
+	}
+
+	*knobs_out = *gcif_level_knobs(compression_level);
+
+	return GCIF_WE_OK;
+}
+
+extern "C" int gcif_write_ex(const void *pixels, int xsize, int ysize, const char *output_file_path, const GCIFKnobs *knobs, int strip_transparent_color) {
+	return gcif_write_file(pixels, 4, xsize, ysize, output_file_path, knobs, strip_transparent_color, 0, 0);
+}
+
+extern "C" int gcif_write_ex2(const void *pixels, int xsize, int ysize, const char *output_file_path, const GCIFKnobs *knobs, int strip_transparent_color, GCIFWriteStats *stats_out) {
+	// If not collecting stats,
+	if (!stats_out) {
+		return gcif_write_ex(pixels, xsize, ysize, output_file_path, knobs, strip_transparent_color);
+	}
+
+	CAT_OBJCLR(*stats_out);
+
+	const u64 t0 = StageTimer::nsec();
+
+	const int err = gcif_write_file(pixels, 4, xsize, ysize, output_file_path, knobs, strip_transparent_color, 0, stats_out);
+
+	stats_out->total_nsec = StageTimer::nsec() - t0;
+
+	return err;
+}
+
+extern "C" int gcif_write(const void *rgba, int xsize, int ysize, const char *output_file_path, int compression_level, int strip_transparent_color) {
+	// Error on invalid input
+	if (compression_level < 0) {
+		return GCIF_WE_BAD_PARAMS;
+	}
+
+	const GCIFKnobs *knobs = gcif_level_knobs(compression_level);
 
 	// Run with selected knobs
 	return gcif_write_ex(rgba, xsize, ysize, output_file_path, knobs, strip_transparent_color);
 }
+
+extern "C" int gcif_write_memory(const void *rgba, int xsize, int ysize, int compression_level, int strip_transparent_color, void **data_out, long *size_out) {
+	// Error on invalid input
+	if (compression_level < 0 || !data_out || !size_out) {
+		return GCIF_WE_BAD_PARAMS;
+	}
+
+	*data_out = 0;
+	*size_out = 0;
+
+	const GCIFKnobs *knobs = gcif_level_knobs(compression_level);
+
+	return gcif_write_memory_ex2(rgba, xsize, ysize, knobs, strip_transparent_color, data_out, size_out, 0);
+}
+
+extern "C" int gcif_write_memory_ex2(const void *rgba, int xsize, int ysize, const GCIFKnobs *knobs, int strip_transparent_color, void **data_out, long *size_out, GCIFWriteStats *stats_out) {
+	// Error on invalid input
+	if (!data_out || !size_out) {
+		return GCIF_WE_BAD_PARAMS;
+	}
+
+	*data_out = 0;
+	*size_out = 0;
+
+	u64 t0 = 0;
+	if (stats_out) {
+		CAT_OBJCLR(*stats_out);
+		t0 = StageTimer::nsec();
+	}
+
+	GCIFOutput output(0);
+
+	const int err = gcif_write_output(rgba, 4, xsize, ysize, output, knobs, strip_transparent_color, 0, stats_out);
+
+	if (stats_out) {
+		stats_out->total_nsec = StageTimer::nsec() - t0;
+	}
+
+	// If the buffer was allocated but not filled in,
+	if (err) {
+		free(output.data);
+		return err;
+	}
+
+	*data_out = output.data;
+	*size_out = output.bytes;
+
+	return GCIF_WE_OK;
+}
+
+extern "C" int gcif_write_channels(const void *pixels, int channels, int xsize, int ysize, const char *output_file_path, int compression_level, int strip_transparent_color) {
+	// Error on invalid input
+	if (compression_level < 0) {
+		return GCIF_WE_BAD_PARAMS;
+	}
+
+	const GCIFKnobs *knobs = gcif_level_knobs(compression_level);
+
+	return gcif_write_file(pixels, channels, xsize, ysize, output_file_path, knobs, strip_transparent_color, 0, 0);
+}
+
+extern "C" int gcif_write_dict(const void *rgba, int xsize, int ysize, const char *output_file_path, int compression_level, int strip_transparent_color, int dict_id) {
+	// Error on invalid input
+	if (compression_level < 0) {
+		return GCIF_WE_BAD_PARAMS;
+	}
+
+	// Hold the dictionary so it cannot be freed while writing
+	EntropyDictionary *dict = EntropyDictionary::Acquire(dict_id);
+	if (!dict) {
+		return GCIF_WE_NO_DICT;
+	}
+
+	const GCIFKnobs *knobs = gcif_level_knobs(compression_level);
+
+	int err = gcif_write_file(rgba, 4, xsize, ysize, output_file_path, knobs, strip_transparent_color, dict, 0);
+
+	EntropyDictionary::Release(dict);
+
+	return err;
+}
+
+
+//// Tiled images
+
+extern "C" int gcif_write_tiled(const void *rgba, int xsize, int ysize, const char *output_file_path, int compression_level, int strip_transparent_color, int tile_size) {
+	// Validate input
+	if (!rgba || xsize < 0 || ysize < 0 || compression_level < 0 ||
+		!output_file_path || !*output_file_path) {
+		return GCIF_WE_BAD_PARAMS;
+	}
+
+	const GCIFKnobs *knobs = gcif_level_knobs(compression_level);
+
+	GCIFOutput output(output_file_path);
+
+	return gcif_write_tiles(rgba, 4, xsize, ysize, output, knobs, strip_transparent_color, 0, tile_size, 0);
+}
+
+
+//// Dictionary training
+
+struct _GCIFTrainer {
+	DictionaryTrainer trainer;
+};
+
+extern "C" GCIFTrainer *gcif_train_begin() {
+	return new GCIFTrainer;
+}
+
+extern "C" int gcif_train_add(GCIFTrainer *trainer, const void *rgba, int xsize, int ysize, int compression_level, int strip_transparent_color) {
+	// Error on invalid input
+	if (!trainer || !rgba || xsize < 0 || ysize < 0 || compression_level < 0) {
+		return GCIF_WE_BAD_PARAMS;
+	}
+
+	const GCIFKnobs *knobs = gcif_level_knobs(compression_level);
+
+	// Compress without writing a file, collecting table statistics
+	ImageWriter writer;
+	writer.setTrainer(&trainer->trainer);
+
+	return gcif_encode(rgba, 4, xsize, ysize, knobs, strip_transparent_color, 0, writer, 0);
+}
+
+extern "C" int gcif_train_end(GCIFTrainer *trainer, int dict_id, const char *output_dict_path) {
+	if (!trainer) {
+		return GCIF_WE_BAD_PARAMS;
+	}
+
+	// Validate input
+	if (dict_id <= 0 || dict_id > EntropyDictionary::MAX_ID ||
+		!output_dict_path || !*output_dict_path) {
+		delete trainer;
+		return GCIF_WE_BAD_PARAMS;
+	}
+
+	std::vector<u8> data;
+	trainer->trainer.train(dict_id, data);
+	delete trainer;
+
+	// Write it out
+	MappedFile file;
+	if (!file.OpenWrite(output_dict_path, data.size())) {
+		return GCIF_WE_FILE;
+	}
+
+	MappedView fileView;
+	if (!fileView.Open(&file)) {
+		return GCIF_WE_FILE;
+	}
+
+	u8 *fileData = fileView.MapView();
+	if (!fileData) {
+		return GCIF_WE_FILE;
+	}
+
+	memcpy(fileData, &data[0], data.size());
+
+	return GCIF_WE_OK;
+}
+
+
+//// Collections
+
+extern "C" int gcif_write_collection(const GCIFCollectionEntry *entries, int count, const char *output_file_path, int compression_level, int strip_transparent_color) {
+	// Collection dictionaries are only ever referenced by the embedding file
+	static const int COLLECTION_DICT_ID = 1;
+
+	// Validate input
+	if (!entries || count < 0 || compression_level < 0 ||
+		!output_file_path || !*output_file_path) {
+		return GCIF_WE_BAD_PARAMS;
+	}
+
+	for (int ii = 0; ii < count; ++ii) {
+		const GCIFCollectionEntry *entry = entries + ii;
+
+		if (!entry->rgba || entry->xsize < 0 || entry->ysize < 0 || !entry->name) {
+			return GCIF_WE_BAD_PARAMS;
+		}
+	}
+
+	const GCIFKnobs *knobs = gcif_level_knobs(compression_level);
+	int err;
+
+	// Train shared tables on the whole collection
+	DictionaryTrainer trainer;
+
+	for (int ii = 0; ii < count; ++ii) {
+		const GCIFCollectionEntry *entry = entries + ii;
+
+		ImageWriter writer;
+		writer.setTrainer(&trainer);
+
+		if ((err = gcif_encode(entry->rgba, 4, entry->xsize, entry->ysize, knobs, strip_transparent_color, 0, writer, 0))) {
+			return err;
+		}
+	}
+
+	std::vector<u8> dict_data;
+	trainer.train(COLLECTION_DICT_ID, dict_data);
+
+	EntropyDictionary dict;
+	if (dict.init(&dict_data[0], (long)dict_data.size())) {
+		return GCIF_WE_BUG;
+	}
+
+	// Compress each entry against the shared tables
+	std::vector<u32> image_data;
+	std::vector<u32> image_words(count);
+
+	for (int ii = 0; ii < count; ++ii) {
+		const GCIFCollectionEntry *entry = entries + ii;
+
+		ImageWriter writer;
+		if ((err = gcif_encode(entry->rgba, 4, entry->xsize, entry->ysize, knobs, strip_transparent_color, &dict, writer, 0))) {
+			return err;
+		}
+
+		const int word_count = writer.getWordCount();
+		image_words[ii] = word_count;
+
+		const int image_offset = (int)image_data.size();
+		image_data.resize(image_offset + word_count);
+		writer.write(&image_data[image_offset]);
+	}
+
+	// Lay out the file: header, dictionary, index, then images
+	const u32 dict_words = ((u32)dict_data.size() + 3) / 4;
+	u32 offset = (3 + dict_words) * 4;
+
+	for (int ii = 0; ii < count; ++ii) {
+		const u32 name_bytes = (u32)strlen(entries[ii].name);
+		offset += 3 * 4 + ((name_bytes + 3) & ~3);
+	}
+
+	const u32 index_end = offset;
+	const u32 total_bytes = index_end + (u32)image_data.size() * 4;
+
+	// Write it out
+	MappedFile file;
+	if (!file.OpenWrite(output_file_path, total_bytes)) {
+		return GCIF_WE_FILE;
+	}
+
+	MappedView fileView;
+	if (!fileView.Open(&file)) {
+		return GCIF_WE_FILE;
+	}
+
+	u8 *fileData = fileView.MapView();
+	if (!fileData) {
+		return GCIF_WE_FILE;
+	}
+
+	memset(fileData, 0, total_bytes);
+
+	u32 *words = reinterpret_cast<u32 *>( fileData );
+	words[0] = getLE(ImageReader::COLLECTION_MAGIC);
+	words[1] = getLE((u32)count);
+	words[2] = getLE((u32)dict_data.size());
+
+	if (dict_data.size() > 0) {
+		memcpy(fileData + 3 * 4, &dict_data[0], dict_data.size());
+	}
+
+	u8 *index = fileData + (3 + dict_words) * 4;
+	offset = index_end;
+
+	for (int ii = 0; ii < count; ++ii) {
+		const u32 name_bytes = (u32)strlen(entries[ii].name);
+
+		u32 *entry_words = reinterpret_cast<u32 *>( index );
+		entry_words[0] = getLE(offset);
+		entry_words[1] = getLE(image_words[ii] * 4);
+		entry_words[2] = getLE(name_bytes);
+		memcpy(index + 3 * 4, entries[ii].name, name_bytes);
+		index += 3 * 4 + ((name_bytes + 3) & ~3);
+
+		offset += image_words[ii] * 4;
+	}
+
+	// Image words are already little-endian
+	if (image_data.size() > 0) {
+		memcpy(fileData + index_end, &image_data[0], image_data.size() * 4);
+	}
+
+	return GCIF_WE_OK;
+}
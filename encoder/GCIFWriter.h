@@ -41,8 +41,9 @@ enum WriteErrors {
 
 	GCIF_WE_BAD_PARAMS,	// Bad parameters passed to gcif_write
 	GCIF_WE_BAD_DIMS,	// Image dimensions are invalid
-	GCIF_WE_FILE,		// Unable to access file
-	GCIF_WE_BUG			// Internal error
+	GCIF_WE_FILE,		// Unable to access file or allocate output
+	GCIF_WE_BUG,		// Internal error
+	GCIF_WE_NO_DICT		// Dictionary ID is not registered
 };
 
 // Returns an error string for a return value from gcif_write()
@@ -125,15 +126,167 @@ struct GCIFKnobs {
 	int mono_revisitCount;			// 4096: Number of pixels to revisit
 	int mono_lzPrematchLimit;		// 2070: How far to walk the hash chain during LZ match finding on first pixel of a match
 	int mono_lzInmatchLimit;		// 512: How far to walk the hash chain during LZ match finding inside a match (for optimal matching)
+
+	//// Newer knobs are added here at the end, so existing initializers still line up
+	int rgba_streamThresh;			// 65536: Minimum pixel count to write Y/U/V/A/SF/CF data to separate substreams
+
+	// Soft wall time budget for the whole encode in milliseconds, or 0 for
+	// none.  As it runs short, design searches stop early and the search
+	// knobs of the remaining stages are clamped to the Faster preset
+	int budget_msec;				// 0
 };
 
+/*
+ * gcif_write_memory()
+ *
+ * Same as gcif_write() except the file is returned in memory instead of being
+ * written to disk.  On success *data_out points to *size_out bytes that must
+ * be released with free().
+ */
+int gcif_write_memory(const void *rgba, int xsize, int ysize, int compression_level, int strip_transparent_color, void **data_out, long *size_out);
+
+/*
+ * gcif_write_channels()
+ *
+ * Same as gcif_write() except the pixels have the given number of 8-bit
+ * channels, row-first with stride = xsize * channels:
+ *
+ * 		1 = Grayscale
+ * 		3 = RGB
+ * 		4 = RGBA, as in gcif_write()
+ *
+ * Grayscale images are compressed as a single plane, and RGB images skip the
+ * alpha channel, so both encode and decode faster than when expanded to RGBA
+ * first.  The channel count is stored in the file, and gcif_read_memory_ex()
+ * from GCIFReader.h can deliver the pixels with it by passing GCIF_FMT_NATIVE.
+ *
+ * RGBA images whose alpha is 255 everywhere are stored as RGB by every
+ * gcif_write function, and still read back as RGBA by default.
+ *
+ * strip_transparent_color only applies to RGBA images.
+ */
+int gcif_write_channels(const void *pixels, int channels, int xsize, int ysize, const char *output_file_path, int compression_level, int strip_transparent_color);
+
+/*
+ * gcif_get_knobs()
+ *
+ * Copy the preset knobs used for a compression level, as a starting point
+ * for gcif_write_ex().  Levels above the highest are clamped like gcif_write().
+ */
+int gcif_get_knobs(int compression_level, GCIFKnobs *knobs_out);
+
 /*
  * Same as gcif_write() except the compression level is replaced with the
  * knobs structure which gives you full control over the available options
  * controlling how the compressor works.
+ *
+ * Set knobs->budget_msec to bound the encode time.  The budget is a soft
+ * hint, not a deadline: the encoder trades compression for time as it runs
+ * short, but the file is always complete and valid, so the passes that
+ * every file needs still run after it has expired.  These take time in
+ * proportion to the image size, around 0.1 seconds for a 512x512 image.
  */
 int gcif_write_ex(const void *rgba, int xsize, int ysize, const char *output_file_path, const GCIFKnobs *knobs, int strip_transparent_color);
 
+// Per-stage encode statistics for gcif_write_ex2().  Stages that did not run
+// are left at zero.  Tiled output sums the stages over all tiles.
+typedef struct _GCIFWriteStats {
+	struct {
+		unsigned long long nsec;	// Wall time in nanoseconds
+		unsigned long long bytes;	// Compressed bytes written
+	} small_palette,	// Small palette analysis and pixels
+	  mask,				// Dominant color mask
+	  palette,			// Global palette analysis and pixels
+	  rgba,				// RGBA filters, LZ and entropy coding
+	  output;			// Finalizing and writing the file; bytes is the file size
+
+	unsigned long long total_nsec;	// Whole call
+} GCIFWriteStats;
+
+/*
+ * gcif_write_ex2()
+ *
+ * Same as gcif_write_ex(), and also fills in the time and compressed size
+ * of each encoder stage when stats_out is not null.
+ */
+int gcif_write_ex2(const void *rgba, int xsize, int ysize, const char *output_file_path, const GCIFKnobs *knobs, int strip_transparent_color, GCIFWriteStats *stats_out);
+
+/*
+ * gcif_write_memory_ex2()
+ *
+ * Same as gcif_write_ex2() except the file is returned in memory as with
+ * gcif_write_memory().  stats_out may be null.
+ */
+int gcif_write_memory_ex2(const void *rgba, int xsize, int ysize, const GCIFKnobs *knobs, int strip_transparent_color, void **data_out, long *size_out, GCIFWriteStats *stats_out);
+
+/*
+ * gcif_write_dict()
+ *
+ * Same as gcif_write() except the image is written against the shared table
+ * dictionary with the given ID, which must first be registered with
+ * gcif_set_dictionary() from GCIFReader.h.  Tables from the dictionary are
+ * referenced instead of being written out whenever that is smaller.
+ *
+ * The same dictionary must be registered to read the image back.
+ */
+int gcif_write_dict(const void *rgba, int xsize, int ysize, const char *output_file_path, int compression_level, int strip_transparent_color, int dict_id);
+
+
+/*
+ * gcif_write_tiled()
+ *
+ * Same as gcif_write() except the image is split into square tiles of the
+ * given size in pixels (256 is a good choice), each compressed as its own
+ * image so that gcif_read_region() from GCIFReader.h can decode just the
+ * tiles covering a rectangle.  The tile size must be at least 16.
+ *
+ * Tiles cannot share filters, palettes, or LZ matches, so expect the file to
+ * be a little larger than with gcif_write().
+ *
+ * Images wider or taller than 16383 pixels are always written tiled, even
+ * by gcif_write(), and files for images beyond 32767 pixels or 4 GB use a
+ * large-image header with 32-bit dimensions and 64-bit tile offsets.
+ */
+int gcif_write_tiled(const void *rgba, int xsize, int ysize, const char *output_file_path, int compression_level, int strip_transparent_color, int tile_size);
+
+
+/*
+ * Shared table dictionary training
+ *
+ * Compress a set of representative images with gcif_train_add(), and then
+ * call gcif_train_end() to cluster the tables they used into a dictionary
+ * file that can be loaded with gcif_set_dictionary().
+ *
+ * gcif_train_end() frees the trainer.
+ */
+typedef struct _GCIFTrainer GCIFTrainer;
+
+GCIFTrainer *gcif_train_begin();
+int gcif_train_add(GCIFTrainer *trainer, const void *rgba, int xsize, int ysize, int compression_level, int strip_transparent_color);
+int gcif_train_end(GCIFTrainer *trainer, int dict_id, const char *output_dict_path);
+
+
+/*
+ * gcif_write_collection()
+ *
+ * Pack a set of images into a single collection file (such as the sprites and
+ * icons that make up one UI theme) that can be opened with
+ * gcif_open_collection() from GCIFReader.h.
+ *
+ * A table dictionary is trained from the entries and embedded once in the
+ * collection, so each image only pays for the tables that differ from the
+ * rest of the set.  Palettes and filter choices stay per-image.
+ *
+ * Entry names must be unique for gcif_find_collection_entry() to be useful.
+ */
+typedef struct _GCIFCollectionEntry {
+	const void *rgba;	// Pixels as in gcif_write()
+	int xsize, ysize;
+	const char *name;	// Name used to look up the entry
+} GCIFCollectionEntry;
+
+int gcif_write_collection(const GCIFCollectionEntry *entries, int count, const char *output_file_path, int compression_level, int strip_transparent_color);
+
 
 #ifdef __cplusplus
 };
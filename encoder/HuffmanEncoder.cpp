@@ -477,6 +477,8 @@ void cat::collectFreqs(int num_syms, const std::vector<u8> &lz, u16 freqs[]) {
 				if (!count) {
 					count = 1;
 				}
+
+				hist[ii] = count;
 			}
 		}
 
@@ -507,6 +509,8 @@ void cat::normalizeFreqs(u32 max_freq, int num_syms, u32 hist[], u16 freqs[]) {
 				if (!count) {
 					count = 1;
 				}
+
+				hist[ii] = count;
 			}
 		}
 
@@ -221,6 +221,30 @@ public:
 		return true;
 	}
 
+	// Initialize from codelens, such as a shared dictionary table
+	CAT_INLINE void initFromCodelens(const u8 codelens[], int num_syms) {
+		_codes.resize(num_syms);
+		_codelens.resize(num_syms);
+
+		memcpy(_codelens.get(), codelens, num_syms);
+
+		// Find the degenerate single-symbol case like the decoder does
+		int used = 0;
+		_one_sym = 0;
+		for (int ii = 0; ii < num_syms; ++ii) {
+			if (codelens[ii] > 0) {
+				if (++used == 1) {
+					_one_sym = ii + 1;
+				}
+			}
+		}
+		if (used != 1) {
+			_one_sym = 0;
+		}
+
+		initCodes();
+	}
+
 	// Split this up because you can simulate writes without generating full codes
 	CAT_INLINE bool initCodelens(u16 freqs[], int num_syms) {
 		_codes.resize(num_syms);
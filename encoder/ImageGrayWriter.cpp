@@ -0,0 +1,141 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ImageGrayWriter.hpp"
+#include "Log.hpp"
+#include "Tracer.hpp"
+using namespace cat;
+
+
+#ifdef CAT_DESYNCH_CHECKS
+#define DESYNC_TABLE() writer.writeWord(1234567);
+#define DESYNC(x, y) writer.writeBits(x ^ 12345, 16); writer.writeBits(y ^ 54321, 16);
+#else
+#define DESYNC_TABLE()
+#define DESYNC(x, y)
+#endif
+
+
+//// ImageGrayWriter
+
+bool ImageGrayWriter::IsMasked(u16 x, u16 y) {
+	return false;
+}
+
+int ImageGrayWriter::init(const u8 *gray, int xsize, int ysize, const GCIFKnobs *knobs) {
+	CAT_TRACE_SPAN("Gray init");
+
+	_knobs = knobs;
+	_gray = gray;
+	_xsize = xsize;
+	_ysize = ysize;
+
+	if (xsize < 0 || ysize < 0) {
+		return GCIF_WE_BAD_DIMS;
+	}
+
+	MonoWriter::Parameters params;
+	params.knobs = knobs;
+	params.data = gray;
+	params.num_syms = 256;
+	params.xsize = xsize;
+	params.ysize = ysize;
+	params.max_filters = 32;
+	params.min_bits = 2;
+	params.max_bits = 5;
+	params.sympal_thresh = knobs->alpha_sympalThresh;
+	params.filter_cover_thresh = knobs->alpha_filterCoverThresh;
+	params.filter_inc_thresh = knobs->alpha_filterIncThresh;
+	params.mask.SetMember<ImageGrayWriter, &ImageGrayWriter::IsMasked>(this);
+	params.mask_bitmap = 0;
+	params.AWARDS[0] = knobs->alpha_awards[0];
+	params.AWARDS[1] = knobs->alpha_awards[1];
+	params.AWARDS[2] = knobs->alpha_awards[2];
+	params.AWARDS[3] = knobs->alpha_awards[3];
+	params.award_count = 4;
+	params.write_order = 0;
+	params.lz_enable = knobs->alpha_enableLZ;
+
+	_mono_writer.init(params);
+
+	return GCIF_WE_OK;
+}
+
+void ImageGrayWriter::write(ImageWriter &writer) {
+	CAT_TRACE_SPAN("Gray write");
+
+	writeTable(writer);
+	writePixels(writer);
+}
+
+void ImageGrayWriter::writeTable(ImageWriter &writer) {
+	int mono_bits = _mono_writer.writeTables(writer);
+
+	DESYNC_TABLE();
+
+#ifdef CAT_COLLECT_STATS
+	Stats.mono_overhead_bits = mono_bits;
+#endif
+}
+
+void ImageGrayWriter::writePixels(ImageWriter &writer) {
+	int bits = 0;
+
+	for (int y = 0; y < _ysize; ++y) {
+		bits += _mono_writer.writeRowHeader(y, writer);
+
+		for (int x = 0; x < _xsize; ++x) {
+			DESYNC(x, y);
+
+			bits += _mono_writer.write(x, y, writer);
+		}
+	}
+
+#ifdef CAT_COLLECT_STATS
+	Stats.mono_bits = bits;
+	Stats.total_bits = Stats.mono_overhead_bits + bits;
+	Stats.pixel_count = _xsize * _ysize;
+	Stats.compression_ratio = Stats.pixel_count * 8 / (double)Stats.total_bits;
+#endif
+}
+
+
+#ifdef CAT_COLLECT_STATS
+
+bool ImageGrayWriter::dumpStats() {
+	_mono_writer.dumpStats();
+
+	CAT_INANE("stats") << "(Gray compress)  Monochrome Table : " << Stats.mono_overhead_bits / 8 << " bytes (" << Stats.mono_overhead_bits * 100.f / Stats.total_bits << "% total)";
+	CAT_INANE("stats") << "(Gray compress) Monochrome Pixels : " << Stats.mono_bits / 8 << " bytes (" << Stats.mono_bits * 100.f / Stats.total_bits << "% total)";
+	CAT_INANE("stats") << "(Gray compress)       Pixel Count : " << Stats.pixel_count;
+	CAT_INANE("stats") << "(Gray compress) Compression Ratio : " << Stats.compression_ratio << ":1 compression ratio";
+
+	return true;
+}
+
+#endif
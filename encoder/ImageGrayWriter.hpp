@@ -0,0 +1,89 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IMAGE_GRAY_WRITER_HPP
+#define IMAGE_GRAY_WRITER_HPP
+
+#include "../decoder/Platform.hpp"
+#include "ImageWriter.hpp"
+#include "GCIFWriter.h"
+#include "MonoWriter.hpp"
+
+/*
+ * Game Closure Grayscale Compression
+ *
+ * One-channel images go straight to the Mono compressor, skipping the mask,
+ * palette and RGBA stages that would only find three equal color channels
+ * and constant alpha.  The plane is compressed like the alpha channel of an
+ * RGBA image, with the same knobs.
+ */
+
+namespace cat {
+
+
+//// ImageGrayWriter
+
+class ImageGrayWriter {
+	const GCIFKnobs *_knobs;
+	const u8 *_gray;		// Original image
+	int _xsize, _ysize;	// In pixels
+
+	MonoWriter _mono_writer;
+
+	bool IsMasked(u16 x, u16 y);
+
+	void writeTable(ImageWriter &writer);
+	void writePixels(ImageWriter &writer);
+
+#ifdef CAT_COLLECT_STATS
+public:
+	struct _Stats {
+		int mono_overhead_bits, mono_bits;
+		int total_bits, pixel_count;
+		double compression_ratio;
+	} Stats;
+#endif
+
+public:
+	int init(const u8 *gray, int xsize, int ysize, const GCIFKnobs *knobs);
+
+	void write(ImageWriter &writer);
+
+#ifdef CAT_COLLECT_STATS
+	bool dumpStats();
+#else
+	CAT_INLINE bool dumpStats() {
+		return false;
+	}
+#endif
+};
+
+
+} // namespace cat
+
+#endif // IMAGE_GRAY_WRITER_HPP
@@ -34,6 +34,8 @@
 #include "../decoder/Filters.hpp"
 #include "GCIFWriter.h"
 #include "Log.hpp"
+#include "Tracer.hpp"
+#include "EncodeBudget.hpp"
 #ifdef CAT_COLLECT_STATS
 #include "Clock.hpp"
 #endif // CAT_COLLECT_STATS
@@ -469,19 +471,25 @@ u32 ImageMaskWriter::dominantRGBA() {
 
 	// Histogram all image colors
 	const u32 *pixel = reinterpret_cast<const u32 *>( _rgba );
-	int count = _xsize * _ysize;
 	u32 zeroes = 0;
-	while (count--) {
-		u32 p = *pixel++;
+	for (int y = 0; y < _ysize; ++y) {
+		for (int x = 0; x < _xsize; ++x) {
+			u32 p = *pixel++;
 
-		u32 op = getLE(p);
-		u8 bin = op >> (32 - BINS_BITS);
+			u32 op = getLE(p);
+			u8 bin = op >> (32 - BINS_BITS);
 
-		// If non-zero,
-		if (op >> 24) {
-			bins[bin][p]++;
-		} else {
-			++zeroes;
+			// If non-zero,
+			if (op >> 24) {
+				bins[bin][p]++;
+			} else {
+				++zeroes;
+			}
+		}
+
+		// If out of time, choose from the rows seen so far
+		if (EncodeBudget::expired()) {
+			break;
 		}
 	}
 
@@ -502,6 +510,8 @@ u32 ImageMaskWriter::dominantRGBA() {
 }
 
 int ImageMaskWriter::init(const u8 *rgba, int planes, int xsize, int ysize, const GCIFKnobs *knobs) {
+	CAT_TRACE_SPAN("Mask init");
+
 	_knobs = knobs;
 	_rgba = rgba;
 	_xsize = xsize;
@@ -525,6 +535,8 @@ int ImageMaskWriter::init(const u8 *rgba, int planes, int xsize, int ysize, cons
 }
 
 void ImageMaskWriter::write(ImageWriter &writer) {
+	CAT_TRACE_SPAN("Mask write");
+
 	bool use_color = _color.evaluate();
 
 	_color.write(writer);
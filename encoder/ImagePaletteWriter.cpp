@@ -33,6 +33,7 @@
 #include "EntropyEstimator.hpp"
 #include "EntropyEncoder.hpp"
 #include "PaletteOptimizer.hpp"
+#include "Tracer.hpp"
 using namespace cat;
 using namespace std;
 
@@ -58,7 +59,7 @@ bool ImagePaletteWriter::generatePalette() {
 		for (int x = 0, xend = _xsize; x < xend; ++x) {
 			u32 c = *color++;
 
-			if (IsMasked(x, y)) {
+			if (_mask_bitmap.masked(x, y)) {
 				continue;
 			}
 
@@ -130,7 +131,7 @@ void ImagePaletteWriter::generateImage() {
 
 	for (int y = 0; y < _ysize; ++y) {
 		for (int x = 0, xend = _xsize; x < xend; ++x, ++image, ++color) {
-			image[0] = _mask->masked(x, y) ? masked_palette : _map[color[0]];
+			image[0] = _mask_bitmap.masked(x, y) ? masked_palette : _map[color[0]];
 		}
 	}
 }
@@ -138,8 +139,7 @@ void ImagePaletteWriter::generateImage() {
 void ImagePaletteWriter::optimizeImage() {
 	CAT_INANE("Palette") << "Optimizing palette with " << _palette_size << " entries...";
 
-	_optimizer.process(_image.get(), _xsize, _ysize, _palette_size,
-		PaletteOptimizer::MaskDelegate::FromMember<ImagePaletteWriter, &ImagePaletteWriter::IsMasked>(this));
+	_optimizer.process(_image.get(), _xsize, _ysize, _palette_size, _mask_bitmap);
 
 #ifdef CAT_DEBUG
 	const u8 *p = _image.get();
@@ -188,6 +188,7 @@ void ImagePaletteWriter::generateMonoWriter() {
 	params.filter_cover_thresh = _knobs->pal_filterCoverThresh;
 	params.filter_inc_thresh = _knobs->pal_filterIncThresh;
 	params.mask.SetMember<ImagePaletteWriter, &ImagePaletteWriter::IsMasked>(this);
+	params.mask_bitmap = &_mask_bitmap;
 	params.AWARDS[0] = _knobs->pal_awards[0];
 	params.AWARDS[1] = _knobs->pal_awards[1];
 	params.AWARDS[2] = _knobs->pal_awards[2];
@@ -200,6 +201,8 @@ void ImagePaletteWriter::generateMonoWriter() {
 }
 
 int ImagePaletteWriter::init(const u8 *rgba, int xsize, int ysize, const GCIFKnobs *knobs, ImageMaskWriter &mask) {
+	CAT_TRACE_SPAN("Palette init");
+
 	_knobs = knobs;
 	_rgba = rgba;
 	_xsize = xsize;
@@ -209,6 +212,9 @@ int ImagePaletteWriter::init(const u8 *rgba, int xsize, int ysize, const GCIFKno
 	// Off by default
 	_palette_size = 0;
 
+	// Sample dominant color mask for the inner loops
+	_mask_bitmap.init(xsize, ysize, MaskBitmap::MaskDelegate::FromMember<ImagePaletteWriter, &ImagePaletteWriter::IsMasked>(this));
+
 	// If palette was generated,
 	if (generatePalette()) {
 		// Generate palette raster
@@ -229,6 +235,8 @@ bool ImagePaletteWriter::IsMasked(u16 x, u16 y) {
 }
 
 void ImagePaletteWriter::write(ImageWriter &writer) {
+	CAT_TRACE_SPAN("Palette write");
+
 	if (enabled()) {
 		writer.writeBit(1);
 		writeTable(writer);
@@ -377,7 +385,7 @@ void ImagePaletteWriter::writePixels(ImageWriter &writer) {
 		for (int x = 0; x < _xsize; ++x) {
 			DESYNC(x, y);
 
-			if (IsMasked(x, y)) {
+			if (_mask_bitmap.masked(x, y)) {
 				_mono_writer.zero(x);
 			} else {
 				bits += _mono_writer.write(x, y, writer);
@@ -37,6 +37,7 @@
 #include "MonoWriter.hpp"
 #include "../decoder/SmartArray.hpp"
 #include "PaletteOptimizer.hpp"
+#include "MaskBitmap.hpp"
 
 #include <vector>
 #include <map>
@@ -72,6 +73,7 @@ class ImagePaletteWriter {
 	u8 _masked_palette;		// Palette index for the mask
 
 	ImageMaskWriter *_mask;
+	MaskBitmap _mask_bitmap;	// Dominant color mask sampled once
 
 	PaletteOptimizer _optimizer;
 	std::vector<u32> _palette;		// Map index => color
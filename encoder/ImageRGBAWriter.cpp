@@ -37,6 +37,8 @@
 #include "lz4hc.h"
 #include "Log.hpp"
 #include "HuffmanEncoder.hpp"
+#include "Tracer.hpp"
+#include "EncodeBudget.hpp"
 
 using namespace cat;
 using namespace std;
@@ -57,45 +59,50 @@ using namespace std;
 void ImageRGBAWriter::priceResiduals() {
 	CAT_INANE("RGBA") << "Assigning approximate bit costs to residuals...";
 
-	_encoders->chaos.start();
+	RGBChaos &chaos = _encoders->chaos;
 
-	for (int ii = 0, iiend = _encoders->chaos.getBinCount(); ii < iiend; ++ii) {
+	for (int ii = 0, iiend = chaos.getBinCount(); ii < iiend; ++ii) {
 		_encoders->y[ii].reset();
 		_encoders->u[ii].reset();
 		_encoders->v[ii].reset();
 	}
 
 	// Initialize costs
-	_costs.resize(_xsize * _ysize);
+	const u32 pixels = (u32)_xsize * _ysize;
+	_costs.resize(pixels);
 
-	// For each pixel of residuals,
-	u8 *residuals = _residuals.get();
+	const u8 *res_y = _cache.res[0].get();
+	const u8 *res_u = _cache.res[1].get();
+	const u8 *res_v = _cache.res[2].get();
+	const u8 *chaos_y = _cache.chaos[0].get();
+	const u8 *chaos_u = _cache.chaos[1].get();
+	const u8 *chaos_v = _cache.chaos[2].get();
+
+	// For each pixel,
 	u8 *costs = _costs.get();
+	u32 index = 0;
 	for (u16 y = 0; y < _ysize; ++y) {
-		for (u16 x = 0; x < _xsize; ++x, residuals += 4, ++costs) {
-			if (_mask->masked(x, y)) {
-				_encoders->chaos.zero(x);
+		for (u16 x = 0; x < _xsize; ++x, ++costs) {
+			if (_pixel_mask.masked(x, y)) {
 				costs[0] = 0;
 			} else {
-				// Get chaos bin
-				u8 cy, cu, cv;
-				_encoders->chaos.get(x, cy, cu, cv);
-
-				// Update chaos
-				_encoders->chaos.store(x, residuals);
-
-				int bits = _encoders->y[cy].price(residuals[0]);
-				bits += _encoders->u[cu].price(residuals[1]);
-				bits += _encoders->v[cv].price(residuals[2]);
+				int bits = _encoders->y[chaos.reduce(chaos_y[index])].price(res_y[index]);
+				bits += _encoders->u[chaos.reduce(chaos_u[index])].price(res_u[index]);
+				bits += _encoders->v[chaos.reduce(chaos_v[index])].price(res_v[index]);
 
 				CAT_DEBUG_ENFORCE(bits < 256);
 				costs[0] = static_cast<u8>( bits );
+				++index;
 			}
 		}
 	}
+
+	CAT_DEBUG_ENFORCE(index == _cache.count);
 }
 
 void ImageRGBAWriter::designLZ() {
+	CAT_TRACE_SPAN("RGBA designLZ");
+
 	CAT_INANE("RGBA") << "Finding LZ77 matches...";
 
 	LZMatchFinder::Parameters lz_params;
@@ -111,11 +118,32 @@ void ImageRGBAWriter::designLZ() {
 	_lz.init(rgba, lz_params);
 }
 
+void ImageRGBAWriter::maskPixels() {
+	_pixel_mask.init(_xsize, _ysize);
+
+	// For each pixel,
+	for (u16 y = 0; y < _ysize; ++y) {
+		for (u16 x = 0; x < _xsize; ++x) {
+			// If covered by the dominant color mask or an LZ match,
+			if (_mask->masked(x, y) || (_lz_enabled && _lz.masked(x, y))) {
+				_pixel_mask.set(x, y);
+			}
+		}
+	}
+}
+
 void ImageRGBAWriter::maskTiles() {
+	CAT_TRACE_SPAN("RGBA maskTiles");
+
 	const int tiles_size = _tiles_x * _tiles_y;
 	_sf_tiles.resizeZero(tiles_size);
 	_cf_tiles.resizeZero(tiles_size);
 
+	remaskTiles();
+}
+
+// Mask off tiles that are now covered entirely, keeping the other filters
+void ImageRGBAWriter::remaskTiles() {
 	const u16 tile_xsize = _tile_xsize, tile_ysize = _tile_ysize;
 	const u16 xsize = _xsize, ysize = _ysize;
 	u8 *cf = _cf_tiles.get();
@@ -131,8 +159,7 @@ void ImageRGBAWriter::maskTiles() {
 				while (cx-- > 0 && px < xsize) {
 					// If it is not masked,
 					if (!IsMasked(px, py)) {
-						// We need to do this tile
-						//*cf = TODO_TILE; (already 0)
+						// We need to do this tile, with its filter or TODO_TILE (0)
 						goto next_tile;
 					}
 					++px;
@@ -145,9 +172,14 @@ void ImageRGBAWriter::maskTiles() {
 next_tile:;
 		}
 	}
+
+	// Sample tile mask for SF/CF processing
+	_sf_mask.init(_tiles_x, _tiles_y, MaskBitmap::MaskDelegate::FromMember<ImageRGBAWriter, &ImageRGBAWriter::IsSFMasked>(this));
 }
 
 void ImageRGBAWriter::designFilters() {
+	CAT_TRACE_SPAN("RGBA designFilters");
+
 	const int SF_USED = _lz_enabled ? SF_COUNT : SF_BASIC_COUNT;
 
 	FilterScorer scores, awards;
@@ -216,6 +248,11 @@ void ImageRGBAWriter::designFilters() {
 		}
 
 		topleft_row += _xsize * 4 * _tile_ysize;
+
+		// If out of time, choose filters from the rows scored so far
+		if (total_score > 0 && EncodeBudget::expired()) {
+			break;
+		}
 	}
 
 	// Sort the best awards
@@ -256,6 +293,8 @@ void ImageRGBAWriter::designFilters() {
 }
 
 void ImageRGBAWriter::designTilesFast() {
+	CAT_TRACE_SPAN("RGBA designTilesFast");
+
 	CAT_INANE("RGBA") << "Designing SF/CF tiles (fast, low quality) for " << _tiles_x << "x" << _tiles_y << "...";
 	const u16 tile_xsize = _tile_xsize, tile_ysize = _tile_ysize;
 	const u16 xsize = _xsize, ysize = _ysize;
@@ -268,12 +307,16 @@ void ImageRGBAWriter::designTilesFast() {
 	int ty = 0;
 	u8 *sf = _sf_tiles.get();
 	u8 *cf = _cf_tiles.get();
+	int last_sf = 0, last_cf = 0;
 
 	// For each tile,
 	for (u16 y = 0; y < ysize; y += tile_ysize, ++ty) {
 		const u8 *topleft = topleft_row;
 		int tx = 0;
 
+		// If out of time, reuse the last choice for the remaining tiles
+		const bool hurry = EncodeBudget::expired();
+
 		for (u16 x = 0; x < xsize; x += tile_xsize, ++sf, ++cf, topleft += tile_xsize * 4, ++tx) {
 			u8 ocf = *cf;
 
@@ -282,6 +325,12 @@ void ImageRGBAWriter::designTilesFast() {
 				continue;
 			}
 
+			if (hurry) {
+				*sf = last_sf;
+				*cf = last_cf;
+				continue;
+			}
+
 			int code_count = 0;
 
 			scores.reset();
@@ -331,6 +380,8 @@ void ImageRGBAWriter::designTilesFast() {
 
 			*sf = best_sf;
 			*cf = best_cf;
+			last_sf = best_sf;
+			last_cf = best_cf;
 		}
 
 		topleft_row += _xsize * 4 * _tile_ysize;
@@ -338,6 +389,8 @@ void ImageRGBAWriter::designTilesFast() {
 }
 
 void ImageRGBAWriter::designTiles() {
+	CAT_TRACE_SPAN("RGBA designTiles");
+
 	CAT_INANE("RGBA") << "Designing SF/CF tiles for " << _tiles_x << "x" << _tiles_y << "...";
 
 	const u16 tile_xsize = _tile_xsize, tile_ysize = _tile_ysize;
@@ -387,8 +440,8 @@ void ImageRGBAWriter::designTiles() {
 
 				// If we are on the second or later pass,
 				if (passes > 0) {
-					// If just finished revisiting old zones,
-					if (--revisitCount < 0) {
+					// If just finished revisiting old zones or out of time,
+					if (--revisitCount < 0 || EncodeBudget::expired()) {
 						// Done!
 						return;
 					}
@@ -528,10 +581,11 @@ void ImageRGBAWriter::designTiles() {
 }
 
 void ImageRGBAWriter::sortFilters() {
+	CAT_TRACE_SPAN("RGBA sortFilters");
+
 	CAT_INANE("RGBA") << "Sorting spatial filters...";
 
-	_optimizer.process(_sf_tiles.get(), _tiles_x, _tiles_y, _sf_count,
-		PaletteOptimizer::MaskDelegate::FromMember<ImageRGBAWriter, &ImageRGBAWriter::IsSFMasked>(this));
+	_optimizer.process(_sf_tiles.get(), _tiles_x, _tiles_y, _sf_count, _sf_mask);
 
 	// Overwrite original tiles with optimized tiles
 	const u8 *src = _optimizer.getOptimizedImage();
@@ -551,6 +605,8 @@ void ImageRGBAWriter::sortFilters() {
 }
 
 bool ImageRGBAWriter::compressAlpha() {
+	CAT_TRACE_SPAN("RGBA compressAlpha");
+
 	CAT_INANE("RGBA") << "Compressing alpha channel...";
 
 	// Generate alpha matrix
@@ -579,6 +635,7 @@ bool ImageRGBAWriter::compressAlpha() {
 	params.filter_cover_thresh = _knobs->alpha_filterCoverThresh;
 	params.filter_inc_thresh = _knobs->alpha_filterIncThresh;
 	params.mask.SetMember<ImageRGBAWriter, &ImageRGBAWriter::IsMasked>(this);
+	params.mask_bitmap = &_pixel_mask;
 	params.AWARDS[0] = _knobs->alpha_awards[0];
 	params.AWARDS[1] = _knobs->alpha_awards[1];
 	params.AWARDS[2] = _knobs->alpha_awards[2];
@@ -593,6 +650,8 @@ bool ImageRGBAWriter::compressAlpha() {
 }
 
 void ImageRGBAWriter::computeResiduals() {
+	CAT_TRACE_SPAN("RGBA computeResiduals");
+
 	CAT_INANE("RGBA") << "Executing tiles to generate residual matrix...";
 
 	const u16 tile_xsize = _tile_xsize, tile_ysize = _tile_ysize;
@@ -656,7 +715,78 @@ void ImageRGBAWriter::computeResiduals() {
 	}
 }
 
+void ImageRGBAWriter::cacheResiduals() {
+	CAT_TRACE_SPAN("RGBA cacheResiduals");
+
+	CAT_INANE("RGBA") << "Caching residual planes...";
+
+	const u32 pixels = (u32)_xsize * _ysize;
+	for (int ii = 0; ii < 3; ++ii) {
+		_cache.res[ii].resize(pixels);
+		_cache.chaos[ii].resize(pixels);
+	}
+	_cache.lz_index.clear();
+	_cache.lz_chaos.clear();
+
+	u8 *res_y = _cache.res[0].get();
+	u8 *res_u = _cache.res[1].get();
+	u8 *res_v = _cache.res[2].get();
+	u8 *chaos_y = _cache.chaos[0].get();
+	u8 *chaos_u = _cache.chaos[1].get();
+	u8 *chaos_v = _cache.chaos[2].get();
+
+	// Bins at the most levels designChaos() will try
+	RGBChaos chaos;
+	chaos.init(MAX_CHAOS_LEVELS - 1, _xsize);
+	chaos.start();
+
+	// Reset LZ
+	u32 offset = 0, count = 0;
+	LZMatchFinder::LZMatch *lzm = _lz_enabled ? _lz.getHead() : 0;
+
+	// For each row,
+	const u8 *residuals = _residuals.get();
+	for (u16 y = 0; y < _ysize; ++y) {
+		// For each column,
+		for (u16 x = 0; x < _xsize; ++x, ++offset, residuals += 4) {
+			// If we just hit the start of the next LZ copy region,
+			if (lzm && offset == lzm->offset) {
+				u8 cy, cu, cv;
+				chaos.get(x, cy, cu, cv);
+
+				_cache.lz_index.push_back(count);
+				_cache.lz_chaos.push_back(cy);
+				lzm = lzm->next;
+			}
+
+			if (_pixel_mask.masked(x, y)) {
+				// Will eat LZ pixels too
+				chaos.zero(x);
+			} else {
+				// Get chaos bin
+				u8 cy, cu, cv;
+				chaos.get(x, cy, cu, cv);
+
+				// Update chaos
+				chaos.store(x, residuals);
+
+				res_y[count] = residuals[0];
+				res_u[count] = residuals[1];
+				res_v[count] = residuals[2];
+				chaos_y[count] = cy;
+				chaos_u[count] = cu;
+				chaos_v[count] = cv;
+				++count;
+			}
+		}
+	}
+
+	_cache.count = count;
+}
+
 void ImageRGBAWriter::designChaos() {
+	CAT_TRACE_SPAN("RGBA designChaos");
+
 	CAT_INANE("RGBA") << "Designing chaos...";
 
 	u32 best_entropy = 0x7fffffff;
@@ -664,10 +794,13 @@ void ImageRGBAWriter::designChaos() {
 	Encoders *best = 0;
 	Encoders *encoders = new Encoders;
 
+	const u32 count = _cache.count;
+	const u32 lz_count = (u32)_cache.lz_index.size();
+
 	// For each chaos level,
 	for (int chaos_levels = 1; chaos_levels < MAX_CHAOS_LEVELS; ++chaos_levels) {
-		encoders->chaos.init(chaos_levels, _xsize);
-		encoders->chaos.start();
+		RGBChaos &chaos = encoders->chaos;
+		chaos.init(chaos_levels, _xsize);
 
 		// For each chaos level,
 		for (int ii = 0; ii < chaos_levels; ++ii) {
@@ -676,44 +809,34 @@ void ImageRGBAWriter::designChaos() {
 			encoders->v[ii].init(ImageRGBAReader::NUM_V_SYMS, ImageRGBAReader::NUM_ZRLE_SYMS);
 		}
 
-		// Reset LZ
-		u32 offset = 0;
-		LZMatchFinder::LZMatch *lzm = _lz_enabled ? _lz.getHead() : 0;
-
-		// For each row,
-		const u8 *residuals = _residuals.get();
-		for (int y = 0; y < _ysize; ++y) {
-			// For each column,
-			for (int x = 0; x < _xsize; ++x, ++offset) {
-				// If we just hit the start of the next LZ copy region,
-				if (lzm && offset == lzm->offset) {
-					// Get chaos bin
-					u8 cy, cu, cv;
-					encoders->chaos.get(x, cy, cu, cv);
-
-					_lz.train(lzm, encoders->y[cy]);
-					lzm = lzm->next;
-				}
-
-				if (IsMasked(x, y)) {
-					// Will eat LZ pixels too
-					encoders->chaos.zero(x);
-				} else {
-					// Get chaos bin
-					u8 cy, cu, cv;
-					encoders->chaos.get(x, cy, cu, cv);
+		// Add Y plane to histograms, with LZ escapes where they occurred
+		const u8 *res = _cache.res[0].get();
+		const u8 *bins = _cache.chaos[0].get();
+		LZMatchFinder::LZMatch *lzm = lz_count > 0 ? _lz.getHead() : 0;
+		u32 index = 0;
+		for (u32 jj = 0; jj < lz_count; ++jj, lzm = lzm->next) {
+			for (const u32 lz_index = _cache.lz_index[jj]; index < lz_index; ++index) {
+				encoders->y[chaos.reduce(bins[index])].add(res[index]);
+			}
 
-					// Update chaos
-					encoders->chaos.store(x, residuals);
+			_lz.train(lzm, encoders->y[chaos.reduce(_cache.lz_chaos[jj])]);
+		}
+		for (; index < count; ++index) {
+			encoders->y[chaos.reduce(bins[index])].add(res[index]);
+		}
 
-					// Add to histogram for this chaos bin
-					encoders->y[cy].add(residuals[0]);
-					encoders->u[cu].add(residuals[1]);
-					encoders->v[cv].add(residuals[2]);
-				}
+		// Add U plane to histograms
+		res = _cache.res[1].get();
+		bins = _cache.chaos[1].get();
+		for (index = 0; index < count; ++index) {
+			encoders->u[chaos.reduce(bins[index])].add(res[index]);
+		}
 
-				residuals += 4;
-			}
+		// Add V plane to histograms
+		res = _cache.res[2].get();
+		bins = _cache.chaos[2].get();
+		for (index = 0; index < count; ++index) {
+			encoders->v[chaos.reduce(bins[index])].add(res[index]);
 		}
 
 		// For each chaos level,
@@ -736,8 +859,9 @@ void ImageRGBAWriter::designChaos() {
 			}
 		}
 
-		// If we have not found a better one in 2 moves,
-		if (chaos_levels - best->chaos.getBinCount() >= 2) {
+		// If we have not found a better one in 2 moves or are out of time,
+		if (chaos_levels - best->chaos.getBinCount() >= 2 ||
+			EncodeBudget::expired()) {
 			// Stop early to save time
 			break;
 		}
@@ -760,6 +884,8 @@ void ImageRGBAWriter::generateWriteOrder() {
 }
 
 bool ImageRGBAWriter::compressSF() {
+	CAT_TRACE_SPAN("RGBA compressSF");
+
 	MonoWriter::Parameters params;
 	params.knobs = _knobs;
 	params.data = _sf_tiles.get();
@@ -773,6 +899,7 @@ bool ImageRGBAWriter::compressSF() {
 	params.filter_cover_thresh = _knobs->sf_filterCoverThresh;
 	params.filter_inc_thresh = _knobs->sf_filterIncThresh;
 	params.mask.SetMember<ImageRGBAWriter, &ImageRGBAWriter::IsSFMasked>(this);
+	params.mask_bitmap = &_sf_mask;
 	params.AWARDS[0] = _knobs->sf_awards[0];
 	params.AWARDS[1] = _knobs->sf_awards[1];
 	params.AWARDS[2] = _knobs->sf_awards[2];
@@ -789,6 +916,8 @@ bool ImageRGBAWriter::compressSF() {
 }
 
 bool ImageRGBAWriter::compressCF() {
+	CAT_TRACE_SPAN("RGBA compressCF");
+
 	MonoWriter::Parameters params;
 	params.knobs = _knobs;
 	params.data = _cf_tiles.get();
@@ -802,6 +931,7 @@ bool ImageRGBAWriter::compressCF() {
 	params.filter_cover_thresh = _knobs->cf_filterCoverThresh;
 	params.filter_inc_thresh = _knobs->cf_filterIncThresh;
 	params.mask.SetMember<ImageRGBAWriter, &ImageRGBAWriter::IsSFMasked>(this);
+	params.mask_bitmap = &_sf_mask;
 	params.AWARDS[0] = _knobs->cf_awards[0];
 	params.AWARDS[1] = _knobs->cf_awards[1];
 	params.AWARDS[2] = _knobs->cf_awards[2];
@@ -820,7 +950,7 @@ bool ImageRGBAWriter::compressCF() {
 bool ImageRGBAWriter::IsMasked(u16 x, u16 y) {
 	CAT_DEBUG_ENFORCE(x < _xsize && y < _ysize);
 
-	return _mask->masked(x, y) || (_lz_enabled && _lz.masked(x, y));
+	return _pixel_mask.masked(x, y);
 }
 
 bool ImageRGBAWriter::IsSFMasked(u16 x, u16 y) {
@@ -829,10 +959,13 @@ bool ImageRGBAWriter::IsSFMasked(u16 x, u16 y) {
 	return _cf_tiles[x + _tiles_x * y] == MASK_TILE;
 }
 
-int ImageRGBAWriter::init(const u8 *rgba, int xsize, int ysize, ImageMaskWriter &mask, const GCIFKnobs *knobs) {
+int ImageRGBAWriter::init(const u8 *rgba, int xsize, int ysize, ImageMaskWriter &mask, const GCIFKnobs *knobs, bool opaque) {
+	CAT_TRACE_SPAN("RGBA init");
+
 	_knobs = knobs;
 	_rgba = rgba;
 	_mask = &mask;
+	_opaque = opaque;
 
 	if (xsize < 0 || ysize < 0) {
 		return GCIF_WE_BAD_DIMS;
@@ -852,13 +985,16 @@ int ImageRGBAWriter::init(const u8 *rgba, int xsize, int ysize, ImageMaskWriter
 	_lz_enabled = false;
 
 	// If LZ is enabled,
-	if (_knobs->rgba_enableLZ) {
+	const bool first_pass = _knobs->rgba_enableLZ;
+	if (first_pass) {
 		// Do a fast first pass at natural compression to better inform LZ decisions
+		maskPixels();
 		maskTiles();
 		designFilters();
 		designTilesFast();
 		sortFilters();
 		computeResiduals();
+		cacheResiduals();
 		designChaos();
 		priceResiduals();
 
@@ -868,21 +1004,37 @@ int ImageRGBAWriter::init(const u8 *rgba, int xsize, int ysize, ImageMaskWriter
 		_lz_enabled = true;
 	}
 
-	// If doing a full compression,
-	if (!_knobs->rgba_fastMode) {
+	// Mask off pixels covered by LZ matches
+	maskPixels();
+
+	// If doing a full compression, and it fits in the encode budget.  The
+	// post-LZ pass costs about as much as the first pass, so it is skipped
+	// once half the budget is gone, reusing the first pass design
+	if (!_knobs->rgba_fastMode && !(first_pass && EncodeBudget::spent(0.5f))) {
 		// Perform natural image compression post-LZ
 		maskTiles();
 		designFilters();
 		designTiles();
 		sortFilters();
 		computeResiduals();
+		cacheResiduals();
 
 		// Decide how many chaos levels to use
 		designChaos();
+	} else if (_lz_enabled && _lz.getHead()) {
+		// Drop tiles and pixels now covered by LZ.  The SF/CF coders must
+		// skip the tiles since the decoder never reads their filters
+		remaskTiles();
+		cacheResiduals();
+
+		// Retrain the entropy coders, since the first pass had no LZ escapes
+		designChaos();
 	}
 
-	// Compress alpha channel separately like a monochrome image
-	compressAlpha();
+	// If the image has an alpha channel, compress it separately like a monochrome image
+	if (!_opaque) {
+		compressAlpha();
+	}
 
 	// Generate a write order matrix used for compressing SF/CF information
 	generateWriteOrder();
@@ -929,9 +1081,12 @@ int ImageRGBAWriter::writeTables(ImageWriter &writer) {
 
 	DESYNC_TABLE();
 
-	int a_table_bits = _a_encoder.writeTables(writer);
+	int a_table_bits = 0;
+	if (!_opaque) {
+		a_table_bits = _a_encoder.writeTables(writer);
 
-	DESYNC_TABLE();
+		DESYNC_TABLE();
+	}
 
 #ifdef CAT_COLLECT_STATS
 	Stats.y_table_bits = 0;
@@ -973,27 +1128,42 @@ int ImageRGBAWriter::writeTables(ImageWriter &writer) {
 	return GCIF_WE_OK;
 }
 
-bool ImageRGBAWriter::writePixels(ImageWriter &writer) {
+bool ImageRGBAWriter::writePixels(ImageWriter *streams[]) {
 	CAT_INANE("RGBA") << "Writing interleaved pixel/filter data...";
 
+	// Y symbols, LZ matches and desynch checks go to the Y stream
+	ImageWriter &writer = *streams[ImageRGBAReader::STREAM_Y];
+	ImageWriter &u_writer = *streams[ImageRGBAReader::STREAM_U];
+	ImageWriter &v_writer = *streams[ImageRGBAReader::STREAM_V];
+	ImageWriter &a_writer = *streams[ImageRGBAReader::STREAM_A];
+	ImageWriter &sf_writer = *streams[ImageRGBAReader::STREAM_SF];
+	ImageWriter &cf_writer = *streams[ImageRGBAReader::STREAM_CF];
+
 #ifdef CAT_COLLECT_STATS
 	int sf_bits = 0, cf_bits = 0, y_bits = 0, u_bits = 0, v_bits = 0, a_bits = 0, rgba_count = 0, lz_count = 0, lz_bits = 0;
 #endif
 
 	_seen_filter.resize(_tiles_x);
 
-	_encoders->chaos.start();
-	for (int ii = 0, iiend = _encoders->chaos.getBinCount(); ii < iiend; ++ii) {
+	RGBChaos &chaos = _encoders->chaos;
+	for (int ii = 0, iiend = chaos.getBinCount(); ii < iiend; ++ii) {
 		_encoders->y[ii].reset();
 		_encoders->u[ii].reset();
 		_encoders->v[ii].reset();
 	}
 
-	const u8 *residuals = _residuals.get();
+	const u8 *res_y = _cache.res[0].get();
+	const u8 *res_u = _cache.res[1].get();
+	const u8 *res_v = _cache.res[2].get();
+	const u8 *chaos_y = _cache.chaos[0].get();
+	const u8 *chaos_u = _cache.chaos[1].get();
+	const u8 *chaos_v = _cache.chaos[2].get();
+	u32 index = 0;
+
 	const u16 tile_mask_y = _tile_ysize - 1;
 
 	// Reset LZ
-	u32 offset = 0;
+	u32 offset = 0, lz_index = 0;
 	LZMatchFinder::LZMatch *lzm = _lz_enabled ? _lz.getHead() : 0;
 
 	// For each scanline,
@@ -1021,14 +1191,16 @@ bool ImageRGBAWriter::writePixels(ImageWriter &writer) {
 #ifdef CAT_COLLECT_STATS
 			sf_bits +=
 #endif
-			_sf_encoder.writeRowHeader(ty, writer);
+			_sf_encoder.writeRowHeader(ty, sf_writer);
 #ifdef CAT_COLLECT_STATS
 			cf_bits +=
 #endif
-			_cf_encoder.writeRowHeader(ty, writer);
+			_cf_encoder.writeRowHeader(ty, cf_writer);
 		}
 
-		_a_encoder.writeRowHeader(y, writer);
+		if (!_opaque) {
+			_a_encoder.writeRowHeader(y, a_writer);
+		}
 
 		// For each pixel,
 		for (u16 x = 0, xsize = _xsize; x < xsize; ++x, ++offset) {
@@ -1037,10 +1209,10 @@ bool ImageRGBAWriter::writePixels(ImageWriter &writer) {
 				// Decoder respects mask first, so we cannot start LZ matches on a masked pixel,
 				// though we can skip over masked pixels after an LZ match starts.
 				CAT_DEBUG_ENFORCE(!_mask->masked(x, y));
+				CAT_DEBUG_ENFORCE(_cache.lz_index[lz_index] == index);
 
 				// Get chaos bin
-				u8 cy, cu, cv;
-				_encoders->chaos.get(x, cy, cu, cv);
+				const u8 cy = chaos.reduce(_cache.lz_chaos[lz_index++]);
 
 				DESYNC(x, y);
 #ifdef CAT_COLLECT_STATS
@@ -1052,9 +1224,10 @@ bool ImageRGBAWriter::writePixels(ImageWriter &writer) {
 			}
 
 			// If masked,
-			if (IsMasked(x, y)) {
-				_encoders->chaos.zero(x);
-				_a_encoder.zero(x);
+			if (_pixel_mask.masked(x, y)) {
+				if (!_opaque) {
+					_a_encoder.zero(x);
+				}
 
 				if (_lz_enabled && _lz.masked(x, y)) {
 #ifdef CAT_COLLECT_STATS
@@ -1065,31 +1238,32 @@ bool ImageRGBAWriter::writePixels(ImageWriter &writer) {
 				}
 			} else {
 				// Get chaos bin
-				u8 cy, cu, cv;
-				_encoders->chaos.get(x, cy, cu, cv);
-
-				// Update chaos
-				_encoders->chaos.store(x, residuals);
+				const u8 cy = chaos.reduce(chaos_y[index]);
+				const u8 cu = chaos.reduce(chaos_u[index]);
+				const u8 cv = chaos.reduce(chaos_v[index]);
 
 				// Write pixel
 				DESYNC(x, y);
 #ifdef CAT_COLLECT_STATS
 				y_bits +=
 #endif
-				_encoders->y[cy].write(residuals[0], writer);
+				_encoders->y[cy].write(res_y[index], writer);
 #ifdef CAT_COLLECT_STATS
 				u_bits +=
 #endif
-				_encoders->u[cu].write(residuals[1], writer);
+				_encoders->u[cu].write(res_u[index], u_writer);
 #ifdef CAT_COLLECT_STATS
 				v_bits +=
 #endif
-				_encoders->v[cv].write(residuals[2], writer);
+				_encoders->v[cv].write(res_v[index], v_writer);
+				++index;
 
+				if (!_opaque) {
 #ifdef CAT_COLLECT_STATS
-				a_bits +=
+					a_bits +=
 #endif
-				_a_encoder.write(x, y, writer);
+					_a_encoder.write(x, y, a_writer);
+				}
 
 				DESYNC(x, y);
 
@@ -1103,11 +1277,11 @@ bool ImageRGBAWriter::writePixels(ImageWriter &writer) {
 #ifdef CAT_COLLECT_STATS
 					cf_bits +=
 #endif
-					_cf_encoder.write(tx, ty, writer);
+					_cf_encoder.write(tx, ty, cf_writer);
 #ifdef CAT_COLLECT_STATS
 					sf_bits +=
 #endif
-					_sf_encoder.write(tx, ty, writer);
+					_sf_encoder.write(tx, ty, sf_writer);
 				}
 
 #ifdef CAT_COLLECT_STATS
@@ -1115,11 +1289,11 @@ bool ImageRGBAWriter::writePixels(ImageWriter &writer) {
 				++rgba_count;
 #endif
 			}
-
-			residuals += 4;
 		}
 	}
 
+	CAT_DEBUG_ENFORCE(index == _cache.count);
+
 #ifdef CAT_COLLECT_STATS
 	Stats.lz_bits = lz_bits;
 	Stats.lz_count = lz_count;
@@ -1136,13 +1310,52 @@ bool ImageRGBAWriter::writePixels(ImageWriter &writer) {
 }
 
 void ImageRGBAWriter::write(ImageWriter &writer) {
+	CAT_TRACE_SPAN("RGBA write");
+
 	writeTables(writer);
 
-	writePixels(writer);
+	ImageWriter *streams[ImageRGBAReader::STREAM_COUNT];
+	int stream_bits = 1;
+
+	// If the image is large enough to split pixel data into substreams,
+	if (_xsize * _ysize >= _knobs->rgba_streamThresh) {
+		CAT_INANE("RGBA") << "Splitting pixel data into substreams...";
+
+		writer.writeBit(1);
+
+		ImageWriter substreams[ImageRGBAReader::STREAM_COUNT];
+		for (int ii = 0; ii < ImageRGBAReader::STREAM_COUNT; ++ii) {
+			substreams[ii].initStream();
+			streams[ii] = &substreams[ii];
+		}
+
+		writePixels(streams);
+
+		// Write substream lengths
+		for (int ii = 0; ii < ImageRGBAReader::STREAM_COUNT; ++ii) {
+			substreams[ii].finalize();
+			stream_bits += writer.write9(substreams[ii].getWordCount());
+		}
+
+		// Append word-aligned substreams
+		for (int ii = 0; ii < ImageRGBAReader::STREAM_COUNT; ++ii) {
+			writer.writeStream(substreams[ii]);
+		}
+	} else {
+		writer.writeBit(0);
+
+		for (int ii = 0; ii < ImageRGBAReader::STREAM_COUNT; ++ii) {
+			streams[ii] = &writer;
+		}
+
+		writePixels(streams);
+	}
 
 #ifdef CAT_COLLECT_STATS
 	Stats.chaos_bins = _encoders->chaos.getBinCount();
 
+	Stats.basic_overhead_bits += stream_bits;
+
 	int rgba_total = 0;
 	rgba_total += Stats.basic_overhead_bits;
 	rgba_total += Stats.sf_choice_bits;
@@ -1172,8 +1385,10 @@ void ImageRGBAWriter::write(ImageWriter &writer) {
 #ifdef CAT_COLLECT_STATS
 
 bool ImageRGBAWriter::dumpStats() {
-	CAT_INANE("stats") << "(RGBA Compress) Alpha channel encoder:";
-	_a_encoder.dumpStats();
+	if (!_opaque) {
+		CAT_INANE("stats") << "(RGBA Compress) Alpha channel encoder:";
+		_a_encoder.dumpStats();
+	}
 	CAT_INANE("stats") << "(RGBA Compress) Spatial filter encoder:";
 	_sf_encoder.dumpStats();
 	CAT_INANE("stats") << "(RGBA Compress) Color filter encoder:";
@@ -38,6 +38,7 @@
 #include "GCIFWriter.h"
 #include "PaletteOptimizer.hpp"
 #include "LZMatchFinder.hpp"
+#include "MaskBitmap.hpp"
 
 #include <vector>
 
@@ -123,6 +124,32 @@ protected:
 	 */
 	SmartArray<u8> _residuals;
 
+	// Pixels covered by the dominant color mask or LZ, rebuilt when LZ changes
+	MaskBitmap _pixel_mask;
+
+	// Fully-masked SF/CF tiles
+	MaskBitmap _sf_mask;
+
+	/*
+	 * Residual cache
+	 *
+	 * Structure-of-arrays copy of the residuals for just the coded pixels in
+	 * raster order.  Next to each residual plane is its chaos bin computed at
+	 * the maximum number of chaos levels, which RGBChaos::reduce() converts
+	 * to any smaller level count.  LZ escapes are recorded by the index of
+	 * the coded pixel that follows them, along with their Y chaos bin.
+	 *
+	 * designChaos(), priceResiduals() and writePixels() stream over this
+	 * instead of re-running the chaos metric and mask over the whole image.
+	 */
+	struct ResidualCache {
+		u32 count;						// Number of coded pixels
+		SmartArray<u8> res[3];			// Y, U, V residuals
+		SmartArray<u8> chaos[3];		// Y, U, V chaos bins at max levels
+		std::vector<u32> lz_index;		// Coded pixel index after each LZ escape
+		std::vector<u8> lz_chaos;		// Y chaos bin of each LZ escape
+	} _cache;
+
 	/*
 	 * Seen Filter
 	 *
@@ -149,18 +176,22 @@ protected:
 	MonoWriter _sf_encoder, _cf_encoder;
 
 	// Alpha channel encoder
+	bool _opaque;			// RGB input: No alpha plane is written
 	SmartArray<u8> _alpha;
 	MonoWriter _a_encoder;
 
 	bool IsMasked(u16 x, u16 y);
 	bool IsSFMasked(u16 x, u16 y);
 
+	void maskPixels();
 	void maskTiles();
+	void remaskTiles();
 	void designFilters();
 	void designTilesFast();
 	void designTiles();
 	void sortFilters();
 	void computeResiduals();
+	void cacheResiduals();
 	void priceResiduals();
 	void designLZ();
 	bool compressAlpha();
@@ -170,7 +201,7 @@ protected:
 	bool compressCF();
 
 	int writeTables(ImageWriter &writer);
-	bool writePixels(ImageWriter &writer);
+	bool writePixels(ImageWriter *streams[]);
 
 #ifdef CAT_COLLECT_STATS
 public:
@@ -189,7 +220,8 @@ public:
 #endif // CAT_COLLECT_STATS
 
 public:
-	int init(const u8 *rgba, int xsize, int ysize, ImageMaskWriter &mask, const GCIFKnobs *knobs);
+	// Opaque images skip the alpha channel, and must be read as RGB
+	int init(const u8 *rgba, int xsize, int ysize, ImageMaskWriter &mask, const GCIFKnobs *knobs, bool opaque = false);
 
 	void write(ImageWriter &writer);
 
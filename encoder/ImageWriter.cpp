@@ -30,6 +30,7 @@
 #include "../decoder/EndianNeutral.hpp"
 #include "../decoder/MappedFile.hpp"
 #include "GCIFWriter.h"
+#include "../decoder/EntropyDictionary.hpp"
 using namespace cat;
 
 
@@ -109,19 +110,47 @@ void WriteVector::write(u32 *target) {
 	}
 }
 
+void WriteVector::append(WriteVector &src) {
+	u32 *ptr = src._head;
+	int words = HEAD_SIZE;
+	int remaining = src._size;
+
+	// For each rope,
+	while (remaining > 0) {
+		const int count = remaining < words ? remaining : words;
+
+		for (int ii = 0; ii < count; ++ii) {
+			push(getLE(ptr[ii]));
+		}
+		remaining -= count;
+
+		ptr = *reinterpret_cast<u32**>( ptr + words );
+		words <<= 1;
+	}
+}
+
 
 //// ImageWriter
 
-int ImageWriter::init(int xsize, int ysize) {
+int ImageWriter::init(int xsize, int ysize, EntropyDictionary *dict, int channels) {
 	// Validate
 	if (xsize < 0 || ysize < 0 ||
 		xsize > MAX_X || ysize > MAX_Y) {
 		return GCIF_WE_BAD_DIMS;
 	}
 
+	if (channels != 1 && channels != 3 && channels != 4) {
+		return GCIF_WE_BAD_PARAMS;
+	}
+
 	// Initialize
 	_header.xsize = static_cast<u16>( xsize );
 	_header.ysize = static_cast<u16>( ysize );
+	_header.dict_id = dict ? static_cast<u8>( dict->getID() ) : 0;
+	_header.channels = static_cast<u8>( channels );
+	_header.legacy = false;
+
+	_dict = dict;
 
 	_work = 0;
 	_bits = 0;
@@ -129,10 +158,21 @@ int ImageWriter::init(int xsize, int ysize) {
 	_words.init();
 
 	// Write header
-	writeWord(HEAD_MAGIC);
+	writeWord(CHANNELS_MAGIC);
 	writeBits(xsize, MAX_X_BITS);
 	writeBits(ysize, MAX_Y_BITS);
 
+	// Write shared table dictionary ID
+	if (dict) {
+		writeBit(1);
+		writeBits(_header.dict_id, ImageReader::DICT_ID_BITS);
+	} else {
+		writeBit(0);
+	}
+
+	// Write channel count
+	writeBits(channels - 1, ImageReader::CHANNELS_BITS);
+
 	return GCIF_WE_OK;
 }
 
@@ -156,6 +196,32 @@ void ImageWriter::writeBits(u32 code, int len) {
 	_bits = bits;
 }
 
+void ImageWriter::initStream() {
+	_header.xsize = 0;
+	_header.ysize = 0;
+	_header.dict_id = 0;
+	_header.channels = 4;
+	_header.legacy = false;
+
+	_dict = 0;
+
+	_work = 0;
+	_bits = 0;
+
+	_words.init();
+}
+
+void ImageWriter::writeStream(ImageWriter &stream) {
+	// Pad to a word boundary
+	if (_bits > 0) {
+		_words.push((u32)(_work >> 32));
+		_work = 0;
+		_bits = 0;
+	}
+
+	_words.append(stream._words);
+}
+
 u32 ImageWriter::finalize() {
 	// Finalize the bit data
 
@@ -36,6 +36,9 @@
 
 namespace cat {
 
+class EntropyDictionary;
+class DictionaryTrainer;
+
 
 //// WriteVector
 
@@ -99,6 +102,9 @@ public:
 	}
 
 	void write(u32 *target);
+
+	// Append all the words of another vector
+	void append(WriteVector &src);
 };
 
 
@@ -107,6 +113,7 @@ public:
 class ImageWriter {
 public:
 	static const u32 HEAD_MAGIC = ImageReader::HEAD_MAGIC;
+	static const u32 CHANNELS_MAGIC = ImageReader::CHANNELS_MAGIC;
 	static const u32 MAX_X_BITS = ImageReader::MAX_X_BITS;
 	static const u32 MAX_X = ImageReader::MAX_X;
 	static const u32 MAX_Y_BITS = ImageReader::MAX_Y_BITS;
@@ -119,14 +126,43 @@ protected:
 	u64 _work;
 	int _bits;
 
+	EntropyDictionary *_dict;
+	DictionaryTrainer *_trainer;
+
 public:
+	CAT_INLINE ImageWriter() {
+		_dict = 0;
+		_trainer = 0;
+	}
+
 	CAT_INLINE ImageReader::Header *getHeader() {
 		return &_header;
 	}
 
 	static const char *ErrorString(int err);
 
-	int init(int xsize, int ysize);
+	// Optionally write against a shared table dictionary, and with 1 or 3
+	// channels instead of RGBA
+	int init(int xsize, int ysize, EntropyDictionary *dict = 0, int channels = 4);
+
+	// Initialize as a headerless substream, appended later with writeStream()
+	void initStream();
+
+	// Pad to a word boundary and append a finalized substream
+	void writeStream(ImageWriter &stream);
+
+	// Shared table dictionary, or 0 for none
+	CAT_INLINE EntropyDictionary *getDictionary() {
+		return _dict;
+	}
+
+	// Collect table statistics while writing for dictionary training
+	CAT_INLINE void setTrainer(DictionaryTrainer *trainer) {
+		_trainer = trainer;
+	}
+	CAT_INLINE DictionaryTrainer *getTrainer() {
+		return _trainer;
+	}
 
 	// Only works with len in [1..32], and code must not have dirty high bits
 	void writeBits(u32 code, int len);
@@ -331,6 +367,21 @@ public:
 
 	// Write finalized data to file
 	int write(const char *path);
+
+	// Number of finalized words
+	CAT_INLINE int getWordCount() {
+		return _words.getWordCount();
+	}
+
+	// Number of bits written so far
+	CAT_INLINE u64 getBitCount() {
+		return (u64)_words.getWordCount() * 32 + _bits;
+	}
+
+	// Copy finalized data to memory, getWordCount() words long
+	CAT_INLINE void write(u32 *target) {
+		_words.write(target);
+	}
 };
 
 
@@ -29,6 +29,7 @@
 #include "LZMatchFinder.hpp"
 #include "../decoder/BitMath.hpp"
 #include "Log.hpp"
+#include "EncodeBudget.hpp"
 using namespace cat;
 
 #include <iostream>
@@ -493,6 +494,10 @@ bool RGBAMatchFinder::findMatches(SuffixArray3_State * CAT_RESTRICT sa3state, co
 	// Track number of pixels covered by previous matches as we walk
 	int covered_pixels = 0;
 
+	// Hash chain walk limits, shortened if the encode budget runs out
+	int prematch_limit = _params.prematch_chain_limit;
+	int inmatch_limit = _params.inmatch_chain_limit;
+
 	// For each pixel, stopping just before the last pixel:
 	const int xsize = _params.xsize;
 	const u32 * CAT_RESTRICT rgba_now = rgba;
@@ -505,6 +510,14 @@ bool RGBAMatchFinder::findMatches(SuffixArray3_State * CAT_RESTRICT sa3state, co
 		// Wrap x
 		if (x >= xsize) {
 			x = 0;
+
+			// If out of time, only walk the start of each hash chain
+			if (prematch_limit > BUDGET_CHAIN_LIMIT && EncodeBudget::expired()) {
+				prematch_limit = BUDGET_CHAIN_LIMIT;
+				if (inmatch_limit > BUDGET_CHAIN_LIMIT) {
+					inmatch_limit = BUDGET_CHAIN_LIMIT;
+				}
+			}
 		}
 
 		// Calculate length limit	
@@ -533,7 +546,7 @@ bool RGBAMatchFinder::findMatches(SuffixArray3_State * CAT_RESTRICT sa3state, co
 				// NOTE: Since SA3 is not reliable we cannot use it to save time here
 
 				// For each hash chain suggested start point,
-				int limit = covered_pixels > 0 ? _params.inmatch_chain_limit : _params.prematch_chain_limit;
+				int limit = covered_pixels > 0 ? inmatch_limit : prematch_limit;
 				do {
 					--node;
 
@@ -640,11 +653,14 @@ bool RGBAMatchFinder::findMatches(SuffixArray3_State * CAT_RESTRICT sa3state, co
 bool RGBAMatchFinder::init(const u32 * CAT_RESTRICT rgba, Parameters &params) {
 	LZMatchFinder::init(params);
 
-	SuffixArray3_State sa3state;
-	SuffixArray3_Init(&sa3state, (u8*)rgba, _pixels*4, (WIN_SIZE > _pixels ? _pixels : WIN_SIZE)*4);
+	// If out of time, skip the search and write tables with no matches
+	if (!EncodeBudget::expired()) {
+		SuffixArray3_State sa3state;
+		SuffixArray3_Init(&sa3state, (u8*)rgba, _pixels*4, (WIN_SIZE > _pixels ? _pixels : WIN_SIZE)*4);
 
-	if (!findMatches(&sa3state, rgba)) {
-		return false;
+		if (!findMatches(&sa3state, rgba)) {
+			return false;
+		}
 	}
 
 #ifdef CAT_DEBUG
@@ -681,6 +697,10 @@ bool MonoMatchFinder::findMatches(SuffixArray3_State * CAT_RESTRICT sa3state, co
 	// Track number of pixels covered by previous matches as we walk
 	int covered_pixels = 0;
 
+	// Hash chain walk limits, shortened if the encode budget runs out
+	int prematch_limit = _params.prematch_chain_limit;
+	int inmatch_limit = _params.inmatch_chain_limit;
+
 	// For each pixel, stopping just before the last pixel:
 	const int xsize = _params.xsize;
 	const u8 * CAT_RESTRICT mono_now = mono;
@@ -693,6 +713,14 @@ bool MonoMatchFinder::findMatches(SuffixArray3_State * CAT_RESTRICT sa3state, co
 		// Wrap x
 		if (x >= xsize) {
 			x = 0;
+
+			// If out of time, only walk the start of each hash chain
+			if (prematch_limit > BUDGET_CHAIN_LIMIT && EncodeBudget::expired()) {
+				prematch_limit = BUDGET_CHAIN_LIMIT;
+				if (inmatch_limit > BUDGET_CHAIN_LIMIT) {
+					inmatch_limit = BUDGET_CHAIN_LIMIT;
+				}
+			}
 		}
 
 		// Calculate length limit	
@@ -719,7 +747,7 @@ bool MonoMatchFinder::findMatches(SuffixArray3_State * CAT_RESTRICT sa3state, co
 				if (longest_ml_n >= MIN_MATCH ||
 					longest_ml_p >= MIN_MATCH) {
 					// For each hash chain suggested start point,
-					int limit = covered_pixels > 0 ? _params.inmatch_chain_limit : _params.prematch_chain_limit;
+					int limit = covered_pixels > 0 ? inmatch_limit : prematch_limit;
 					do {
 						--node;
 
@@ -830,11 +858,14 @@ bool MonoMatchFinder::findMatches(SuffixArray3_State * CAT_RESTRICT sa3state, co
 bool MonoMatchFinder::init(const u8 * CAT_RESTRICT mono, Parameters &params) {
 	LZMatchFinder::init(params);
 
-	SuffixArray3_State sa3state;
-	SuffixArray3_Init(&sa3state, (u8*)mono, _pixels, (WIN_SIZE > _pixels ? _pixels : WIN_SIZE));
+	// If out of time, skip the search and write tables with no matches
+	if (!EncodeBudget::expired()) {
+		SuffixArray3_State sa3state;
+		SuffixArray3_Init(&sa3state, (u8*)mono, _pixels, (WIN_SIZE > _pixels ? _pixels : WIN_SIZE));
 
-	if (!findMatches(&sa3state, mono)) {
-		return false;
+		if (!findMatches(&sa3state, mono)) {
+			return false;
+		}
 	}
 
 #ifdef CAT_DEBUG
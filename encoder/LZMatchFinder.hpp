@@ -60,6 +60,9 @@ public:
 	static const int WIN_SIZE = LZReader::WIN_SIZE;
 	static const int LAST_COUNT = LZReader::LAST_COUNT;
 
+	// Hash chain walk limit once the encode budget is spent
+	static const int BUDGET_CHAIN_LIMIT = 16;
+
 	struct Parameters {
 		int num_syms;		// First escape symbol / number of symbols
 		int xsize, ysize;	// Image dimensions
@@ -31,7 +31,7 @@
 
 #include "../decoder/Delegates.hpp"
 #include "Singleton.hpp"
-#include "Mutex.hpp"
+#include "../decoder/Mutex.hpp"
 #include <string>
 #include <sstream>
 
@@ -0,0 +1,59 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "MaskBitmap.hpp"
+using namespace cat;
+
+
+//// MaskBitmap
+
+void MaskBitmap::init(u16 xsize, u16 ysize) {
+	_xsize = xsize;
+	_ysize = ysize;
+	_stride = (xsize + 31) >> 5;
+
+	_bits.resizeZero(_stride * ysize);
+	_words = _bits.get();
+}
+
+void MaskBitmap::init(u16 xsize, u16 ysize, MaskDelegate mask) {
+	init(xsize, ysize);
+
+	u32 *words = _words;
+
+	// For each row,
+	for (u16 y = 0; y < ysize; ++y, words += _stride) {
+		// For each element,
+		for (u16 x = 0; x < xsize; ++x) {
+			// If masked,
+			if (mask(x, y)) {
+				words[x >> 5] |= (u32)1 << (x & 31);
+			}
+		}
+	}
+}
@@ -0,0 +1,98 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MASK_BITMAP_HPP
+#define MASK_BITMAP_HPP
+
+#include "../decoder/Platform.hpp"
+#include "../decoder/SmartArray.hpp"
+#include "../decoder/Delegates.hpp"
+#include "../decoder/Enforcer.hpp"
+
+/*
+ * Mask Bitmap
+ *
+ * Row-major bitset with one bit per element, set where the element is masked
+ * out of the data to encode.  The encoder inner loops test it with a plain
+ * load instead of calling through a mask delegate for every element, often
+ * several times per element across design passes.
+ *
+ * Rows are padded to whole 32-bit words so that a row can be scanned for
+ * unmasked elements a word at a time.
+ */
+
+namespace cat {
+
+
+//// MaskBitmap
+
+class MaskBitmap {
+	SmartArray<u32> _bits;
+	u32 *_words;			// = _bits.get()
+	u32 _stride;			// Words per row
+	u16 _xsize, _ysize;
+
+public:
+	// bool IsMasked(u16 x, u16 y)
+	typedef Delegate2<bool, u16, u16> MaskDelegate;
+
+	CAT_INLINE MaskBitmap() {
+		_words = 0;
+		_stride = 0;
+		_xsize = 0;
+		_ysize = 0;
+	}
+
+	// Allocate with no elements masked
+	void init(u16 xsize, u16 ysize);
+
+	// Allocate and sample the mask function once for each element
+	void init(u16 xsize, u16 ysize, MaskDelegate mask);
+
+	CAT_INLINE void set(u16 x, u16 y) {
+		CAT_DEBUG_ENFORCE(x < _xsize && y < _ysize);
+
+		_words[(x >> 5) + y * _stride] |= (u32)1 << (x & 31);
+	}
+
+	CAT_INLINE bool masked(u16 x, u16 y) const {
+		CAT_DEBUG_ENFORCE(x < _xsize && y < _ysize);
+
+		return ((_words[(x >> 5) + y * _stride] >> (x & 31)) & 1) != 0;
+	}
+
+	// Bits for a row: bit (x & 31) of word (x >> 5) is element x
+	CAT_INLINE const u32 *row(u16 y) const {
+		return _words + y * _stride;
+	}
+};
+
+
+} // namespace cat
+
+#endif // MASK_BITMAP_HPP
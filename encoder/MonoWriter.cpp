@@ -31,6 +31,8 @@
 #include "FilterScorer.hpp"
 #include "EntropyEstimator.hpp"
 #include "../decoder/BitMath.hpp"
+#include "Tracer.hpp"
+#include "EncodeBudget.hpp"
 using namespace cat;
 
 
@@ -116,11 +118,11 @@ void MonoWriter::priceResiduals() {
 			const u8 f = _profile->getTile(tx, ty);
 
 			// If using sympal,
-			if (_profile->filter_indices[f] >= SF_COUNT || _params.mask(x, y)) {
+			if (_profile->filter_indices[f] >= SF_COUNT || _mask->masked(x, y)) {
 				prices[0] = 0;
 
 				// If in LZ mode,
-				if (_lz_enable && !_params.mask(x, y)) {
+				if (_lz_enable && !_mask->masked(x, y)) {
 					// If PF was not seen,
 					if (_tile_seen[tx] == 0) {
 						_tile_seen[tx] = 1;
@@ -149,6 +151,8 @@ void MonoWriter::priceResiduals() {
 }
 
 void MonoWriter::designLZ() {
+	CAT_TRACE_SPAN("Mono designLZ");
+
 	CAT_INANE("Mono") << "Finding LZ77 matches for " << _params.xsize << "x" << _params.ysize << "...";
 
 	LZMatchFinder::Parameters lz_params;
@@ -164,6 +168,8 @@ void MonoWriter::designLZ() {
 }
 
 void MonoWriter::designRowFilters() {
+	CAT_TRACE_SPAN("Mono designRowFilters");
+
 	//CAT_INANE("Mono") << "Designing row filters for " << _params.xsize << "x" << _params.ysize << "...";
 
 	const int xsize = _params.xsize, ysize = _params.ysize;
@@ -225,7 +231,7 @@ void MonoWriter::designRowFilters() {
 
 					u8 p = data[0];
 
-					if (!_params.mask(x, y)) {
+					if (!_mask->masked(x, y)) {
 						// RF_NOOP
 						codes[code_count] = p;
 
@@ -336,7 +342,7 @@ void MonoWriter::designRowFilters() {
 						}
 					}
 
-					if (!_params.mask(x, y)) {
+					if (!_mask->masked(x, y)) {
 						u8 p = data[0];
 
 						// If filtered,
@@ -363,6 +369,8 @@ void MonoWriter::designRowFilters() {
 }
 
 void MonoWriter::maskTiles() {
+	CAT_TRACE_SPAN("Mono maskTiles");
+
 	const u16 tile_xsize = _profile->tile_xsize, tile_ysize = _profile->tile_ysize;
 	const u16 xsize = _params.xsize, ysize = _params.ysize;
 	u8 *m = _profile->mask.get();
@@ -377,7 +385,7 @@ void MonoWriter::maskTiles() {
 				u16 px = x, cx = tile_xsize;
 				while (cx-- > 0 && px < xsize) {
 					// If it is not masked,
-					if (!_params.mask(px, py)) {
+					if (!_mask->masked(px, py)) {
 						if (!_lz_enable || !_lz.masked(px, py)) {
 							// We need to do this tile
 							*m = 0;
@@ -397,6 +405,8 @@ next_tile:;
 }
 
 void MonoWriter::designPaletteFilters() {
+	CAT_TRACE_SPAN("Mono designPaletteFilters");
+
 	const u16 tile_xsize = _profile->tile_xsize, tile_ysize = _profile->tile_ysize;
 	const u16 xsize = _params.xsize, ysize = _params.ysize;
 	const u16 tile_bits_x = _profile->tile_bits_x, tile_bits_y = _profile->tile_bits_y;
@@ -426,7 +436,7 @@ void MonoWriter::designPaletteFilters() {
 				u16 px = x, cx = tile_xsize;
 				while (cx-- > 0 && px < xsize) {
 					// If element is not masked,
-					if (!_params.mask(px, py)) {
+					if (!_mask->masked(px, py)) {
 						// If LZ not on this pixel,
 						if (!_lz_enable || !_lz.masked(px, py)) {
 							const u8 value = *data;
@@ -494,6 +504,8 @@ void MonoWriter::designPaletteFilters() {
 }
 
 void MonoWriter::designFilters() {
+	CAT_TRACE_SPAN("Mono designFilters");
+
 	const u16 tile_xsize = _profile->tile_xsize, tile_ysize = _profile->tile_ysize;
 	const u16 xsize = _params.xsize, ysize = _params.ysize;
 	const u16 tile_bits_x = _profile->tile_bits_x, tile_bits_y = _profile->tile_bits_y;
@@ -532,7 +544,7 @@ void MonoWriter::designFilters() {
 				u16 px = x, cx = tile_xsize;
 				while (cx-- > 0 && px < xsize) {
 					// If element is not masked,
-					if (!_params.mask(px, py)) {
+					if (!_mask->masked(px, py)) {
 						if (!_lz_enable || !_lz.masked(px, py)) {
 							const u8 value = *data;
 
@@ -595,6 +607,11 @@ void MonoWriter::designFilters() {
 		}
 
 		topleft_row += _params.xsize * tile_ysize;
+
+		// If out of time, choose filters from the rows scored so far
+		if (total_score > 0 && EncodeBudget::expired()) {
+			break;
+		}
 	}
 
 	// Decide how many filters to sort by score
@@ -682,6 +699,8 @@ void MonoWriter::designFilters() {
 }
 
 void MonoWriter::designPaletteTiles() {
+	CAT_TRACE_SPAN("Mono designPaletteTiles");
+
 	if (_profile->sympal_filter_count < 0) {
 #ifdef CAT_DUMP_FILTERS
 		CAT_INANE("Mono") << "No palette filters selected";
@@ -731,6 +750,8 @@ void MonoWriter::designPaletteTiles() {
 }
 
 void MonoWriter::designTiles() {
+	CAT_TRACE_SPAN("Mono designTiles");
+
 	//CAT_INANE("Mono") << "Designing tiles for " << _profile->tiles_x << "x" << _profile->tiles_y << "...";
 
 	const u16 tile_xsize = _profile->tile_xsize, tile_ysize = _profile->tile_ysize;
@@ -772,8 +793,8 @@ void MonoWriter::designTiles() {
 
 				// If we are on the second or later pass,
 				if (passes > 0) {
-					// If just finished revisiting old zones,
-					if (--revisitCount < 0) {
+					// If just finished revisiting old zones or out of time,
+					if (--revisitCount < 0 || EncodeBudget::expired()) {
 						// Done!
 						return;
 					}
@@ -790,7 +811,7 @@ void MonoWriter::designTiles() {
 							u16 px = x, cx = tile_xsize;
 							while (cx-- > 0 && px < xsize) {
 								// If element is not masked,
-								if (!_params.mask(px, py)) {
+								if (!_mask->masked(px, py)) {
 									if (!_lz_enable || !_lz.masked(px, py)) {
 										const u8 value = *data;
 
@@ -824,7 +845,7 @@ void MonoWriter::designTiles() {
 					u16 px = x, cx = tile_xsize;
 					while (cx-- > 0 && px < xsize) {
 						// If element is not masked,
-						if (!_params.mask(px, py)) {
+						if (!_mask->masked(px, py)) {
 							if (!_lz_enable || !_lz.masked(px, py)) {
 								const u8 value = *data;
 
@@ -931,6 +952,8 @@ void MonoWriter::designTiles() {
 }
 
 void MonoWriter::computeResiduals() {
+	CAT_TRACE_SPAN("Mono computeResiduals");
+
 	//CAT_INANE("Mono") << "Executing tiles to generate residual matrix...";
 
 	const u16 xsize = _params.xsize, ysize = _params.ysize;
@@ -999,7 +1022,7 @@ void MonoWriter::computeResiduals() {
 				}
 
 				// If element is not masked,
-				if (!_params.mask(x, y)) {
+				if (!_mask->masked(x, y)) {
 					// Grab filter for this tile
 					u16 residual, tx = x >> tile_bits_x;
 					u8 f = _profile->getTile(tx, ty);
@@ -1029,6 +1052,8 @@ void MonoWriter::computeResiduals() {
 }
 
 void MonoWriter::optimizeTiles() {
+	CAT_TRACE_SPAN("Mono optimizeTiles");
+
 	//CAT_INANE("Mono") << "Optimizing tiles for " << _profile->tiles_x << "x" << _profile->tiles_y << "...";
 
 	_optimizer.process(_profile->tiles.get(), _profile->tiles_x, _profile->tiles_y, _profile->filter_count,
@@ -1116,7 +1141,7 @@ void MonoWriter::generateWriteOrder() {
 			// For each x,
 			u16 x;
 			while ((x = *order++) != ORDER_SENTINEL) {
-				CAT_DEBUG_ENFORCE(!_params.mask(x, y));
+				CAT_DEBUG_ENFORCE(!_mask->masked(x, y));
 
 				// If tile seen for the first time,
 				u16 tx = x >> tile_bits_x;
@@ -1135,7 +1160,7 @@ void MonoWriter::generateWriteOrder() {
 				}
 
 				// If pixel is not masked out,
-				if (!_params.mask(x, y)) {
+				if (!_mask->masked(x, y)) {
 					// If tile seen for the first time,
 					u16 tx = x >> tile_bits_x;
 					if (_tile_seen[tx] == 0) {
@@ -1156,6 +1181,8 @@ bool MonoWriter::IsMasked(u16 x, u16 y) {
 }
 
 void MonoWriter::recurseCompress() {
+	CAT_TRACE_SPAN("Mono recurseCompress");
+
 	const u16 tiles_x = _profile->tiles_x, tiles_y = _profile->tiles_y;
 
 	//CAT_INANE("Mono") << "Recursively compressing tiles for " << tiles_x << "x" << tiles_y << "...";
@@ -1168,189 +1195,173 @@ void MonoWriter::recurseCompress() {
 	params.xsize = tiles_x;
 	params.ysize = tiles_y;
 	params.mask.SetMember<MonoWriter, &MonoWriter::IsMasked>(this);
+	params.mask_bitmap = 0;
 	params.write_order = &_profile->write_order[0];
 	params.lz_enable = false;
 
 	_profile->filter_encoder->init(params);
 }
 
-void MonoWriter::designChaos() {
+u32 MonoWriter::traceChaos() {
 	// Initialize tile seen array
 	_tile_seen.resize(_profile->tiles_x);
 
-	//CAT_INANE("Mono") << "Designing chaos...";
+	// At most one symbol is added per pixel
+	const u32 pixels = (u32)_params.xsize * _params.ysize;
+	_chaos_bins.resize(pixels);
+	_chaos_syms.resize(pixels);
+	u8 *bins = _chaos_bins.get();
+	u16 *syms = _chaos_syms.get();
+	u32 count = 0;
 
-	u32 best_entropy = 0x7fffffff;
-
-	MonoWriterProfile::Encoders *best = 0;
-	MonoWriterProfile::Encoders *encoders = new MonoWriterProfile::Encoders;
+	// Bins at the most levels designChaos() will try
+	MonoChaos chaos;
+	chaos.init(MAX_CHAOS_LEVELS - 1, _params.xsize);
+	chaos.start();
 
 	const u16 tile_mask_y = _profile->tile_ysize - 1;
+	const u16 *order = _params.write_order;
+	const u8 *residuals = _profile->residuals.get();
 
-	// For each chaos level,
-	for (int chaos_levels = 1; chaos_levels < MAX_CHAOS_LEVELS; ++chaos_levels) {
-		encoders->chaos.init(chaos_levels, _params.xsize);
-		encoders->chaos.start();
+	LZMatchFinder::LZMatch *lzm = _lz.getHead();
+	int offset = 0;
 
-		const u16 *order = _params.write_order;
-		const u8 *residuals = _profile->residuals.get();
+	// For each row,
+	for (u16 y = 0; y < _params.ysize; ++y) {
+		const u16 ty = y >> _profile->tile_bits_y;
 
-		// For each chaos level,
-		for (int ii = 0; ii < chaos_levels; ++ii) {
-			encoders->encoder[ii].init(_params.num_syms + (_lz_enable ? LZReader::ESCAPE_SYMS : 0), ZRLE_SYMS);
+		// Reset tile seen
+		if ((y & tile_mask_y) == 0) {
+			_tile_seen.fill_00();
 		}
 
-		LZMatchFinder::LZMatch *lzm = _lz.getHead();
-		int offset = 0;
+		// If random write order,
+		if (order) {
+			// After the first one,
+			if (y > 0) {
+				// Simulate zeroing the chaos residuals
+				for (u16 x = 0; x < _params.xsize; ++x) {
+					if (_mask->masked(x, y - 1)) {
+						chaos.zero(x);
+					}
+				}
+			}
 
-		// For each row,
-		for (u16 y = 0; y < _params.ysize; ++y) {
-			const u16 ty = y >> _profile->tile_bits_y;
+			u16 x;
+			while ((x = *order++) != ORDER_SENTINEL) {
+				CAT_DEBUG_ENFORCE(!_mask->masked(x, y));
+
+				const u16 tx = x >> _profile->tile_bits_x;
+				CAT_DEBUG_ENFORCE(tx < _profile->tiles_x);
+
+				const u8 f = _profile->getTile(tx, ty);
+				CAT_DEBUG_ENFORCE(f < _profile->filter_count);
+
+				// If masked or sympal,
+				if (_profile->filter_indices[f] >= SF_COUNT) {
+					chaos.zero(x);
+				} else {
+					// Get residual symbol
+					u8 residual = residuals[x];
 
-			// Reset tile seen
-			if ((y & tile_mask_y) == 0) {
-				_tile_seen.fill_00();
+					// Calculate and update local chaos
+					bins[count] = chaos.next(x, residual, _params.num_syms);
+					syms[count++] = residual;
+				}
 			}
 
-			// If random write order,
-			if (order) {
-				// After the first one,
-				if (y > 0) {
-					// Simulate zeroing the chaos residuals
-					for (u16 x = 0; x < _params.xsize; ++x) {
-						if (_params.mask(x, y - 1)) {
-							encoders->chaos.zero(x);
-							if (x == 56 && (y - 1) == 40) {
-								CAT_WARN("TESTA:MASK") << " levels " << chaos_levels << encoders;
-							}
-							if (y == 40) {
-								CAT_WARN("TEST") << "ZERO MASK TILE " << x << ", " << (y - 1);
-							}
-						}
+			residuals += _params.xsize;
+		} else {
+			// For each column,
+			for (u16 x = 0; x < _params.xsize; ++x, ++residuals, ++offset) {
+				// If using LZ,
+				if (_lz_enable) {
+					// If LZ match is here,
+					if (lzm && offset == lzm->offset) {
+						// Same symbol LZMatchFinder::train() adds
+						bins[count] = chaos.get(x);
+						syms[count++] = lzm->escape_code;
+						lzm = lzm->next;
 					}
-				}
 
-				u16 x;
-				while ((x = *order++) != ORDER_SENTINEL) {
-					CAT_DEBUG_ENFORCE(!_params.mask(x, y));
+					// If pixel is LZ masked,
+					if (_lz.masked(x, y)) {
+						chaos.zero(x);
+						continue;
+					}
+				}
 
-					const u16 tx = x >> _profile->tile_bits_x;
-					CAT_DEBUG_ENFORCE(tx < _profile->tiles_x);
+				const u16 tx = x >> _profile->tile_bits_x;
+				CAT_DEBUG_ENFORCE(tx < _profile->tiles_x);
 
+				if (_mask->masked(x, y)) {
+					chaos.zero(x);
+				} else {
 					const u8 f = _profile->getTile(tx, ty);
 					CAT_DEBUG_ENFORCE(f < _profile->filter_count);
 
-					// If masked or sympal,
+					// If sympal,
 					if (_profile->filter_indices[f] >= SF_COUNT) {
-						encoders->chaos.zero(x);
-
-						if (x == 56 && y == 40 && tx == 7) {
-							CAT_WARN("TESTA:ORDER") << (int)f << " PF filter " << tx << " tx " << chaos_levels << " levels " << encoders;
-						}
-						if (y == 40 && tx >= 6 && ty <= 7) {
-							CAT_WARN("PF") << x;
-							if (x == 55) {
-								CAT_WARN("WUT") << (int)f;
-
-								CAT_WARN("WAT") << _profile->normal_filter_count;
-								CAT_WARN("WAT") << _profile->filter_count;
+						// If in LZ mode,
+						if (_lz_enable) {
+							// If PF was not seen,
+							if (_tile_seen[tx] == 0) {
+								_tile_seen[tx] = 1;
+
+								// Will be writing a zero here
+								bins[count] = chaos.get(x);
+								syms[count++] = 0;
 							}
 						}
+
+						chaos.zero(x);
 					} else {
 						// Get residual symbol
-						u8 residual = residuals[x];
-
-						if (x == 56 && y == 40 && tx == 7) {
-							CAT_WARN("TEST") << (int)encoders->chaos._pixels[x - 1];
-							CAT_WARN("TEST") << (int)encoders->chaos._pixels[x];
-						}
+						u8 residual = residuals[0];
 
 						// Calculate and update local chaos
-						int chaos = encoders->chaos.next(x, residual, _params.num_syms);
-
-						if (x == 56 && y == 40 && tx == 7) {
-							CAT_WARN("TESTA:ORDER") << (int)residual << " residual " << (int)f << " filter " << chaos << " chaos " << tx << " tx " << chaos_levels << " levels " << encoders;
-						}
-
-						if (y == 40 && tx >= 6 && tx <= 7) {
-							CAT_WARN("ORDER") << x;
-						}
-
-						// Add to histogram for this chaos bin
-						encoders->encoder[chaos].add(residual);
+						bins[count] = chaos.next(x, residual, _params.num_syms);
+						syms[count++] = residual;
 					}
 				}
+			}
+		}
+	}
 
-				residuals += _params.xsize;
-			} else {
-				// For each column,
-				for (u16 x = 0; x < _params.xsize; ++x, ++residuals, ++offset) {
-					// If using LZ,
-					if (_lz_enable) {
-						// If LZ match is here,
-						if (lzm && offset == lzm->offset) {
-							int chaos = encoders->chaos.get(x);
-							_lz.train(lzm, encoders->encoder[chaos]);
-							lzm = lzm->next;
-						}
+	CAT_DEBUG_ENFORCE(count <= pixels);
 
-						// If pixel is LZ masked,
-						if (_lz.masked(x, y)) {
-							encoders->chaos.zero(x);
-							continue;
-						}
-					}
+	return count;
+}
 
-					const u16 tx = x >> _profile->tile_bits_x;
-					CAT_DEBUG_ENFORCE(tx < _profile->tiles_x);
+void MonoWriter::designChaos() {
+	CAT_TRACE_SPAN("Mono designChaos");
 
-					if (_params.mask(x, y)) {
-						encoders->chaos.zero(x);
+	//CAT_INANE("Mono") << "Designing chaos...";
 
-						if (x == 56 && y == 40 && tx == 7) {
-							CAT_WARN("TESTB:MASK") << tx << " tx " << chaos_levels << " levels " << encoders;
-						}
-					} else {
-						const u8 f = _profile->getTile(tx, ty);
-						CAT_DEBUG_ENFORCE(f < _profile->filter_count);
+	// Chaos inputs do not depend on the number of levels, so record them once
+	const u32 count = traceChaos();
+	const u8 *bins = _chaos_bins.get();
+	const u16 *syms = _chaos_syms.get();
 
-						if (x == 56 && y == 40 && tx == 7) {
-							CAT_WARN("TESTB:RES") << (int)f << " filter " << tx << " tx " << chaos_levels << " levels " << encoders;
-						}
+	u32 best_entropy = 0x7fffffff;
 
-						// If sympal,
-						if (_profile->filter_indices[f] >= SF_COUNT) {
-							if (x == 56 && y == 40 && tx == 7) {
-								CAT_WARN("TESTB:RES") << "PF " << (int)f << " filter " << tx << " tx " << chaos_levels << " levels " << encoders;
-							}
-							// If in LZ mode,
-							if (_lz_enable) {
-								// If PF was not seen,
-								if (_tile_seen[tx] == 0) {
-									_tile_seen[tx] = 1;
-
-									// Will be writing a zero here
-									int chaos = encoders->chaos.get(x);
-									encoders->encoder[chaos].add(0);
-								}
-							}
+	MonoWriterProfile::Encoders *best = 0;
+	MonoWriterProfile::Encoders *encoders = new MonoWriterProfile::Encoders;
 
-							encoders->chaos.zero(x);
-						} else {
-							// Get residual symbol
-							u8 residual = residuals[0];
+	// For each chaos level,
+	for (int chaos_levels = 1; chaos_levels < MAX_CHAOS_LEVELS; ++chaos_levels) {
+		MonoChaos &chaos = encoders->chaos;
+		chaos.init(chaos_levels, _params.xsize);
+		chaos.start();
 
-							// Calculate and update local chaos
-							int chaos = encoders->chaos.next(x, residual, _params.num_syms);
+		// For each chaos level,
+		for (int ii = 0; ii < chaos_levels; ++ii) {
+			encoders->encoder[ii].init(_params.num_syms + (_lz_enable ? LZReader::ESCAPE_SYMS : 0), ZRLE_SYMS);
+		}
 
-							if (x == 56 && y == 40 && tx == 7) {
-								CAT_WARN("TESTB:RES") << "residual " << (int)residual << " and chaos " << chaos << " tx=" << tx << " levels " << chaos_levels << " " << encoders;
-							}
-							encoders->encoder[chaos].add(residual);
-						}
-					}
-				}
-			}
+		// Add symbols to histogram for their chaos bin
+		for (u32 ii = 0; ii < count; ++ii) {
+			encoders->encoder[chaos.reduce(bins[ii])].add(syms[ii]);
 		}
 
 		// For each chaos level,
@@ -1374,8 +1385,9 @@ void MonoWriter::designChaos() {
 			}
 		}
 
-		// If we have not found a better one in 4 moves,
-		if (chaos_levels - best->chaos.getBinCount() >= 2) {
+		// If we have not found a better one in 4 moves or are out of time,
+		if (chaos_levels - best->chaos.getBinCount() >= 2 ||
+			EncodeBudget::expired()) {
 			// Stop early to save time
 			break;
 		}
@@ -1424,14 +1436,24 @@ u32 MonoWriter::simulate() {
 }
 
 void MonoWriter::init(const Parameters &params) {
+	CAT_TRACE_SPAN("Mono init");
+
 	cleanup();
 
 	// Initialize
 	_params = params;
 	_lz_enable = false;
 
-	// Only allow LZ to be enabled when write order is not specified
-	CAT_DEBUG_ENFORCE(!params.lz_enable || !params.write_order);
+	// If a mask bitmap was provided,
+	if (params.mask_bitmap) {
+		_mask = params.mask_bitmap;
+	} else {
+		// Sample the mask function once rather than in every pass
+		_mask_bitmap.init(params.xsize, params.ysize, params.mask);
+		_mask = &_mask_bitmap;
+	}
+
+	// LZ is only used when write order is not specified (see below)
 
 	_row_filters.resize(_params.ysize);
 
@@ -1450,8 +1472,8 @@ void MonoWriter::init(const Parameters &params) {
 	u32 best_entropy = 0x7fffffff;
 	const u32 pixel_count = _params.xsize * _params.ysize;
 
-	// If LZ77 is enabled,
-	if (params.lz_enable && pixel_count >= LZ_THRESH) {
+	// If LZ77 is enabled and the data is written in natural order,
+	if (params.lz_enable && !params.write_order && pixel_count >= LZ_THRESH) {
 		// Do a fast trial of filtering without LZ masking to measure the cost per bit
 		_profile = new MonoWriterProfile;
 		_profile->init(params.xsize, params.ysize, params.min_bits);
@@ -1523,6 +1545,11 @@ void MonoWriter::init(const Parameters &params) {
 				delete _profile;
 				break;
 			}
+
+			// If out of time, keep the best tile size so far
+			if (EncodeBudget::expired()) {
+				break;
+			}
 		}
 		_profile = best_profile;
 	}
@@ -1764,7 +1791,7 @@ int MonoWriter::write(u16 x, u16 y, ImageWriter &writer) {
 	int overhead_bits = 0, data_bits = 0;
 
 	CAT_DEBUG_ENFORCE(x < _params.xsize && y < _params.ysize);
-	CAT_DEBUG_ENFORCE(!_params.mask(x, y));
+	CAT_DEBUG_ENFORCE(!_mask->masked(x, y));
 	CAT_DEBUG_ENFORCE(!_next_write_pixel_order || *_next_write_pixel_order++ == x);
 
 	const int offset = x + _params.xsize * y;
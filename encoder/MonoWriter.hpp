@@ -39,6 +39,7 @@
 #include "../decoder/SmartArray.hpp"
 #include "PaletteOptimizer.hpp"
 #include "LZMatchFinder.hpp"
+#include "MaskBitmap.hpp"
 
 #include <vector>
 
@@ -120,6 +121,7 @@ public:
 		u16 xsize, ysize;				// Data dimensions
 		u16 min_bits, max_bits;			// Tile size bit range to try
 		MaskDelegate mask;				// Function to call to determine if an element is masked out
+		const MaskBitmap *mask_bitmap;	// Precomputed mask, or 0 to sample mask() once up front
 		u16 num_syms;					// Number of symbols in data [0..num_syms-1]
 		bool lz_enable;					// Enable LZ encoder
 
@@ -161,6 +163,10 @@ protected:
 
 	MonoWriterProfile *_profile;			// Selected write profile
 
+	// Mask
+	const MaskBitmap *_mask;				// Elements masked out of the data
+	MaskBitmap _mask_bitmap;				// Sampled from params.mask if none provided
+
 	// Workspace
 	bool _lz_enable;						// Enable LZ during processing
 	int _tile_bits_field_bc;				// Bits for tile bits field
@@ -173,6 +179,8 @@ protected:
 	SmartArray<u8> _ecodes;					// Used when evaluating options
 	SmartArray<u8> _tile_seen;				// Tile seen yet during a tile row
 	SmartArray<u8> _replay;					// Used during computing residuals
+	SmartArray<u8> _chaos_bins;				// Chaos bin at max levels per symbol added
+	SmartArray<u16> _chaos_syms;			// Symbols in the order they are added
 
 	// Row filter mode
 	SmartArray<u8> _row_filters;			// Selected row filters
@@ -223,6 +231,9 @@ protected:
 	// Compress the tile data if possible
 	void recurseCompress();
 
+	// Record chaos bins and symbols in coding order (returns symbol count)
+	u32 traceChaos();
+
 	// Determine number of chaos levels to use when encoding the data
 	void designChaos();
 
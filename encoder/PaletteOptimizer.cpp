@@ -31,14 +31,14 @@
 using namespace cat;
 
 
-void PaletteOptimizer::histogramImage(MaskDelegate &mask) {
+void PaletteOptimizer::histogramImage(const MaskBitmap &mask) {
 	CAT_OBJCLR(_hist);
 
 	// Histogram
 	const u8 *image = _image;
 	for (int y = 0, yend = _ysize; y < yend; ++y) {
 		for (int x = 0, xend = _xsize; x < xend; ++x, ++image) {
-			if (!mask(x, y)) {
+			if (!mask.masked(x, y)) {
 				_hist[*image]++;
 			}
 		}
@@ -78,7 +78,7 @@ void PaletteOptimizer::histogramImage(MaskDelegate &mask) {
 #endif
 }
 
-void PaletteOptimizer::sortPalette(MaskDelegate &mask) {
+void PaletteOptimizer::sortPalette(const MaskBitmap &mask) {
 	CAT_OBJCLR(_forward);
 
 	// Index 0 is the most common color
@@ -121,46 +121,46 @@ void PaletteOptimizer::sortPalette(MaskDelegate &mask) {
 					 * d b c
 					 */
 					if (x > 0) {
-						if (!mask(x - 1, y)) {
+						if (!mask.masked(x - 1, y)) {
 							scores[image[-1]] += p*2; // A
 						}
 
 						if (y < ysize-1) {
-							if (!mask(x - 1, y + 1)) {
+							if (!mask.masked(x - 1, y + 1)) {
 								scores[image[xsize - 1]] += p; // d
 							}
 						}
 
 						if (y > 0) {
-							if (!mask(x - 1, y - 1)) {
+							if (!mask.masked(x - 1, y - 1)) {
 								scores[image[-xsize - 1]] += p; // C
 							}
 						}
 					}
 					if (x < xsize-1) {
-						if (!mask(x + 1, y)) {
+						if (!mask.masked(x + 1, y)) {
 							scores[image[1]] += p*2; // a
 						}
 
 						if (y < ysize-1) {
-							if (!mask(x + 1, y + 1)) {
+							if (!mask.masked(x + 1, y + 1)) {
 								scores[image[xsize + 1]] += p; // c
 							}
 						}
 					}
 					if (y > 0) {
-						if (!mask(x, y - 1)) {
+						if (!mask.masked(x, y - 1)) {
 							scores[image[-xsize]] += p; // B
 						}
 
 						if (x < xsize-1) {
-							if (!mask(x + 1, y - 1)) {
+							if (!mask.masked(x + 1, y - 1)) {
 								scores[image[-xsize + 1]] += p; // D
 							}
 						}
 					}
 					if (y < ysize-1) {
-						if (!mask(x, y + 1)) {
+						if (!mask.masked(x, y + 1)) {
 							scores[image[xsize]] += p; // b
 						}
 					}
@@ -212,7 +212,7 @@ void PaletteOptimizer::sortPalette(MaskDelegate &mask) {
 #endif
 }
 
-void PaletteOptimizer::process(const u8 *image, int xsize, int ysize, int palette_size, MaskDelegate mask) {
+void PaletteOptimizer::process(const u8 *image, int xsize, int ysize, int palette_size, const MaskBitmap &mask) {
 	_image = image;
 	_xsize = xsize;
 	_ysize = ysize;
@@ -222,3 +222,9 @@ void PaletteOptimizer::process(const u8 *image, int xsize, int ysize, int palett
 	sortPalette(mask);
 }
 
+void PaletteOptimizer::process(const u8 *image, int xsize, int ysize, int palette_size, MaskDelegate mask) {
+	_mask_bitmap.init(xsize, ysize, mask);
+
+	process(image, xsize, ysize, palette_size, _mask_bitmap);
+}
+
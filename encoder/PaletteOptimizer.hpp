@@ -32,6 +32,7 @@
 #include "../decoder/Platform.hpp"
 #include "../decoder/SmartArray.hpp"
 #include "../decoder/Delegates.hpp"
+#include "MaskBitmap.hpp"
 
 /*
  * Image Compression: Palette Sorting
@@ -96,11 +97,17 @@ protected:
 	SmartArray<u8> _result;
 	u8 _forward[PALETTE_MAX];	// Map old index -> new index
 
-	void histogramImage(MaskDelegate &mask);
-	void sortPalette(MaskDelegate &mask);
+	// Sampled from mask function for the compatibility interface
+	MaskBitmap _mask_bitmap;
+
+	void histogramImage(const MaskBitmap &mask);
+	void sortPalette(const MaskBitmap &mask);
 
 public:
 	// Assumes image data is entirely in 0..palette_size-1 range
+	void process(const u8 *_image, int xsize, int ysize, int palette_size, const MaskBitmap &mask);
+
+	// Version that samples a mask function into a bitmap first
 	void process(const u8 *_image, int xsize, int ysize, int palette_size, MaskDelegate mask);
 
 	CAT_INLINE const u8 *getOptimizedImage() {
@@ -30,6 +30,7 @@
 #include "../decoder/EndianNeutral.hpp"
 #include "Log.hpp"
 #include "../decoder/Enforcer.hpp"
+#include "Tracer.hpp"
 using namespace cat;
 using namespace std;
 
@@ -224,6 +225,8 @@ void SmallPaletteWriter::generatePacked() {
 }
 
 int SmallPaletteWriter::init(const u8 *rgba, int xsize, int ysize, const GCIFKnobs *knobs) {
+	CAT_TRACE_SPAN("SmallPalette init");
+
 	_knobs = knobs;
 	_rgba = rgba;
 	_xsize = xsize;
@@ -310,8 +313,7 @@ void SmallPaletteWriter::convertPacked() {
 void SmallPaletteWriter::optimizeImage() {
 	CAT_INANE("Palette") << "Optimizing palette...";
 
-	_optimizer.process(_image.get(), _pack_x, _pack_y, _pack_palette_size,
-		PaletteOptimizer::MaskDelegate::FromMember<SmallPaletteWriter, &SmallPaletteWriter::IsMasked>(this));
+	_optimizer.process(_image.get(), _pack_x, _pack_y, _pack_palette_size, _mask_bitmap);
 
 	// Replace palette image
 	const u8 *src = _optimizer.getOptimizedImage();
@@ -343,6 +345,7 @@ void SmallPaletteWriter::generateMonoWriter() {
 	params.filter_cover_thresh = _knobs->spal_filterCoverThresh;
 	params.filter_inc_thresh = _knobs->spal_filterIncThresh;
 	params.mask.SetMember<SmallPaletteWriter, &SmallPaletteWriter::IsMasked>(this);
+	params.mask_bitmap = &_mask_bitmap;
 	params.AWARDS[0] = _knobs->spal_awards[0];
 	params.AWARDS[1] = _knobs->spal_awards[1];
 	params.AWARDS[2] = _knobs->spal_awards[2];
@@ -355,10 +358,15 @@ void SmallPaletteWriter::generateMonoWriter() {
 }
 
 int SmallPaletteWriter::compress(ImageMaskWriter &mask) {
+	CAT_TRACE_SPAN("SmallPalette compress");
+
 	_mask = &mask;
 
 	CAT_DEBUG_ENFORCE(enabled());
 
+	// Sample dominant color mask for the inner loops
+	_mask_bitmap.init(_pack_x, _pack_y, MaskBitmap::MaskDelegate::FromMember<SmallPaletteWriter, &SmallPaletteWriter::IsMasked>(this));
+
 	convertPacked();
 	optimizeImage();
 	generateMonoWriter();
@@ -409,7 +417,7 @@ void SmallPaletteWriter::writePixels(ImageWriter &writer) {
 		bits += _mono_writer.writeRowHeader(y, writer);
 
 		for (int x = 0, xend = _pack_x; x < xend; ++x, ++image) {
-			if (IsMasked(x, y)) {
+			if (_mask_bitmap.masked(x, y)) {
 				_mono_writer.zero(x);
 			} else {
 				bits += _mono_writer.write(x, y, writer);
@@ -440,7 +448,10 @@ bool SmallPaletteWriter::dumpStats() {
 	if (!enabled()) {
 		CAT_INANE("stats") << "(Small Palette) Disabled.";
 	} else {
-		_mono_writer.dumpStats();
+		// If the pixels were written,
+		if (!isSingleColor()) {
+			_mono_writer.dumpStats();
+		}
 
 		CAT_INANE("stats") << "(Small Palette)              Size : " << Stats.palette_size << " colors";
 		CAT_INANE("stats") << "(Small Palette)     Small Palette : " << Stats.small_palette_bits / 8 << " bytes (" << Stats.small_palette_bits * 100.f / Stats.total_bits << "% total)";
@@ -36,6 +36,7 @@
 #include "ImageMaskWriter.hpp"
 #include "PaletteOptimizer.hpp"
 #include "MonoWriter.hpp"
+#include "MaskBitmap.hpp"
 #include "../decoder/SmallPaletteReader.hpp"
 
 #include <vector>
@@ -76,6 +77,7 @@ class SmallPaletteWriter {
 	SmartArray<u8> _image;	// Repacked image
 
 	ImageMaskWriter *_mask;
+	MaskBitmap _mask_bitmap;	// Dominant color mask sampled once
 	PaletteOptimizer _optimizer;
 
 	int _palette_size;		// Number of palette entries (> 0 : enabled)
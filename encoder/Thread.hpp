@@ -31,7 +31,7 @@
 
 #include "../decoder/Delegates.hpp"
 #include "Singleton.hpp"
-#include "Mutex.hpp"
+#include "../decoder/Mutex.hpp"
 
 #if !defined(CAT_OS_WINDOWS)
 # include <pthread.h>
@@ -0,0 +1,314 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ThreadPool.hpp"
+#include "SystemInfo.hpp"
+using namespace cat;
+
+
+// Worker running on the calling thread, or 0 for other threads
+static CAT_TLS PoolWorker *m_current = 0;
+
+// How long wait() sleeps before looking for tasks to help with again
+static const int WAIT_POLL_MSEC = 10;
+
+
+//// TaskGroup
+
+bool TaskGroup::done() {
+	AutoMutex lock(_lock);
+
+	return _pending <= 0;
+}
+
+void TaskGroup::finish() {
+	AutoMutex lock(_lock);
+
+	if (--_pending <= 0) {
+		_done.Set();
+	}
+}
+
+
+//// PoolWorker
+
+void PoolWorker::push(const Task &task) {
+	AutoMutex lock(_lock);
+
+	// Insert after tasks of the same or higher priority
+	std::deque<Task>::iterator ii = _tasks.end();
+	while (ii != _tasks.begin() && (ii - 1)->priority < task.priority) {
+		--ii;
+	}
+
+	_tasks.insert(ii, task);
+}
+
+bool PoolWorker::pop(Task &task) {
+	AutoMutex lock(_lock);
+
+	if (_tasks.empty()) {
+		return false;
+	}
+
+	task = _tasks.front();
+	_tasks.pop_front();
+	return true;
+}
+
+bool PoolWorker::peek(u64 &priority) {
+	AutoMutex lock(_lock);
+
+	if (_tasks.empty()) {
+		return false;
+	}
+
+	priority = _tasks.front().priority;
+	return true;
+}
+
+bool PoolWorker::Entrypoint(void *param) {
+	m_current = this;
+
+	for (;;) {
+		if (_pool->runOne(this)) {
+			continue;
+		}
+
+		if (_pool->_shutdown) {
+			break;
+		}
+
+		// Register as sleeping before the last look for work, so a task
+		// submitted after that look will wake this worker
+		{
+			AutoMutex lock(_pool->_sleep_lock);
+
+			_pool->_sleeping.push_back(_id);
+		}
+
+		const bool found = _pool->runOne(this);
+
+		if (!found && !_pool->_shutdown) {
+			_wake.Wait();
+		}
+
+		// If not woken through the list, remove this worker from it
+		AutoMutex lock(_pool->_sleep_lock);
+
+		for (int ii = 0; ii < (int)_pool->_sleeping.size(); ++ii) {
+			if (_pool->_sleeping[ii] == _id) {
+				_pool->_sleeping.erase(_pool->_sleeping.begin() + ii);
+				break;
+			}
+		}
+	}
+
+	m_current = 0;
+
+	return true;
+}
+
+
+//// ThreadPool
+
+ThreadPool::ThreadPool() {
+	_workers = 0;
+	_worker_count = 0;
+	_shutdown = false;
+	_next_worker = 0;
+}
+
+ThreadPool::~ThreadPool() {
+	shutdown();
+}
+
+bool ThreadPool::init(int worker_count) {
+	shutdown();
+
+	if (worker_count <= 0) {
+		worker_count = SystemInfo::ref()->GetProcessorCount();
+
+		if (worker_count < 1) {
+			worker_count = 1;
+		}
+	}
+
+	_shutdown = false;
+	_next_worker = 0;
+	_workers = new PoolWorker[worker_count];
+	_worker_count = worker_count;
+
+	for (int ii = 0; ii < worker_count; ++ii) {
+		_workers[ii]._pool = this;
+		_workers[ii]._id = ii;
+	}
+
+	for (int ii = 0; ii < worker_count; ++ii) {
+		if (!_workers[ii].StartThread()) {
+			shutdown();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void ThreadPool::shutdown() {
+	if (!_workers) {
+		return;
+	}
+
+	// Workers finish queued tasks before they see this
+	_shutdown = true;
+
+	for (int ii = 0; ii < _worker_count; ++ii) {
+		_workers[ii]._wake.Set();
+	}
+
+	for (int ii = 0; ii < _worker_count; ++ii) {
+		_workers[ii].WaitForThread();
+	}
+
+	delete []_workers;
+	_workers = 0;
+	_worker_count = 0;
+	_sleeping.clear();
+}
+
+ThreadPool *ThreadPool::current() {
+	return m_current ? m_current->_pool : 0;
+}
+
+bool ThreadPool::runOne(PoolWorker *self) {
+	PoolWorker::Task task;
+	bool found = self && self->pop(task);
+
+	// If own deque is empty,
+	if (!found) {
+		// Steal the highest priority task at the front of another deque
+		int best = -1;
+		u64 best_priority = 0;
+
+		for (int ii = 0; ii < _worker_count; ++ii) {
+			u64 priority;
+
+			if (&_workers[ii] != self && _workers[ii].peek(priority)) {
+				if (best < 0 || priority > best_priority) {
+					best = ii;
+					best_priority = priority;
+				}
+			}
+		}
+
+		if (best >= 0) {
+			found = _workers[best].pop(task);
+		}
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	task.func(task.param, task.index);
+	task.group->finish();
+
+	return true;
+}
+
+void ThreadPool::wakeOne() {
+	AutoMutex lock(_sleep_lock);
+
+	if (!_sleeping.empty()) {
+		const int id = _sleeping.back();
+		_sleeping.pop_back();
+
+		_workers[id]._wake.Set();
+	}
+}
+
+void ThreadPool::submit(TaskGroup &group, PoolTaskFunc func, void *param, int index, u64 priority) {
+	// If there are no workers, run it now
+	if (_worker_count <= 0) {
+		func(param, index);
+		return;
+	}
+
+	{
+		AutoMutex lock(group._lock);
+
+		group._pending++;
+	}
+
+	PoolWorker::Task task;
+	task.func = func;
+	task.param = param;
+	task.index = index;
+	task.priority = priority;
+	task.group = &group;
+
+	// Keep nested tasks on the submitting worker, otherwise spread them out
+	PoolWorker *target = m_current;
+	if (!target || target->_pool != this) {
+		AutoMutex lock(_sleep_lock);
+
+		target = &_workers[_next_worker];
+		if (++_next_worker >= _worker_count) {
+			_next_worker = 0;
+		}
+	}
+
+	target->push(task);
+
+	wakeOne();
+}
+
+void ThreadPool::wait(TaskGroup &group) {
+	PoolWorker *self = m_current;
+	if (self && self->_pool != this) {
+		self = 0;
+	}
+
+	while (!group.done()) {
+		// If there is nothing to help with, sleep until the group finishes
+		if (!runOne(self)) {
+			group._done.Wait(WAIT_POLL_MSEC);
+		}
+	}
+}
+
+void ThreadPool::parallelFor(int count, PoolTaskFunc func, void *param) {
+	TaskGroup group;
+
+	// Earlier indices first
+	for (int ii = 0; ii < count; ++ii) {
+		submit(group, func, param, ii, (u64)(count - ii));
+	}
+
+	wait(group);
+}
@@ -0,0 +1,166 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include "Thread.hpp"
+#include "WaitableFlag.hpp"
+#include "../decoder/Mutex.hpp"
+#include <deque>
+#include <vector>
+
+/*
+ * Work-Stealing Thread Pool
+ *
+ * Each worker owns a deque of tasks kept in priority order.  A worker runs
+ * the highest-priority task from its own deque, and when that is empty it
+ * steals the highest-priority task at the front of another worker's deque.
+ * Submitting file-sized priorities so the largest files start first keeps one
+ * big image from finishing long after the rest of a batch.
+ *
+ * Tasks are added to a TaskGroup, and wait() runs queued tasks on the calling
+ * thread until the group is done.  A task can submit and wait on its own group,
+ * so parallel-for nests without tying up a worker.  Tasks submitted from a
+ * worker go on that worker's deque, and idle workers steal them from there.
+ *
+ * Idle workers sleep on their own flag, and each submitted task wakes at most
+ * one of them.
+ */
+
+namespace cat {
+
+
+class ThreadPool;
+
+// Runs one task: param and index are as passed to submit()
+typedef void (*PoolTaskFunc)(void *param, int index);
+
+
+//// TaskGroup
+
+class TaskGroup {
+	friend class ThreadPool;
+
+	Mutex _lock;
+	int _pending;
+	WaitableFlag _done;
+
+	void finish();
+
+public:
+	CAT_INLINE TaskGroup() {
+		_pending = 0;
+	}
+
+	bool done();
+};
+
+
+//// PoolWorker
+
+class PoolWorker : public Thread {
+	friend class ThreadPool;
+
+	struct Task {
+		PoolTaskFunc func;
+		void *param;
+		int index;
+		u64 priority;
+		TaskGroup *group;
+	};
+
+	ThreadPool *_pool;
+	int _id;
+
+	// Tasks in priority order, highest first
+	Mutex _lock;
+	std::deque<Task> _tasks;
+
+	WaitableFlag _wake;
+
+	void push(const Task &task);
+	bool pop(Task &task);
+	bool peek(u64 &priority);
+
+protected:
+	virtual bool Entrypoint(void *param);
+};
+
+
+//// ThreadPool
+
+class ThreadPool {
+	friend class PoolWorker;
+
+	PoolWorker *_workers;
+	int _worker_count;
+	volatile bool _shutdown;
+
+	// Round-robin target for tasks submitted from outside the pool
+	int _next_worker;
+
+	// Workers waiting for a task
+	Mutex _sleep_lock;
+	std::vector<int> _sleeping;
+
+	// Run a task from the given worker's deque or steal one
+	bool runOne(PoolWorker *self);
+	void wakeOne();
+
+public:
+	ThreadPool();
+	~ThreadPool();
+
+	// Start worker_count workers, or one per processor if 0
+	bool init(int worker_count = 0);
+
+	// Finish queued tasks and stop the workers
+	void shutdown();
+
+	CAT_INLINE int getWorkerCount() {
+		return _worker_count;
+	}
+
+	// Pool of the calling worker thread, or 0 if not called from a worker
+	static ThreadPool *current();
+
+	// Queue func(param, index) in the group, higher priority tasks first
+	void submit(TaskGroup &group, PoolTaskFunc func, void *param, int index, u64 priority = 0);
+
+	// Run queued tasks on this thread until the group is done
+	void wait(TaskGroup &group);
+
+	// Run func(param, ii) for ii in [0, count) and wait for all of them
+	void parallelFor(int count, PoolTaskFunc func, void *param);
+};
+
+
+} // namespace cat
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,134 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Tracer.hpp"
+#include "../decoder/Mutex.hpp"
+#include "../decoder/StageTimer.hpp"
+#include <stdio.h>
+using namespace cat;
+
+
+//// Tracer
+
+bool Tracer::_enabled = false;
+
+// Registered thread buffers, newest first
+static Tracer::ThreadBuffer *m_buffers = 0;
+static int m_thread_count = 0;
+static Mutex m_register_lock;
+
+// Timestamps are written relative to enable()
+static u64 m_epoch = 0;
+
+static CAT_TLS Tracer::ThreadBuffer *m_thread_buffer = 0;
+
+void Tracer::enable() {
+	m_epoch = StageTimer::nsec();
+	_enabled = true;
+}
+
+Tracer::ThreadBuffer *Tracer::getBuffer() {
+	ThreadBuffer *buffer = m_thread_buffer;
+
+	// If this thread has not traced before,
+	if CAT_UNLIKELY(!buffer) {
+		buffer = new ThreadBuffer;
+		buffer->depth = 0;
+
+		AutoMutex lock(m_register_lock);
+
+		buffer->tid = m_thread_count++;
+		buffer->next = m_buffers;
+		m_buffers = buffer;
+
+		m_thread_buffer = buffer;
+	}
+
+	return buffer;
+}
+
+bool Tracer::write(const char *path) {
+	FILE *file = fopen(path, "wb");
+	if (!file) {
+		return false;
+	}
+
+	AutoMutex lock(m_register_lock);
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+	const char *separator = "\n";
+
+	// For each thread,
+	for (ThreadBuffer *buffer = m_buffers; buffer; buffer = buffer->next) {
+		const int count = (int)buffer->spans.size();
+
+		// For each complete span,
+		for (int ii = 0; ii < count; ++ii) {
+			const Span &span = buffer->spans[ii];
+
+			// If the span was still open, skip it
+			if (span.end < span.begin) {
+				continue;
+			}
+
+			fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%d}}",
+					separator, span.name, buffer->tid,
+					(span.begin - m_epoch) / 1000., (span.end - span.begin) / 1000., span.depth);
+
+			separator = ",\n";
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+
+	return fclose(file) == 0;
+}
+
+
+//// TraceSpan
+
+void TraceSpan::begin(const char *name) {
+	Tracer::ThreadBuffer *buffer = Tracer::getBuffer();
+
+	Tracer::Span span;
+	span.name = name;
+	span.depth = buffer->depth++;
+	span.end = 0;
+	span.begin = StageTimer::nsec();
+
+	_index = (u32)buffer->spans.size();
+	buffer->spans.push_back(span);
+
+	_buffer = buffer;
+}
+
+void TraceSpan::end() {
+	_buffer->spans[_index].end = StageTimer::nsec();
+	--_buffer->depth;
+}
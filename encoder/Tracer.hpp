@@ -0,0 +1,119 @@
+/*
+	Copyright (c) 2013 Game Closure.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of GCIF nor the names of its contributors may be used
+	  to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+#include "../decoder/Platform.hpp"
+#include <vector>
+
+/*
+ * Span Tracer
+ *
+ * Records the begin and end time of each encoder design phase, so that the
+ * phase that blows up on a given image can be seen in chrome://tracing or
+ * Perfetto.  Spans nest, so the recursive MonoWriter runs for filter tiles
+ * show up at their recursion depth.
+ *
+ * Each thread appends to its own buffer, so recording a span takes no lock.
+ * A thread's buffer is registered once on its first span.  When tracing is
+ * not enabled a span costs a single branch.
+ */
+
+namespace cat {
+
+
+//// Tracer
+
+class Tracer {
+	static bool _enabled;
+
+public:
+	struct Span {
+		const char *name;	// String literal
+		u64 begin, end;		// Nanoseconds
+		int depth;			// Nesting depth on this thread
+	};
+
+	struct ThreadBuffer {
+		std::vector<Span> spans;
+		int tid, depth;
+		ThreadBuffer *next;
+	};
+
+	// Start recording spans
+	static void enable();
+
+	static CAT_INLINE bool enabled() {
+		return _enabled;
+	}
+
+	// Buffer for the calling thread
+	static ThreadBuffer *getBuffer();
+
+	// Write spans from all threads as Chrome trace JSON
+	static bool write(const char *path);
+};
+
+
+//// TraceSpan
+
+// Records a span from construction to end of scope
+class TraceSpan {
+	Tracer::ThreadBuffer *_buffer;
+	u32 _index;
+
+	void begin(const char *name);
+	void end();
+
+public:
+	CAT_INLINE TraceSpan(const char *name) {
+		_buffer = 0;
+
+		if CAT_UNLIKELY(Tracer::enabled()) {
+			begin(name);
+		}
+	}
+
+	CAT_INLINE ~TraceSpan() {
+		if (_buffer) {
+			end();
+		}
+	}
+};
+
+#define CAT_TRACE_JOIN2(a, b) a ## b
+#define CAT_TRACE_JOIN(a, b) CAT_TRACE_JOIN2(a, b)
+
+// Trace the rest of the enclosing scope under the given name
+#define CAT_TRACE_SPAN(name) cat::TraceSpan CAT_TRACE_JOIN(trace_span_, __LINE__)(name)
+
+
+} // namespace cat
+
+#endif // TRACER_HPP
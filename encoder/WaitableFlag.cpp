@@ -144,7 +144,7 @@ bool WaitableFlag::Wait(int milliseconds)
 		struct timeval tv;
 		if (gettimeofday(&tv, 0) == 0)
 		{
-			long nsec = tv.tv_usec;
+			long nsec = tv.tv_usec * 1000;
 
 			if (nsec >= 0)
 			{
@@ -43,6 +43,14 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 #include "Clock.hpp"
 using namespace cat;
 
+#include <string.h>
+
+/*SSE2 unfiltering for 8-bit RGB and RGBA scanlines*/
+#if defined(CAT_ISA_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define LODEPNG_SSE2
+#include <emmintrin.h>
+#endif
+
 /*
 This source file is built up in the following large parts. The code sections
 with the "LODEPNG_COMPILE_" #defines divide this up further in an intermixed way.
@@ -503,8 +511,16 @@ typedef struct HuffmanTree
   unsigned* lengths; /*the lengths of the codes of the 1d-tree*/
   unsigned maxbitlen; /*maximum number of bits a single code can get*/
   unsigned numcodes; /*number of symbols in the alphabet = number of codes*/
+  /*lookup of the next FIRSTBITS input bits, see HuffmanTree_makeTable*/
+  unsigned short* table_value;
+  unsigned char* table_len;
 } HuffmanTree;
 
+/*number of bits decoded at once by the lookup table*/
+#define FIRSTBITS 9u
+/*table_len value for bit patterns that walk outside the tree*/
+#define TABLE_INVALID 255u
+
 /*function used for debug purposes to draw the tree in ascii art with C++*/
 /*#include <iostream>
 static void HuffmanTree_draw(HuffmanTree* tree)
@@ -523,6 +539,8 @@ static void HuffmanTree_init(HuffmanTree* tree)
   tree->tree2d = 0;
   tree->tree1d = 0;
   tree->lengths = 0;
+  tree->table_value = 0;
+  tree->table_len = 0;
 }
 
 static void HuffmanTree_cleanup(HuffmanTree* tree)
@@ -530,6 +548,53 @@ static void HuffmanTree_cleanup(HuffmanTree* tree)
   lodepng_free(tree->tree2d);
   lodepng_free(tree->tree1d);
   lodepng_free(tree->lengths);
+  lodepng_free(tree->table_value);
+  lodepng_free(tree->table_len);
+}
+
+/*
+Build the lookup table from tree2d. Each entry is indexed by the next FIRSTBITS
+input bits, first bit in the lowest position. If a code ends within those bits,
+table_len is its length and table_value its symbol. If the code is longer,
+table_len is FIRSTBITS + 1 and table_value is the tree2d position to continue
+walking from. return value is error.
+*/
+static unsigned HuffmanTree_makeTable(HuffmanTree* tree)
+{
+  unsigned index;
+
+  tree->table_value = (unsigned short*)lodepng_malloc((1u << FIRSTBITS) * sizeof(unsigned short));
+  tree->table_len = (unsigned char*)lodepng_malloc(1u << FIRSTBITS);
+  if(!tree->table_value || !tree->table_len) return 83; /*alloc fail*/
+
+  for(index = 0; index < (1u << FIRSTBITS); index++)
+  {
+    unsigned treepos = 0, i, ct;
+    unsigned char len = FIRSTBITS + 1;
+
+    /*walk the tree the same way huffmanDecodeSymbol does*/
+    for(i = 0; i < FIRSTBITS; i++)
+    {
+      ct = tree->tree2d[(treepos << 1) + ((index >> i) & 1)];
+      if(ct < tree->numcodes)
+      {
+        len = (unsigned char)(i + 1);
+        treepos = ct;
+        break;
+      }
+      treepos = ct - tree->numcodes;
+      if(treepos >= tree->numcodes)
+      {
+        len = TABLE_INVALID;
+        break;
+      }
+    }
+
+    tree->table_len[index] = len;
+    tree->table_value[index] = (unsigned short)treepos;
+  }
+
+  return 0;
 }
 
 /*the tree representation used by the decoder. return value is error*/
@@ -589,7 +654,7 @@ static unsigned HuffmanTree_make2DTree(HuffmanTree* tree)
     if(tree->tree2d[n] == 32767) tree->tree2d[n] = 0; /*remove possible remaining 32767's*/
   }
 
-  return 0;
+  return HuffmanTree_makeTable(tree);
 }
 
 /*
@@ -933,6 +998,27 @@ static unsigned huffmanDecodeSymbol(const unsigned char* in, size_t* bp,
                                     const HuffmanTree* codetree, size_t inbitlength)
 {
   unsigned treepos = 0, ct;
+
+  /*if three whole bytes can be read, decode the first FIRSTBITS bits with one lookup*/
+  if(*bp + 24 <= inbitlength)
+  {
+    const unsigned char* p = &in[*bp >> 3];
+    unsigned index = (((unsigned)p[0] | ((unsigned)p[1] << 8) | ((unsigned)p[2] << 16)) >> (*bp & 7))
+                   & ((1u << FIRSTBITS) - 1);
+    unsigned len = codetree->table_len[index];
+
+    if(len <= FIRSTBITS)
+    {
+      (*bp) += len;
+      return codetree->table_value[index];
+    }
+    if(len == TABLE_INVALID) return (unsigned)(-1); /*error: it appeared outside the codetree*/
+
+    /*the code is longer, continue in the tree*/
+    (*bp) += FIRSTBITS;
+    treepos = codetree->table_value[index];
+  }
+
   for(;;)
   {
     if(*bp >= inbitlength) return (unsigned)(-1); /*error: end of input memory reached without endcode*/
@@ -1186,12 +1272,21 @@ static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size
         if(!ucvector_resize(out, ((*pos) + length) * 2)) ERROR_BREAK(83 /*alloc fail*/);
       }
 
-      for(forward = 0; forward < length; forward++)
+      if(distance >= length)
+      {
+        /*source and destination do not overlap*/
+        memcpy(&out->data[start], &out->data[backward], length);
+        (*pos) += length;
+      }
+      else
       {
-        out->data[(*pos)] = out->data[backward];
-        (*pos)++;
-        backward++;
-        if(backward >= start) backward = start - distance;
+        /*the copy repeats the last distance bytes, so copy forward one at a time*/
+        for(forward = 0; forward < length; forward++)
+        {
+          out->data[(*pos)] = out->data[backward];
+          (*pos)++;
+          backward++;
+        }
       }
     }
     else if(code_ll == 256)
@@ -2068,6 +2163,20 @@ static unsigned update_adler32(unsigned adler, const unsigned char* data, unsign
     /*at least 5550 sums can be done before the sums overflow, saving a lot of module divisions*/
     unsigned amount = len > 5550 ? 5550 : len;
     len -= amount;
+    /*unrolled 16 bytes at a time, this checksum runs over the whole inflated image*/
+    while(amount >= 16)
+    {
+      s1 += data[0]; s2 += s1; s1 += data[1]; s2 += s1;
+      s1 += data[2]; s2 += s1; s1 += data[3]; s2 += s1;
+      s1 += data[4]; s2 += s1; s1 += data[5]; s2 += s1;
+      s1 += data[6]; s2 += s1; s1 += data[7]; s2 += s1;
+      s1 += data[8]; s2 += s1; s1 += data[9]; s2 += s1;
+      s1 += data[10]; s2 += s1; s1 += data[11]; s2 += s1;
+      s1 += data[12]; s2 += s1; s1 += data[13]; s2 += s1;
+      s1 += data[14]; s2 += s1; s1 += data[15]; s2 += s1;
+      data += 16;
+      amount -= 16;
+    }
     while(amount > 0)
     {
       s1 += (*data++);
@@ -4000,6 +4109,148 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h, LodePNGState* state,
   return state->error;
 }
 
+#ifdef LODEPNG_SSE2
+
+/*
+Unfilter one pixel at a time in the low bytes of an SSE2 register, like libpng.
+bpp is 3 or 4 and is a constant after inlining. recon and scanline may be the
+same memory, so each pixel is loaded before it is stored.
+*/
+
+static inline __m128i loadPixelSSE2(const unsigned char* p, size_t bpp)
+{
+  unsigned v;
+  if(bpp == 4) memcpy(&v, p, 4);
+  else v = (unsigned)p[0] | ((unsigned)p[1] << 8) | ((unsigned)p[2] << 16); /*a 3-byte memcpy stalls store forwarding*/
+  return _mm_cvtsi32_si128((int)v);
+}
+
+static inline void storePixelSSE2(unsigned char* p, __m128i v, size_t bpp)
+{
+  unsigned x = (unsigned)_mm_cvtsi128_si32(v);
+  if(bpp == 4) memcpy(p, &x, 4);
+  else
+  {
+    p[0] = (unsigned char)x;
+    p[1] = (unsigned char)(x >> 8);
+    p[2] = (unsigned char)(x >> 16);
+  }
+}
+
+static inline void unfilterSubSSE2(unsigned char* recon, const unsigned char* scanline, size_t length, size_t bpp)
+{
+  __m128i a = _mm_setzero_si128();
+  size_t i;
+  for(i = 0; i < length; i += bpp)
+  {
+    a = _mm_add_epi8(a, loadPixelSSE2(&scanline[i], bpp));
+    storePixelSSE2(&recon[i], a, bpp);
+  }
+}
+
+static void unfilterUpSSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon, size_t length)
+{
+  size_t i = 0;
+  for(; i + 16 <= length; i += 16)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)&scanline[i]);
+    __m128i b = _mm_loadu_si128((const __m128i*)&precon[i]);
+    _mm_storeu_si128((__m128i*)&recon[i], _mm_add_epi8(x, b));
+  }
+  for(; i < length; i++) recon[i] = scanline[i] + precon[i];
+}
+
+static inline void unfilterAvgSSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                   size_t length, size_t bpp)
+{
+  const __m128i one = _mm_set1_epi8(1);
+  __m128i a = _mm_setzero_si128();
+  size_t i;
+  for(i = 0; i < length; i += bpp)
+  {
+    __m128i b = loadPixelSSE2(&precon[i], bpp);
+    /*_mm_avg_epu8 rounds up, so subtract the carry for (a + b) / 2*/
+    __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+    a = _mm_add_epi8(avg, loadPixelSSE2(&scanline[i], bpp));
+    storePixelSSE2(&recon[i], a, bpp);
+  }
+}
+
+static inline __m128i selectSSE2(__m128i mask, __m128i t, __m128i e)
+{
+  return _mm_or_si128(_mm_and_si128(mask, t), _mm_andnot_si128(mask, e));
+}
+
+static inline __m128i absSSE2(__m128i x)
+{
+  return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static inline void unfilterPaethSSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                     size_t length, size_t bpp)
+{
+  const __m128i zero = _mm_setzero_si128();
+  /*a = left, b = up, c = up-left, all widened to 16 bits*/
+  __m128i a = zero, b = zero, c, d = zero;
+  size_t i;
+  for(i = 0; i < length; i += bpp)
+  {
+    __m128i pa, pb, pc, smallest, nearest;
+
+    c = b;
+    b = _mm_unpacklo_epi8(loadPixelSSE2(&precon[i], bpp), zero);
+    a = d;
+
+    /*same choice as paethPredictor: a, then b, then c on ties*/
+    pa = _mm_sub_epi16(b, c);
+    pb = _mm_sub_epi16(a, c);
+    pc = _mm_add_epi16(pa, pb);
+    pa = absSSE2(pa);
+    pb = absSSE2(pb);
+    pc = absSSE2(pc);
+    smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+    nearest = selectSSE2(_mm_cmpeq_epi16(smallest, pa), a,
+              selectSSE2(_mm_cmpeq_epi16(smallest, pb), b, c));
+
+    d = _mm_add_epi8(loadPixelSSE2(&scanline[i], bpp), _mm_packus_epi16(nearest, nearest));
+    storePixelSSE2(&recon[i], d, bpp);
+    d = _mm_unpacklo_epi8(d, zero);
+  }
+}
+
+/*returns 1 if the scanline was unfiltered here*/
+static unsigned unfilterScanlineSSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                     size_t bytewidth, unsigned char filterType, size_t length)
+{
+  if(bytewidth != 3 && bytewidth != 4) return 0;
+
+  switch(filterType)
+  {
+    case 1:
+      if(bytewidth == 4) unfilterSubSSE2(recon, scanline, length, 4);
+      else unfilterSubSSE2(recon, scanline, length, 3);
+      return 1;
+    case 2:
+      if(!precon) return 0;
+      unfilterUpSSE2(recon, scanline, precon, length);
+      return 1;
+    case 3:
+      if(!precon) return 0;
+      if(bytewidth == 4) unfilterAvgSSE2(recon, scanline, precon, length, 4);
+      else unfilterAvgSSE2(recon, scanline, precon, length, 3);
+      return 1;
+    case 4:
+      if(!precon) return 0;
+      if(bytewidth == 4) unfilterPaethSSE2(recon, scanline, precon, length, 4);
+      else unfilterPaethSSE2(recon, scanline, precon, length, 3);
+      return 1;
+  }
+
+  return 0;
+}
+
+#endif /*LODEPNG_SSE2*/
+
 static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
                                  size_t bytewidth, unsigned char filterType, size_t length)
 {
@@ -4013,6 +4264,11 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   */
 
   size_t i;
+
+#ifdef LODEPNG_SSE2
+  if(unfilterScanlineSSE2(recon, scanline, precon, bytewidth, filterType, length)) return 0;
+#endif /*LODEPNG_SSE2*/
+
   switch(filterType)
   {
     case 0:
@@ -28,10 +28,12 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
 using namespace std;
 
 #include "encoder/Log.hpp"
 #include "encoder/Clock.hpp"
+#include "encoder/Tracer.hpp"
 #include "decoder/Enforcer.hpp"
 
 #include "decoder/GCIFReader.h"
@@ -179,13 +181,36 @@ unsigned char *load_png_from_memory(unsigned char *bits, int *width, int *height
 
 //// Commands
 
-static int compress(const char *filename, const char *outfile, int compress_level, int strip_transparent_color) {
+// Write tiled or with the shared table dictionary if one was given
+static int writeImage(const void *rgba, int xsize, int ysize, const char *outfile, int compress_level, int strip_transparent_color, int dict_id, int tile_size) {
+	if (tile_size > 0) {
+		return gcif_write_tiled(rgba, xsize, ysize, outfile, compress_level, strip_transparent_color, tile_size);
+	} else if (dict_id > 0) {
+		return gcif_write_dict(rgba, xsize, ysize, outfile, compress_level, strip_transparent_color, dict_id);
+	} else {
+		return gcif_write(rgba, xsize, ysize, outfile, compress_level, strip_transparent_color);
+	}
+}
+
+// PNG color type for a channel count
+static LodePNGColorType channelsColorType(int channels) {
+	switch (channels) {
+	case 1:
+		return LCT_GREY;
+	case 3:
+		return LCT_RGB;
+	default:
+		return LCT_RGBA;
+	}
+}
+
+static int compress(const char *filename, const char *outfile, int compress_level, int strip_transparent_color, int dict_id, int tile_size, int channels) {
 	vector<unsigned char> image;
 	unsigned xsize, ysize;
 
 	CAT_WARN("main") << "Reading input PNG image file: " << filename;
 
-	unsigned error = lodepng::decode(image, xsize, ysize, filename);
+	unsigned error = lodepng::decode(image, xsize, ysize, filename, channelsColorType(channels));
 
 	if (error) {
 		CAT_WARN("main") << "PNG read error " << error << ": " << lodepng_error_text(error);
@@ -196,7 +221,14 @@ static int compress(const char *filename, const char *outfile, int compress_leve
 
 	int err;
 
-	if ((err = gcif_write(&image[0], xsize, ysize, outfile, compress_level, strip_transparent_color))) {
+	// If not RGBA, the image is written on its own without tiles or a dictionary
+	if (channels != 4) {
+		err = gcif_write_channels(&image[0], channels, xsize, ysize, outfile, compress_level, strip_transparent_color);
+	} else {
+		err = writeImage(&image[0], xsize, ysize, outfile, compress_level, strip_transparent_color, dict_id, tile_size);
+	}
+
+	if (err) {
 		CAT_WARN("main") << "Error while compressing the image: " << gcif_write_errstr(err);
 		return err;
 	}
@@ -205,20 +237,72 @@ static int compress(const char *filename, const char *outfile, int compress_leve
 }
 
 
+static int decompressRegion(const char *filename, const char *outfile, const char *region) {
+	int x, y, w, h;
+
+	if (sscanf(region, "%d,%d,%d,%d", &x, &y, &w, &h) != 4) {
+		CAT_WARN("main") << "Region should be given as x,y,w,h: " << region;
+		return GCIF_RE_BAD_DIMS;
+	}
+
+	CAT_WARN("main") << "Decoding region " << region << " of input GCIF image file: " << filename;
+
+	MappedFile file;
+	MappedView fileView;
+
+	if (!file.OpenRead(filename) || !fileView.Open(&file)) {
+		return GCIF_RE_FILE;
+	}
+
+	u8 *fileData = fileView.MapView();
+	if (!fileData) {
+		return GCIF_RE_FILE;
+	}
+
+	int err;
+
+	GCIFImage image;
+	if ((err = gcif_read_region(fileData, fileView.GetLength(), x, y, w, h, &image))) {
+		CAT_WARN("main") << "Error while decompressing the image: " << gcif_read_errstr(err);
+		return err;
+	}
+
+	CAT_WARN("main") << "Writing output PNG image file: " << outfile;
+
+	lodepng_encode_file(outfile, (const unsigned char*)image.rgba, image.xsize, image.ysize, LCT_RGBA, 8);
+
+	free(image.rgba);
+
+	return GCIF_RE_OK;
+}
+
 static int decompress(const char *filename, const char *outfile) {
 	CAT_WARN("main") << "Decoding input GCIF image file: " << filename;
 
+	MappedFile file;
+	MappedView fileView;
+
+	if (!file.OpenRead(filename) || !fileView.Open(&file)) {
+		return GCIF_RE_FILE;
+	}
+
+	u8 *fileData = fileView.MapView();
+	if (!fileData) {
+		return GCIF_RE_FILE;
+	}
+
 	int err;
 
+	// Gray and RGB images are written back to PNG with the same channels
 	GCIFImage image;
-	if ((err = gcif_read_file(filename, &image))) {
+	if ((err = gcif_read_memory_ex(fileData, fileView.GetLength(), GCIF_FMT_NATIVE, &image))) {
 		CAT_WARN("main") << "Error while decompressing the image: " << gcif_read_errstr(err);
 		return err;
 	}
 
 	CAT_WARN("main") << "Writing output PNG image file: " << outfile;
 
-	lodepng_encode_file(outfile, (const unsigned char*)image.rgba, image.xsize, image.ysize, LCT_RGBA, 8);
+	lodepng_encode_file(outfile, (const unsigned char*)image.rgba, image.xsize, image.ysize, channelsColorType(image.channels), 8);
 
 	free(image.rgba);
 
@@ -273,7 +357,7 @@ static int benchfile(string filename) {
 
 	double t3 = Clock::ref()->usec();
 
-	for (u32 ii = 0; ii < xsize * ysize * 4; ii += 4) {
+	for (u64 ii = 0; ii < (u64)xsize * ysize * 4; ii += 4) {
 		if (image[ii + 3] == 0) {
 			if (*(u32*)&outimage.rgba[ii] != 0) {
 				CAT_WARN("main") << "Output image does not match input image for " << filename << " at " << ii << " (on transparency)";
@@ -306,71 +390,40 @@ static int benchfile(string filename) {
 	return GCIF_RE_OK;
 }
 
-#include "encoder/Thread.hpp"
-#include "encoder/WaitableFlag.hpp"
-#include "encoder/Mutex.hpp"
+#include "encoder/ThreadPool.hpp"
 #include "encoder/SystemInfo.hpp"
-
-class BenchThread : public Thread {
-	vector<string> *_files;
-	Mutex *_lock;
-	WaitableFlag _ready;
-	volatile bool _abort, _shutdown;
-
-public:
-	void init(vector<string> *files, Mutex *lock) {
-		_files = files;
-		_lock = lock;
-		_shutdown = false;
-		_abort = false;
-	}
-
-	virtual bool Entrypoint(void *param) {
-		while (!_abort) {
-			if (_ready.Wait()) {
-				string filename;
-				bool hasFile;
-
-				while (!_abort) {
-					hasFile = false;
-					{
-						AutoMutex alock(*_lock);
-
-						if (_files->size() > 0) {
-							hasFile = true;
-							filename = _files->back();
-							_files->pop_back();
-						}
-					}
-
-					if (hasFile) {
-						benchfile(filename);
-					} else {
-						break;
-					}
-				}
-
-				if (_shutdown) {
-					break;
-				}
-			}
+#include "decoder/StageTimer.hpp"
+
+// Shared by the batch modes.  The calling thread runs tasks while it waits,
+// so the pool leaves one processor for it
+static ThreadPool m_pool;
+
+static ThreadPool *batchPool() {
+#ifndef CAT_BENCH_ONE
+	if (m_pool.getWorkerCount() <= 0) {
+		int worker_count = SystemInfo::ref()->GetProcessorCount() - 1;
+		if (worker_count < 1) {
+			worker_count = 1;
 		}
 
-		return true;
+		CAT_ENFORCE(m_pool.init(worker_count));
 	}
+#endif
 
-	void wake() {
-		_ready.Set();
-	}
+	// With no workers, submitted tasks run immediately on the caller
+	return &m_pool;
+}
 
-	void abort() {
-		_abort = true;
-	}
+// Size of a file, used to start the largest files of a batch first
+static u64 fileSize(const string &filename) {
+	struct stat st;
 
-	void shutdown() {
-		_shutdown = true;
+	if (stat(filename.c_str(), &st) != 0) {
+		return 0;
 	}
-};
+
+	return (u64)st.st_size;
+}
 
 #ifdef CAT_COMPILER_MSVC
 #include "msvc/dirent.h"
@@ -378,6 +431,14 @@ public:
 #include <dirent.h>
 #endif
 
+#if defined(CAT_OS_LINUX) && defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+static void benchTask(void *param, int index) {
+	benchfile((*(vector<string>*)param)[index]);
+}
+
 static int benchmark(const char *path) {
 	DIR *dir;
 	struct dirent *ent;
@@ -386,28 +447,248 @@ static int benchmark(const char *path) {
 		return -1;
 	}
 
-	const int MAX_CPU_COUNT = 64;
-	int cpu_count = SystemInfo::ref()->GetProcessorCount();
-	if (cpu_count > MAX_CPU_COUNT) {
-		cpu_count = MAX_CPU_COUNT;
+	vector<string> files;
+
+	while ((ent = readdir (dir)) != NULL) {
+		const char *name = ent->d_name;
+		int namelen = (int)strlen(name);
+
+		if (namelen > 4 &&
+			tolower(name[namelen-3]) == 'p' &&
+			tolower(name[namelen-2]) == 'n' &&
+			tolower(name[namelen-1]) == 'g') {
+			files.push_back(string(path) + "/" + name);
+		}
 	}
-	cpu_count--;
-	if (cpu_count < 1) {
-		cpu_count = 1;
+
+	closedir(dir);
+
+	ThreadPool *pool = batchPool();
+	TaskGroup group;
+
+	for (int ii = 0; ii < (int)files.size(); ++ii) {
+		pool->submit(group, benchTask, &files, ii, fileSize(files[ii]));
 	}
 
-#ifdef CAT_BENCH_ONE
-	cpu_count = 1;
+	pool->wait(group);
+
+	return 0;
+}
+
+
+//// Knob sweep
+
+/*
+ * Encodes a corpus with a grid of knob settings and prints the Pareto
+ * frontier of encode time, output size and peak memory, for choosing
+ * presets that fit a build-time budget.
+ *
+ * Each setting encodes all of the images in parallel on the batch thread
+ * pool, so peak memory is for that many encodes at once.  It is the
+ * peak resident size above the decoded corpus, and is only known on Linux.
+ */
+
+struct SweepImage {
+	string name;
+	vector<unsigned char> rgba;
+	unsigned xsize, ysize;
+};
+
+struct SweepSetting {
+	string label;
+	GCIFKnobs knobs;
+
+	u64 encode_nsec;	// Sum of encode times, excluding file output
+	u64 bytes;			// Sum of output file sizes
+	u64 peak_kb;		// Peak resident memory above the loaded corpus, or 0 if unknown
+	int errors;
+};
+
+// Read a memory field in KB from /proc/self/status, or 0 if unknown
+static u64 readMemoryField(const char *field) {
+	u64 kb = 0;
+
+#if defined(CAT_OS_LINUX)
+	FILE *file = fopen("/proc/self/status", "r");
+	if (file) {
+		const int len = (int)strlen(field);
+		char line[256];
+		while (fgets(line, sizeof(line), file)) {
+			if (strncmp(line, field, len) == 0) {
+				kb = strtoull(line + len, 0, 10);
+				break;
+			}
+		}
+		fclose(file);
+	}
 #endif
 
-	BenchThread threads[MAX_CPU_COUNT];
-	vector<string> files;
+	return kb;
+}
+
+// Reset the peak resident memory counter and return the baseline in KB
+static u64 resetPeakMemory() {
+#if defined(CAT_OS_LINUX)
+#if defined(__GLIBC__)
+	// Release freed heap so the next peak starts from live memory
+	malloc_trim(0);
+#endif
+
+	FILE *file = fopen("/proc/self/clear_refs", "w");
+	if (file) {
+		fputs("5", file);
+		fclose(file);
+	}
+#endif
+
+	return readMemoryField("VmRSS:");
+}
+
+// Peak resident memory in KB above the baseline, or 0 if unknown
+static u64 readPeakMemory(u64 baseline_kb) {
+	u64 kb = readMemoryField("VmHWM:");
+
+	return kb > baseline_kb ? kb - baseline_kb : 0;
+}
+
+struct SweepJob {
+	vector<SweepImage> *images;
+	SweepSetting *setting;
 	Mutex lock;
+};
+
+static void sweepTask(void *param, int index) {
+	SweepJob *job = (SweepJob*)param;
+	SweepImage &image = (*job->images)[index];
+	SweepSetting *setting = job->setting;
+
+	GCIFWriteStats stats;
+	void *data;
+	long bytes;
+
+	int err = gcif_write_memory_ex2(&image.rgba[0], image.xsize, image.ysize, &setting->knobs, 1, &data, &bytes, &stats);
+
+	if (!err) {
+		free(data);
+	}
+
+	AutoMutex alock(job->lock);
 
-	for (int ii = 0; ii < cpu_count; ++ii) {
-		threads[ii].init(&files, &lock);
-		CAT_ENFORCE(threads[ii].StartThread());
+	if (err) {
+		CAT_WARN("sweep") << "Error while compressing " << image.name << " with " << setting->label << ": " << gcif_write_errstr(err);
+		setting->errors++;
+	} else {
+		setting->encode_nsec += stats.total_nsec - stats.output.nsec;
+		setting->bytes += stats.output.bytes;
 	}
+}
+
+// Build the knob grid: each preset level with one knob group changed
+static void sweepGrid(int compression_level, vector<SweepSetting> &settings) {
+	int level0 = 0, level1 = 3;
+	if (compression_level <= 3) {
+		level0 = level1 = compression_level;
+	}
+
+	static const char *VARIANTS[] = {
+		"preset", "no-revisit", "short-lz-chains", "loose-filters", "no-lz", "fast-rgba"
+	};
+	static const int VARIANT_COUNT = sizeof(VARIANTS) / sizeof(VARIANTS[0]);
+
+	for (int level = level0; level <= level1; ++level) {
+		for (int variant = 0; variant < VARIANT_COUNT; ++variant) {
+			SweepSetting setting;
+			CAT_OBJCLR(setting.knobs);
+			gcif_get_knobs(level, &setting.knobs);
+
+			GCIFKnobs &knobs = setting.knobs;
+
+			switch (variant) {
+			case 1:
+				knobs.rgba_revisitCount = 0;
+				knobs.mono_revisitCount = 0;
+				break;
+			case 2:
+				knobs.rgba_lzPrematchLimit = 256;
+				knobs.rgba_lzInmatchLimit = knobs.rgba_lzInmatchLimit > 64 ? 64 : knobs.rgba_lzInmatchLimit;
+				knobs.mono_lzPrematchLimit = 256;
+				knobs.mono_lzInmatchLimit = 64;
+				break;
+			case 3:
+				knobs.rgba_filterCoverThresh = 0.6f;
+				knobs.rgba_filterIncThresh = 0.05f;
+				break;
+			case 4:
+				// Fast RGBA mode relies on the LZ pass to design its filters
+				knobs.rgba_enableLZ = false;
+				knobs.rgba_fastMode = false;
+				knobs.pal_enableLZ = false;
+				knobs.spal_enableLZ = false;
+				break;
+			case 5:
+				knobs.rgba_fastMode = true;
+				break;
+			}
+
+			// If this matches an earlier setting, skip it
+			bool duplicate = false;
+			for (int ii = 0; ii < (int)settings.size(); ++ii) {
+				if (memcmp(&settings[ii].knobs, &knobs, sizeof(knobs)) == 0) {
+					duplicate = true;
+					break;
+				}
+			}
+			if (duplicate) {
+				continue;
+			}
+
+			char label[64];
+			sprintf(label, "L%d %s", level, VARIANTS[variant]);
+			setting.label = label;
+			setting.encode_nsec = 0;
+			setting.bytes = 0;
+			setting.peak_kb = 0;
+			setting.errors = 0;
+
+			settings.push_back(setting);
+		}
+	}
+}
+
+// True if a is no worse than b on every axis and better on one
+static bool dominates(const SweepSetting &a, const SweepSetting &b) {
+	const bool no_worse = a.encode_nsec <= b.encode_nsec &&
+						  a.bytes <= b.bytes &&
+						  a.peak_kb <= b.peak_kb;
+	const bool better = a.encode_nsec < b.encode_nsec ||
+						a.bytes < b.bytes ||
+						a.peak_kb < b.peak_kb;
+
+	return no_worse && better;
+}
+
+static bool fasterSetting(const SweepSetting *a, const SweepSetting *b) {
+	return a->encode_nsec < b->encode_nsec;
+}
+
+static void printSetting(const SweepSetting &s) {
+	char line[256];
+	sprintf(line, "%-22s encode=%9.3f s  bytes=%11llu  peak=%8.1f MB%s",
+			s.label.c_str(), s.encode_nsec / 1e9, (unsigned long long)s.bytes,
+			s.peak_kb / 1024., s.errors ? "  (errors)" : "");
+	CAT_INFO("sweep") << line;
+}
+
+static int sweep(const char *path, int compression_level) {
+	DIR *dir;
+	struct dirent *ent;
+
+	if ((dir = opendir (path)) == NULL) {
+		return -1;
+	}
+
+	// Decode the corpus once up front
+	vector<SweepImage> images;
 
 	while ((ent = readdir (dir)) != NULL) {
 		const char *name = ent->d_name;
@@ -417,29 +698,83 @@ static int benchmark(const char *path) {
 			tolower(name[namelen-3]) == 'p' &&
 			tolower(name[namelen-2]) == 'n' &&
 			tolower(name[namelen-1]) == 'g') {
-			string filename = string(path) + "/" + name;
+			SweepImage image;
+			image.name = string(path) + "/" + name;
 
-			{
-				AutoMutex alock(lock);
-
-				files.push_back(filename);
+			unsigned error = lodepng::decode(image.rgba, image.xsize, image.ysize, image.name);
+			if (error) {
+				CAT_WARN("sweep") << "PNG read error " << error << ": " << lodepng_error_text(error) << " for " << image.name;
+				continue;
 			}
 
-			for (int ii = 0; ii < cpu_count; ++ii) {
-				threads[ii].wake();
-			}
+			images.push_back(image);
 		}
 	}
 
 	closedir(dir);
 
-	for (int ii = 0; ii < cpu_count; ++ii) {
-		threads[ii].shutdown();
-		threads[ii].wake();
+	if (images.empty()) {
+		CAT_WARN("sweep") << "No PNG images found in " << path;
+		return -1;
 	}
 
-	for (int ii = 0; ii < cpu_count; ++ii) {
-		CAT_ENFORCE(threads[ii].WaitForThread());
+	vector<SweepSetting> settings;
+	sweepGrid(compression_level, settings);
+
+	ThreadPool *pool = batchPool();
+
+	CAT_INFO("sweep") << "Sweeping " << settings.size() << " knob settings over " << images.size() << " images with " << pool->getWorkerCount() + 1 << " threads";
+
+	SweepJob job;
+	job.images = &images;
+
+	// For each setting,
+	for (int ii = 0; ii < (int)settings.size(); ++ii) {
+		SweepSetting &setting = settings[ii];
+		job.setting = &setting;
+
+		const u64 baseline_kb = resetPeakMemory();
+
+		TaskGroup group;
+
+		for (int jj = 0; jj < (int)images.size(); ++jj) {
+			pool->submit(group, sweepTask, &job, jj, (u64)images[jj].xsize * images[jj].ysize);
+		}
+
+		pool->wait(group);
+
+		setting.peak_kb = readPeakMemory(baseline_kb);
+
+		printSetting(setting);
+	}
+
+	// Collect settings that no other setting beats on every axis
+	vector<SweepSetting*> frontier;
+
+	for (int ii = 0; ii < (int)settings.size(); ++ii) {
+		if (settings[ii].errors) {
+			continue;
+		}
+
+		bool dominated = false;
+		for (int jj = 0; jj < (int)settings.size(); ++jj) {
+			if (!settings[jj].errors && dominates(settings[jj], settings[ii])) {
+				dominated = true;
+				break;
+			}
+		}
+
+		if (!dominated) {
+			frontier.push_back(&settings[ii]);
+		}
+	}
+
+	std::sort(frontier.begin(), frontier.end(), fasterSetting);
+
+	CAT_INFO("sweep") << "Pareto frontier (encode time, bytes, peak memory):";
+
+	for (int ii = 0; ii < (int)frontier.size(); ++ii) {
+		printSetting(*frontier[ii]);
 	}
 
 	return 0;
@@ -488,7 +823,7 @@ static int replacefile(string filename) {
 
 	double t3 = Clock::ref()->usec();
 
-	for (u32 ii = 0; ii < xsize * ysize * 4; ii += 4) {
+	for (u64 ii = 0; ii < (u64)xsize * ysize * 4; ii += 4) {
 		if (image[ii + 3] == 0) {
 			if (*(u32*)&outimage.rgba[ii] != 0) {
 				CAT_WARN("main") << "Output image does not match input image for " << filename << " at " << ii << " (on transparency)";
@@ -525,63 +860,339 @@ static int replacefile(string filename) {
 		unlink(cbenchfile);
 	}
 
-	free(outimage.rgba);
+	free(outimage.rgba);
+
+	return GCIF_RE_OK;
+}
+
+
+
+static void replaceTask(void *param, int index) {
+	replacefile((*(vector<string>*)param)[index]);
+}
+
+static int replace(const char *path) {
+	DIR *dir;
+	struct dirent *ent;
+
+	if ((dir = opendir (path)) == NULL) {
+		return -1;
+	}
+
+	vector<string> files;
+
+	while ((ent = readdir (dir)) != NULL) {
+		const char *name = ent->d_name;
+		int namelen = (int)strlen(name);
+
+		if (namelen > 4 &&
+			tolower(name[namelen-3]) == 'p' &&
+			tolower(name[namelen-2]) == 'n' &&
+			tolower(name[namelen-1]) == 'g') {
+			files.push_back(string(path) + "/" + name);
+		}
+	}
+
+	closedir(dir);
+
+	ThreadPool *pool = batchPool();
+	TaskGroup group;
+
+	for (int ii = 0; ii < (int)files.size(); ++ii) {
+		pool->submit(group, replaceTask, &files, ii, fileSize(files[ii]));
+	}
+
+	pool->wait(group);
+
+	return 0;
+}
+
+
+//// Pipelined batch conversion
+
+/*
+ * Converts a directory of PNG images to GCIF in four stages: read and inflate
+ * the PNG, encode, verify by decoding, and write the file.  Each stage has its
+ * own concurrency limit, so reads and writes waiting on the disk overlap with
+ * encoding rather than holding up the encoder threads.
+ *
+ * Only a fixed number of images are in flight at once, so memory is bounded
+ * by the images between stages rather than by the number of threads.  Later
+ * stages go first so finished images leave the pipeline quickly.
+ */
+
+enum ConvertStages {
+	CONVERT_READ,
+	CONVERT_ENCODE,
+	CONVERT_VERIFY,
+	CONVERT_WRITE,
+
+	CONVERT_STAGES
+};
+
+static const char *CONVERT_STAGE_NAMES[CONVERT_STAGES] = {
+	"read", "encode", "verify", "write"
+};
+
+struct ConvertItem {
+	string in_path, out_path;
+	int stage;
+	bool failed;
+
+	vector<unsigned char> rgba;
+	unsigned xsize, ysize;
+
+	u64 png_bytes;
+	void *gci;
+	long gci_bytes;
+};
+
+class ConvertPipeline {
+	vector<ConvertItem> _items;
+	int _compress_level, _strip_transparent_color;
+
+	ThreadPool _pool;
+	TaskGroup _group;
+
+	// Protects the scheduling state below
+	Mutex _lock;
+
+	int _limit[CONVERT_STAGES], _running[CONVERT_STAGES];
+	std::deque<int> _ready[CONVERT_STAGES];
+	int _next_item, _in_flight, _max_in_flight;
+
+	// Results
+	u64 _stage_nsec[CONVERT_STAGES];
+	u64 _png_bytes, _gci_bytes;
+	int _converted, _failed;
+
+	static void stageTask(void *param, int index);
+
+	void runStage(ConvertItem &item);
+	void schedule();
+
+public:
+	void init(const vector<string> &in_paths, const char *out_dir, int compress_level, int strip_transparent_color);
+
+	// Stage thread counts and the number of images in flight, 0 for defaults
+	bool run(const int *limits, int max_in_flight);
+};
+
+void ConvertPipeline::init(const vector<string> &in_paths, const char *out_dir, int compress_level, int strip_transparent_color) {
+	_items.resize(in_paths.size());
+
+	for (int ii = 0; ii < (int)in_paths.size(); ++ii) {
+		ConvertItem &item = _items[ii];
+		const string &path = in_paths[ii];
+
+		// Replace the directory and the .png extension
+		size_t slash = path.find_last_of("/\\");
+		string name = (slash == string::npos) ? path : path.substr(slash + 1);
+
+		item.in_path = path;
+		item.out_path = string(out_dir) + "/" + name.substr(0, name.size() - 4) + ".gci";
+		item.stage = CONVERT_READ;
+		item.failed = false;
+		item.xsize = item.ysize = 0;
+		item.png_bytes = 0;
+		item.gci = 0;
+		item.gci_bytes = 0;
+	}
+
+	_compress_level = compress_level;
+	_strip_transparent_color = strip_transparent_color;
+}
+
+void ConvertPipeline::runStage(ConvertItem &item) {
+	switch (item.stage) {
+	case CONVERT_READ:
+		{
+			item.png_bytes = fileSize(item.in_path);
+
+			unsigned error = lodepng::decode(item.rgba, item.xsize, item.ysize, item.in_path);
+			if (error) {
+				CAT_WARN("convert") << "PNG read error " << error << ": " << lodepng_error_text(error) << " for " << item.in_path;
+				item.failed = true;
+			}
+		}
+		break;
+
+	case CONVERT_ENCODE:
+		{
+			int err = gcif_write_memory(&item.rgba[0], item.xsize, item.ysize, _compress_level, _strip_transparent_color, &item.gci, &item.gci_bytes);
+			if (err) {
+				CAT_WARN("convert") << "Error while compressing the image: " << gcif_write_errstr(err) << " for " << item.in_path;
+				item.failed = true;
+			}
+		}
+		break;
+
+	case CONVERT_VERIFY:
+		{
+			GCIFImage image;
+			int err = gcif_read_memory(item.gci, item.gci_bytes, &image);
+			if (err) {
+				CAT_WARN("convert") << "Error while decompressing the image: " << gcif_read_errstr(err) << " for " << item.in_path;
+				item.failed = true;
+				break;
+			}
+
+			const u32 *expected = reinterpret_cast<const u32 *>( &item.rgba[0] );
+			const u32 *actual = reinterpret_cast<const u32 *>( image.rgba );
+			const u64 pixels = (u64)item.xsize * item.ysize;
+
+			for (u64 ii = 0; ii < pixels; ++ii) {
+				// If transparent color is stripped, only alpha must match
+				const bool stripped = _strip_transparent_color && item.rgba[ii * 4 + 3] == 0;
+
+				if (stripped ? actual[ii] != 0 : actual[ii] != expected[ii]) {
+					CAT_WARN("convert") << "Output image does not match input image for " << item.in_path << " at pixel " << ii;
+					item.failed = true;
+					break;
+				}
+			}
+
+			free(image.rgba);
+		}
+		break;
+
+	case CONVERT_WRITE:
+		{
+			FILE *file = fopen(item.out_path.c_str(), "wb");
+
+			if (!file || fwrite(item.gci, 1, item.gci_bytes, file) != (size_t)item.gci_bytes) {
+				CAT_WARN("convert") << "Unable to write " << item.out_path;
+				item.failed = true;
+			}
+
+			if (file) {
+				fclose(file);
+			}
+		}
+		break;
+	}
+}
+
+void ConvertPipeline::stageTask(void *param, int index) {
+	ConvertPipeline *pipeline = (ConvertPipeline*)param;
+	ConvertItem &item = pipeline->_items[index];
+
+	const u64 t0 = StageTimer::nsec();
+
+	pipeline->runStage(item);
+
+	const u64 t1 = StageTimer::nsec();
+
+	AutoMutex alock(pipeline->_lock);
+
+	pipeline->_stage_nsec[item.stage] += t1 - t0;
+	pipeline->_running[item.stage]--;
+
+	// If the image is done or failed,
+	if (item.failed || item.stage == CONVERT_WRITE) {
+		if (item.failed) {
+			pipeline->_failed++;
+		} else {
+			pipeline->_converted++;
+			pipeline->_png_bytes += item.png_bytes;
+			pipeline->_gci_bytes += item.gci_bytes;
+		}
+
+		// Release its memory and make room for the next image
+		vector<unsigned char>().swap(item.rgba);
+		free(item.gci);
+		item.gci = 0;
+
+		pipeline->_in_flight--;
+	} else {
+		// Free the pixels as soon as they are no longer needed
+		if (item.stage == CONVERT_VERIFY) {
+			vector<unsigned char>().swap(item.rgba);
+		}
+
+		item.stage++;
+		pipeline->_ready[item.stage].push_back(index);
+	}
+
+	pipeline->schedule();
+}
+
+// Start tasks for ready images up to each stage limit.  Called with _lock held
+void ConvertPipeline::schedule() {
+	// Admit new images while there is room in the pipeline
+	while (_in_flight < _max_in_flight && _next_item < (int)_items.size()) {
+		_ready[CONVERT_READ].push_back(_next_item++);
+		_in_flight++;
+	}
+
+	for (int stage = CONVERT_STAGES - 1; stage >= 0; --stage) {
+		while (_running[stage] < _limit[stage] && !_ready[stage].empty()) {
+			const int index = _ready[stage].front();
+			_ready[stage].pop_front();
+			_running[stage]++;
 
-	return GCIF_RE_OK;
+			_pool.submit(_group, stageTask, this, index, (u64)stage);
+		}
+	}
 }
 
+bool ConvertPipeline::run(const int *limits, int max_in_flight) {
+	int cpu_count = SystemInfo::ref()->GetProcessorCount();
+	if (cpu_count < 1) {
+		cpu_count = 1;
+	}
 
+	// Disk stages mostly wait, so they get a couple of threads each
+	const int DEFAULT_LIMITS[CONVERT_STAGES] = {
+		2, cpu_count, (cpu_count + 3) / 4, 2
+	};
+
+	int thread_count = 0;
+	for (int stage = 0; stage < CONVERT_STAGES; ++stage) {
+		_limit[stage] = (limits && limits[stage] > 0) ? limits[stage] : DEFAULT_LIMITS[stage];
+		_running[stage] = 0;
+		_stage_nsec[stage] = 0;
+		thread_count += _limit[stage];
+	}
 
-class ReplaceThread : public Thread {
-	vector<string> *_files;
-	Mutex *_lock;
-	volatile bool _shutdown;
+	// Enough images to keep every stage busy
+	_max_in_flight = max_in_flight > 0 ? max_in_flight : thread_count * 2;
+	_next_item = 0;
+	_in_flight = 0;
+	_png_bytes = _gci_bytes = 0;
+	_converted = _failed = 0;
 
-public:
-	void init(vector<string> *files, Mutex *lock) {
-		_files = files;
-		_lock = lock;
-		_shutdown = false;
-	}
-
-	virtual bool Entrypoint(void *param) {
-		do {
-			string filename;
-			bool hasFile;
-
-			do {
-				hasFile = false;
-				{
-					AutoMutex alock(*_lock);
-
-					if (_files->size() > 0) {
-						hasFile = true;
-						filename = _files->back();
-						_files->pop_back();
-					}
-				}
+	// Each stage task may block, so give every one its own thread
+	if (!_pool.init(thread_count)) {
+		return false;
+	}
 
-				if (hasFile) {
-					replacefile(filename);
-				} else {
-					break;
-				}
-			} while (hasFile);
-		} while (!_shutdown);
+	const u64 t0 = StageTimer::nsec();
 
-		return true;
-	}
+	{
+		AutoMutex alock(_lock);
 
-	void shutdown() {
-		_shutdown = true;
+		schedule();
 	}
-};
 
+	_pool.wait(_group);
+	_pool.shutdown();
 
+	const double seconds = (StageTimer::nsec() - t0) / 1e9;
 
+	CAT_INFO("convert") << "Converted " << _converted << " images (" << _failed << " failed) in " << seconds << " seconds with at most " << _max_in_flight << " in flight";
+	if (_gci_bytes > 0) {
+		CAT_INFO("convert") << "PNG bytes : " << _png_bytes << " => GCIF bytes : " << _gci_bytes << " (" << _png_bytes / (double)_gci_bytes << "x smaller)";
+	}
 
+	for (int stage = 0; stage < CONVERT_STAGES; ++stage) {
+		CAT_INFO("convert") << " - " << CONVERT_STAGE_NAMES[stage] << " : " << _limit[stage] << " threads, " << _stage_nsec[stage] / 1e9 << " busy seconds";
+	}
 
-static int replace(const char *path) {
+	return _failed == 0;
+}
+
+static int convert(const char *path, const char *out_dir, int compress_level, int strip_transparent_color, const char *stages, const char *inflight) {
 	DIR *dir;
 	struct dirent *ent;
 
@@ -589,58 +1200,44 @@ static int replace(const char *path) {
 		return -1;
 	}
 
-	const int MAX_CPU_COUNT = 64;
-	int cpu_count = SystemInfo::ref()->GetProcessorCount();
-	if (cpu_count > MAX_CPU_COUNT) {
-		cpu_count = MAX_CPU_COUNT;
-	}
-	cpu_count--;
-	if (cpu_count < 1) {
-		cpu_count = 1;
-	}
-
-	ReplaceThread threads[MAX_CPU_COUNT];
 	vector<string> files;
-	Mutex lock;
 
 	while ((ent = readdir (dir)) != NULL) {
 		const char *name = ent->d_name;
 		int namelen = (int)strlen(name);
 
 		if (namelen > 4 &&
+			name[namelen-4] == '.' &&
 			tolower(name[namelen-3]) == 'p' &&
 			tolower(name[namelen-2]) == 'n' &&
 			tolower(name[namelen-1]) == 'g') {
-			string filename = string(path) + "/" + name;
-
-			{
-				AutoMutex alock(lock);
-
-				files.push_back(filename);
-			}
+			files.push_back(string(path) + "/" + name);
 		}
 	}
 
 	closedir(dir);
 
-	for (int ii = 0; ii < cpu_count; ++ii) {
-		threads[ii].init(&files, &lock);
-		CAT_ENFORCE(threads[ii].StartThread());
-		threads[ii].shutdown();
+	int limits[CONVERT_STAGES] = { 0 };
+	if (stages) {
+		if (sscanf(stages, "%d,%d,%d,%d", &limits[0], &limits[1], &limits[2], &limits[3]) != CONVERT_STAGES) {
+			CAT_WARN("convert") << "Stage thread counts should look like 2,8,2,2 for read,encode,verify,write";
+			return -1;
+		}
 	}
 
-	for (int ii = 0; ii < cpu_count; ++ii) {
-		CAT_ENFORCE(threads[ii].WaitForThread());
-	}
+	const int max_in_flight = inflight ? atoi(inflight) : 0;
 
-	return 0;
+	ConvertPipeline pipeline;
+	pipeline.init(files, out_dir, compress_level, strip_transparent_color);
+
+	return pipeline.run(limits, max_in_flight) ? 0 : -1;
 }
 
 
 
 
 
-static int testfile(string filename) {
+static int testfile(string filename, int dict_id, int tile_size) {
 	vector<unsigned char> image;
 	unsigned xsize, ysize;
 
@@ -665,7 +1262,7 @@ static int testfile(string filename) {
 
 	const int strip_transparent_color = 1;
 
-	if ((err = gcif_write(&image[0], xsize, ysize, cbenchfile, compress_level, strip_transparent_color))) {
+	if ((err = writeImage(&image[0], xsize, ysize, cbenchfile, compress_level, strip_transparent_color, dict_id, tile_size))) {
 		CAT_WARN("main") << "Error while compressing the image: " << gcif_write_errstr(err) << " for " << filename;
 		return err;
 	}
@@ -680,7 +1277,7 @@ static int testfile(string filename) {
 
 	double t3 = Clock::ref()->usec();
 
-	for (u32 ii = 0; ii < xsize * ysize * 4; ii += 4) {
+	for (u64 ii = 0; ii < (u64)xsize * ysize * 4; ii += 4) {
 		if (image[ii + 3] == 0) {
 			if (*(u32*)&outimage.rgba[ii] != 0) {
 				CAT_WARN("main") << "Output image does not match input image for " << filename << " at " << ii << " (on transparency)";
@@ -821,9 +1418,247 @@ static int profileit(const char *filename) {
 }
 
 
+static int loadDictionary(const char *filename, int &dict_id) {
+	MappedFile file;
+	MappedView fileView;
+
+	if CAT_UNLIKELY(!file.OpenRead(filename)) {
+		return GCIF_RE_FILE;
+	}
+
+	if CAT_UNLIKELY(!fileView.Open(&file)) {
+		return GCIF_RE_FILE;
+	}
+
+	u8 * CAT_RESTRICT fileData = fileView.MapView();
+	if CAT_UNLIKELY(!fileData) {
+		return GCIF_RE_FILE;
+	}
+
+	int fileLen = fileView.GetLength();
+
+	int err;
+	if ((err = gcif_set_dictionary(fileData, fileLen))) {
+		return err;
+	}
+
+	// ID follows the 32-bit magic
+	dict_id = fileData[4];
+
+	CAT_INFO("main") << "Loaded shared table dictionary " << dict_id << " from " << filename;
+
+	return GCIF_RE_OK;
+}
+
+static int train(const char *path, const char *outfile, int compress_level, int strip_transparent_color, int dict_id) {
+	DIR *dir;
+	struct dirent *ent;
+
+	if ((dir = opendir (path)) == NULL) {
+		return -1;
+	}
+
+	GCIFTrainer *trainer = gcif_train_begin();
+	int count = 0;
+
+	while ((ent = readdir (dir)) != NULL) {
+		const char *name = ent->d_name;
+		int namelen = (int)strlen(name);
+
+		if (namelen > 4 &&
+			tolower(name[namelen-3]) == 'p' &&
+			tolower(name[namelen-2]) == 'n' &&
+			tolower(name[namelen-1]) == 'g') {
+			string filename = string(path) + "/" + name;
+
+			vector<unsigned char> image;
+			unsigned xsize, ysize;
+
+			unsigned error = lodepng::decode(image, xsize, ysize, filename);
+
+			if (error) {
+				CAT_WARN("main") << "PNG read error " << error << ": " << lodepng_error_text(error) << " for " << filename;
+				continue;
+			}
+
+			int err;
+			if ((err = gcif_train_add(trainer, &image[0], xsize, ysize, compress_level, strip_transparent_color))) {
+				CAT_WARN("main") << "Error while training on the image: " << gcif_write_errstr(err) << " for " << filename;
+				continue;
+			}
+
+			++count;
+		}
+	}
+
+	closedir(dir);
+
+	CAT_WARN("main") << "Writing shared table dictionary " << dict_id << " trained from " << count << " images: " << outfile;
+
+	int err;
+	if ((err = gcif_train_end(trainer, dict_id, outfile))) {
+		CAT_WARN("main") << "Error while writing the dictionary: " << gcif_write_errstr(err);
+		return err;
+	}
+
+	return GCIF_WE_OK;
+}
+
+static int pack(const char *path, const char *outfile, int compress_level, int strip_transparent_color) {
+	DIR *dir;
+	struct dirent *ent;
+
+	if ((dir = opendir (path)) == NULL) {
+		return -1;
+	}
+
+	vector<vector<unsigned char> > images;
+	vector<string> names;
+	vector<GCIFCollectionEntry> entries;
+
+	while ((ent = readdir (dir)) != NULL) {
+		const char *name = ent->d_name;
+		int namelen = (int)strlen(name);
+
+		if (namelen > 4 &&
+			tolower(name[namelen-3]) == 'p' &&
+			tolower(name[namelen-2]) == 'n' &&
+			tolower(name[namelen-1]) == 'g') {
+			string filename = string(path) + "/" + name;
+
+			vector<unsigned char> image;
+			unsigned xsize, ysize;
+
+			unsigned error = lodepng::decode(image, xsize, ysize, filename);
+
+			if (error) {
+				CAT_WARN("main") << "PNG read error " << error << ": " << lodepng_error_text(error) << " for " << filename;
+				continue;
+			}
+
+			images.push_back(vector<unsigned char>());
+			images.back().swap(image);
+			names.push_back(name);
+
+			GCIFCollectionEntry entry;
+			entry.xsize = xsize;
+			entry.ysize = ysize;
+			entries.push_back(entry);
+		}
+	}
+
+	closedir(dir);
+
+	// Fill in pointers once the vectors have stopped moving
+	for (int ii = 0; ii < (int)entries.size(); ++ii) {
+		entries[ii].rgba = &images[ii][0];
+		entries[ii].name = names[ii].c_str();
+	}
+
+	CAT_WARN("main") << "Writing collection of " << entries.size() << " images: " << outfile;
+
+	int err;
+	if ((err = gcif_write_collection(entries.size() > 0 ? &entries[0] : 0, (int)entries.size(), outfile, compress_level, strip_transparent_color))) {
+		CAT_WARN("main") << "Error while writing the collection: " << gcif_write_errstr(err);
+		return err;
+	}
+
+	return GCIF_WE_OK;
+}
+
+// Names come from the collection file, so only plain file names are written
+static bool isPlainFileName(const char *name) {
+	if (!name || !*name) {
+		return false;
+	}
+
+	// If it has a path separator, drive letter or parent reference,
+	if (strchr(name, '/') || strchr(name, '\\') || strchr(name, ':') ||
+		strstr(name, "..")) {
+		return false;
+	}
+
+	return true;
+}
+
+static int unpack(const char *filename, const char *path) {
+	MappedFile file;
+	MappedView fileView;
+
+	if CAT_UNLIKELY(!file.OpenRead(filename)) {
+		return GCIF_RE_FILE;
+	}
+
+	if CAT_UNLIKELY(!fileView.Open(&file)) {
+		return GCIF_RE_FILE;
+	}
+
+	u8 * CAT_RESTRICT fileData = fileView.MapView();
+	if CAT_UNLIKELY(!fileData) {
+		return GCIF_RE_FILE;
+	}
+
+	int err;
+
+	GCIFCollection *collection;
+	if ((err = gcif_open_collection(fileData, fileView.GetLength(), &collection))) {
+		CAT_WARN("main") << "Error while opening the collection: " << gcif_read_errstr(err);
+		return err;
+	}
+
+	const int count = gcif_collection_count(collection);
+
+	for (int ii = 0; ii < count; ++ii) {
+		const char *name = gcif_collection_entry_name(collection, ii);
+
+		if (!isPlainFileName(name)) {
+			CAT_WARN("main") << "Refusing to write collection entry " << ii << " with unsafe name: " << (name ? name : "(null)");
+			gcif_close_collection(collection);
+			return GCIF_RE_BAD_DATA;
+		}
+
+		GCIFImage image;
+		if ((err = gcif_read_collection_entry(collection, ii, &image))) {
+			CAT_WARN("main") << "Error while decompressing " << name << ": " << gcif_read_errstr(err);
+			gcif_close_collection(collection);
+			return err;
+		}
+
+		string outfile = string(path) + "/" + name;
+
+		CAT_INFO("main") << "Writing output PNG image file: " << outfile;
+
+		unsigned error = lodepng_encode_file(outfile.c_str(), (const unsigned char*)image.rgba, image.xsize, image.ysize, LCT_RGBA, 8);
+
+		free(image.rgba);
+
+		if (error) {
+			CAT_WARN("main") << "PNG write error " << error << ": " << lodepng_error_text(error) << " for " << outfile;
+			gcif_close_collection(collection);
+			return GCIF_RE_FILE;
+		}
+	}
+
+	gcif_close_collection(collection);
+
+	return GCIF_RE_OK;
+}
+
+
 //// Command-line parameter parsing
 
-enum  optionIndex { UNKNOWN, HELP, L0, L1, L2, L3, VERBOSE, SILENT, COMPRESS, DECOMPRESS, TEST, BENCHMARK, PROFILE, REPLACE, NOSTRIP };
+static option::ArgStatus RequiredArg(const option::Option &option, bool msg) {
+	if (option.arg != 0) {
+		return option::ARG_OK;
+	}
+
+	if (msg) {
+		CAT_WARN("main") << "Option '" << option.name << "' requires an argument";
+	}
+	return option::ARG_ILLEGAL;
+}
+
+enum  optionIndex { UNKNOWN, HELP, L0, L1, L2, L3, VERBOSE, SILENT, COMPRESS, DECOMPRESS, TEST, BENCHMARK, PROFILE, REPLACE, NOSTRIP, DICT, TRAIN, DICTID, PACK, UNPACK, TILE, REGION, TRACE, SWEEP, CONVERT, STAGES, INFLIGHT, CHANNELS };
 const option::Descriptor usage[] =
 {
   {UNKNOWN, 0,"" , ""    ,option::Arg::None, "USAGE: ./gcif [options] [output file path]\n\n"
@@ -842,9 +1677,30 @@ const option::Descriptor usage[] =
   {PROFILE,0,"p" , "profile",option::Arg::Optional, "  --[p]rofile <input GCI file path> \tDecode same GCI file 100x to enhance profiling of decoder" },
   {REPLACE,0,"r" , "replace",option::Arg::Optional, "  --[r]eplace <directory path> \tCompress all images in the given directory, replacing the original if the GCIF version is smaller without changing file name" },
   {NOSTRIP,0,"n" , "nostrip",option::Arg::Optional, "  --[n]ostrip \tDo not strip RGB color data from fully-transparent pixels.  The default is to remove this color data.  Saving it can be useful in some rare cases" },
+  {DICT,0,"" , "dict",RequiredArg, "  --dict=<dictionary file> \tUse a shared table dictionary to compress, decompress, or test tiny images" },
+  {TRAIN,0,"" , "train",option::Arg::Optional, "  --train <image directory> <output dictionary file> \tTrain a shared table dictionary from the PNG images in a directory" },
+  {DICTID,0,"" , "dictid",RequiredArg, "  --dictid=<1-255> \tID to give a trained dictionary (default 1)" },
+  {PACK,0,"" , "pack",option::Arg::Optional, "  --pack <image directory> <output collection file> \tPack the PNG images in a directory into one collection file that shares tables" },
+  {UNPACK,0,"" , "unpack",option::Arg::Optional, "  --unpack <input collection file> <output directory> \tDecompress every image in a collection to PNG files" },
+  {TILE,0,"" , "tile",RequiredArg, "  --tile=<size> \tCompress or test as independently decodable square tiles of the given size, such as 256" },
+  {REGION,0,"" , "region",RequiredArg, "  --region=<x,y,w,h> \tDecompress only the given rectangle of the image" },
+  {TRACE,0,"" , "trace",RequiredArg, "  --trace=<output JSON file> \tWrite a Chrome trace of the encoder phases, viewable in chrome://tracing" },
+  {SWEEP,0,"" , "sweep",option::Arg::Optional, "  --sweep <image directory> \tCompress the PNG images in a directory with a grid of knob settings and print the Pareto frontier of encode time, size and peak memory.  Only sweeps variations of one level if -0 to -3 is given" },
+  {CONVERT,0,"" , "convert",option::Arg::Optional, "  --convert <image directory> <output directory> \tCompress the PNG images in a directory to GCIF files in the output directory, overlapping file reads, encoding, verification and file writes" },
+  {STAGES,0,"" , "stages",RequiredArg, "  --stages=<read,encode,verify,write> \tThread counts for each --convert stage, such as 2,8,2,2 (default: 2, one per processor, a quarter of that, 2)" },
+  {INFLIGHT,0,"" , "inflight",RequiredArg, "  --inflight=<images> \tMost images held in memory at once by --convert (default: twice the total stage threads)" },
+  {CHANNELS,0,"" , "channels",RequiredArg, "  --channels=<1, 3 or 4> \tCompress the PNG image as grayscale, RGB or RGBA (default 4).  Decompression keeps the channel count" },
   {UNKNOWN, 0,"" ,  ""   ,option::Arg::None, "\nExamples:\n"
                                              "  ./gcif -c ./original.png test.gci\n"
-                                             "  ./gcif -d ./test.gci decoded.png" },
+                                             "  ./gcif -d ./test.gci decoded.png\n"
+                                             "  ./gcif --train ./icons icons.gcd\n"
+                                             "  ./gcif --dict=icons.gcd -c ./icon.png icon.gci\n"
+                                             "  ./gcif --pack ./icons icons.gcc\n"
+                                             "  ./gcif --tile=256 -c ./atlas.png atlas.gci\n"
+                                             "  ./gcif --region=256,0,64,64 -d ./atlas.gci sprite.png\n"
+                                             "  ./gcif --trace=trace.json -c ./slow.png slow.gci\n"
+                                             "  ./gcif --channels=1 -c ./heightmap.png heightmap.gci\n"
+                                             "  ./gcif --convert --stages=2,8,2,2 ./assets ./assets_gci" },
   {0,0,0,0,0,0}
 };
 
@@ -881,6 +1737,34 @@ int processParameters(option::Parser &parse, option::Option options[]) {
 		compression_level = 3;
 	}
 
+	int dict_id = 0;
+
+	if (options[DICT]) {
+		int err;
+
+		if ((err = loadDictionary(options[DICT].arg, dict_id))) {
+			CAT_WARN("main") << "Unable to load dictionary " << options[DICT].arg << ": " << gcif_read_errstr(err);
+			return err;
+		}
+	}
+
+	int tile_size = 0;
+
+	if (options[TILE]) {
+		tile_size = atoi(options[TILE].arg);
+	}
+
+	int channels = 4;
+
+	if (options[CHANNELS]) {
+		channels = atoi(options[CHANNELS].arg);
+
+		if (channels != 1 && channels != 3 && channels != 4) {
+			CAT_WARN("main") << "Input error: Channels must be 1, 3 or 4";
+			return 1;
+		}
+	}
+
 	if (options[COMPRESS]) {
 		if (parse.nonOptionsCount() != 2) {
 			CAT_WARN("main") << "Input error: Please provide input and output file paths";
@@ -889,7 +1773,7 @@ int processParameters(option::Parser &parse, option::Option options[]) {
 			const char *outFilePath = parse.nonOption(1);
 			int err;
 
-			if ((err = compress(inFilePath, outFilePath, compression_level, strip_transparent_color))) {
+			if ((err = compress(inFilePath, outFilePath, compression_level, strip_transparent_color, dict_id, tile_size, channels))) {
 				CAT_INFO("main") << "Error during conversion [retcode:" << err << "]";
 				return err;
 			}
@@ -904,7 +1788,13 @@ int processParameters(option::Parser &parse, option::Option options[]) {
 			const char *outFilePath = parse.nonOption(1);
 			int err;
 
-			if ((err = decompress(inFilePath, outFilePath))) {
+			if (options[REGION]) {
+				err = decompressRegion(inFilePath, outFilePath, options[REGION].arg);
+			} else {
+				err = decompress(inFilePath, outFilePath);
+			}
+
+			if (err) {
 				CAT_INFO("main") << "Error during conversion [retcode:" << err << "]";
 				return err;
 			}
@@ -918,7 +1808,7 @@ int processParameters(option::Parser &parse, option::Option options[]) {
 			const char *inFilePath = parse.nonOption(0);
 			int err;
 
-			if ((err = testfile(inFilePath))) {
+			if ((err = testfile(inFilePath, dict_id, tile_size))) {
 				CAT_INFO("main") << "Error during conversion [retcode:" << err << "]";
 				return err;
 			}
@@ -937,6 +1827,37 @@ int processParameters(option::Parser &parse, option::Option options[]) {
 				return err;
 			}
 
+			return 0;
+		}
+	} else if (options[SWEEP]) {
+		if (parse.nonOptionsCount() != 1) {
+			CAT_WARN("main") << "Input error: Please provide input directory path";
+		} else {
+			const char *inFilePath = parse.nonOption(0);
+			int err;
+
+			if ((err = sweep(inFilePath, compression_level))) {
+				CAT_INFO("main") << "Error during sweep [retcode:" << err << "]";
+				return err;
+			}
+
+			return 0;
+		}
+	} else if (options[CONVERT]) {
+		if (parse.nonOptionsCount() != 2) {
+			CAT_WARN("main") << "Input error: Please provide input and output directory paths";
+		} else {
+			const char *inFilePath = parse.nonOption(0);
+			const char *outFilePath = parse.nonOption(1);
+			const char *stages = options[STAGES] ? options[STAGES].arg : 0;
+			const char *inflight = options[INFLIGHT] ? options[INFLIGHT].arg : 0;
+			int err;
+
+			if ((err = convert(inFilePath, outFilePath, compression_level, strip_transparent_color, stages, inflight))) {
+				CAT_INFO("main") << "Error during conversion [retcode:" << err << "]";
+				return err;
+			}
+
 			return 0;
 		}
 	} else if (options[REPLACE]) {
@@ -951,6 +1872,56 @@ int processParameters(option::Parser &parse, option::Option options[]) {
 				return err;
 			}
 
+			return 0;
+		}
+	} else if (options[TRAIN]) {
+		if (parse.nonOptionsCount() != 2) {
+			CAT_WARN("main") << "Input error: Please provide input directory and output file paths";
+		} else {
+			const char *inFilePath = parse.nonOption(0);
+			const char *outFilePath = parse.nonOption(1);
+			int err;
+
+			int train_id = 1;
+			if (options[DICTID]) {
+				train_id = atoi(options[DICTID].arg);
+			}
+
+			if ((err = train(inFilePath, outFilePath, compression_level, strip_transparent_color, train_id))) {
+				CAT_INFO("main") << "Error during training [retcode:" << err << "]";
+				return err;
+			}
+
+			return 0;
+		}
+	} else if (options[PACK]) {
+		if (parse.nonOptionsCount() != 2) {
+			CAT_WARN("main") << "Input error: Please provide input directory and output file paths";
+		} else {
+			const char *inFilePath = parse.nonOption(0);
+			const char *outFilePath = parse.nonOption(1);
+			int err;
+
+			if ((err = pack(inFilePath, outFilePath, compression_level, strip_transparent_color))) {
+				CAT_INFO("main") << "Error during conversion [retcode:" << err << "]";
+				return err;
+			}
+
+			return 0;
+		}
+	} else if (options[UNPACK]) {
+		if (parse.nonOptionsCount() != 2) {
+			CAT_WARN("main") << "Input error: Please provide input file and output directory paths";
+		} else {
+			const char *inFilePath = parse.nonOption(0);
+			const char *outFilePath = parse.nonOption(1);
+			int err;
+
+			if ((err = unpack(inFilePath, outFilePath))) {
+				CAT_INFO("main") << "Error during conversion [retcode:" << err << "]";
+				return err;
+			}
+
 			return 0;
 		}
 	} else if (options[PROFILE]) {
@@ -990,8 +1961,19 @@ int main(int argc, const char *argv[]) {
 	option::Option *buffer = new option::Option[stats.buffer_max];
 	option::Parser parse(usage, argc, argv, options, buffer);
 
+	// If tracing encoder phases,
+	if (options[TRACE]) {
+		Tracer::enable();
+	}
+
 	int retval = processParameters(parse, options);
 
+	if (options[TRACE]) {
+		if (!Tracer::write(options[TRACE].arg)) {
+			CAT_WARN("main") << "Unable to write trace file " << options[TRACE].arg;
+		}
+	}
+
 	delete []options;
 	delete []buffer;
 
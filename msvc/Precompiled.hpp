@@ -35,7 +35,7 @@
 #include "../encoder/lz4hc.h"
 #include "../encoder/LZMatchFinder.hpp"
 #include "../encoder/MonoWriter.hpp"
-#include "../encoder/Mutex.hpp"
+#include "../decoder/Mutex.hpp"
 #include "../encoder/PaletteOptimizer.hpp"
 #include "../encoder/Singleton.hpp"
 #include "../encoder/SmallPaletteWriter.hpp"